@@ -6,7 +6,11 @@
 #include <iostream>
 #include <vector>
 #include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #ifdef __APPLE__
 #include <unistd.h>
 #include <limits.h>
@@ -26,6 +30,11 @@
 #include "camera.h"
 #include "model.h"
 #include "../common/include/common.hpp"
+#include "../common/include/instance_buffer.hpp"
+#include "../common/include/static_batch.hpp"
+#include "../common/include/frame_pipeline.hpp"
+#include "../common/include/headless.hpp"
+#include "../common/include/profiler.hpp"
 
 // Settings
 const unsigned int SCR_WIDTH = 800;
@@ -49,9 +58,68 @@ float playerRotation = 0.0f;
 // Game state
 std::vector<glm::vec3> items; // Item positions
 std::vector<bool> itemCollected; // Track collected items
+std::vector<size_t> itemInstances; // Instance buffer handle of each item
 const float GROUND_SIZE = 20.0f;
 const float GROUND_Y = -0.5f;
 
+// Per-draw uniform names, hashed at compile time and resolved through the shader's uniform table
+constexpr Common::UniformName UNIFORM_MODEL("model");
+constexpr Common::UniformName UNIFORM_USE_TEXTURE("useTexture");
+constexpr Common::UniformName UNIFORM_OBJECT_COLOR("objectColor");
+
+// Per-draw uniforms carried through the render queue
+struct ObjectUniforms {
+    const Common::Shader *shader;
+    glm::mat4 model;
+    glm::vec3 color;
+    bool useTexture;
+};
+
+void applyObjectUniforms(const void *data) {
+    const ObjectUniforms &uniforms = *static_cast<const ObjectUniforms *>(data);
+    uniforms.shader->setMat4(UNIFORM_MODEL, uniforms.model);
+    uniforms.shader->setBool(UNIFORM_USE_TEXTURE, uniforms.useTexture);
+    uniforms.shader->setVec3(UNIFORM_OBJECT_COLOR, uniforms.color);
+}
+
+// One collectible in the item instance buffer; the spin is computed in item.vs from FrameData.time
+struct ItemInstance {
+    glm::vec3 position;
+    glm::vec3 color;
+};
+
+Common::VertexFormat itemInstanceFormat() {
+    Common::VertexFormat format;
+    format.stride = sizeof(ItemInstance);
+    format.attributes = {
+        { 3, 3, GL_FLOAT, offsetof(ItemInstance, position) },
+        { 4, 3, GL_FLOAT, offsetof(ItemInstance, color) },
+    };
+    return format;
+}
+
+// Sort depth for the render queue: view distance over the far plane
+const float FAR_PLANE = 100.0f;
+float queueDepth(const glm::vec3 &position, const glm::vec3 &cameraPosition) {
+    return glm::length(position - cameraPosition) / FAR_PLANE;
+}
+
+// Framebuffer size, written by the resize callback and applied by the render thread
+int framebufferWidth = SCR_WIDTH;
+int framebufferHeight = SCR_HEIGHT;
+
+// Everything the render thread needs for one frame, filled by the main thread and read-only afterwards
+struct FramePacket {
+    Common::FrameData frameData;
+    glm::mat4 playerModel;
+    glm::vec3 playerPosition;
+    glm::vec3 cameraPosition;
+    float zoom;
+    std::vector<size_t> collectedItems; // Instance handles to drop from the item buffer
+    int framebufferWidth;
+    int framebufferHeight;
+};
+
 // Collision detection
 struct AABB {
     glm::vec3 min;
@@ -74,45 +142,74 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void processInput(GLFWwindow *window);
-unsigned int createPlaneVAO();
+void movePlayer(glm::vec3 moveDirection);
+Mesh createGroundMesh();
 unsigned int createCubeVAO();
 
-int main() {
-    // glfw: initialize and configure
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    
+int main(int argc, char** argv) {
+    // --headless renders a fixed number of frames offscreen with no window, see headless.hpp
+    Common::HeadlessOptions headlessOptions = Common::parseHeadlessOptions(argc, argv);
+    bool headless = headlessOptions.enabled;
+    Common::HeadlessContext headlessContext;
+    GLFWwindow* window = NULL;
+    
+    if (headless) {
+        if (!headlessContext.create(headlessOptions.width, headlessOptions.height)) {
+            return -1;
+        }
+        framebufferWidth = headlessOptions.width;
+        framebufferHeight = headlessOptions.height;
+    } else {
+        // glfw: initialize and configure
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
-    
-    // glfw window creation
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Assignment 3 - 3D Game", NULL, NULL);
-    if (window == NULL) {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
-    
-    // Tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-    
-    // glad: load all OpenGL function pointers
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        
+        // glfw window creation
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Assignment 3 - 3D Game", NULL, NULL);
+        if (window == NULL) {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        
+        // Tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        
+        // glad: load all OpenGL function pointers
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
     }
     
     // Configure global opengl state
     glEnable(GL_DEPTH_TEST);
     
+    // Zone timings per frame, see profiler.hpp; compiled out in Release builds.
+    // --profile also writes them to profile.csv, and a Chrome trace on exit
+    PROFILE_THREAD_NAME("Main");
+    bool profileFiles = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--profile") == 0) {
+            profileFiles = true;
+        }
+    }
+    if (profileFiles) {
+        PROFILE_OPEN_CSV("profile.csv");
+    }
+    
     // Print current working directory for debugging
     char cwd[PATH_MAX];
     if (getcwd(cwd, sizeof(cwd)) != NULL) {
@@ -151,10 +248,14 @@ int main() {
     
     Common::Shader shader(vsPath.c_str(), fsPath.c_str());
     
+    // Camera and lighting for every program, written once per frame
+    Common::FrameUniformBuffer frameUniforms;
+    
     // Load player model
     std::string modelPath = findResourcePath("resource/pbr-low-poly-fox-character/source/LP_Firefox.obj");
     std::cout << "Loading model from: " << modelPath << std::endl;
-    Model playerModel(modelPath.c_str());
+    // Nothing reads the mesh arrays after upload, so keep only the GPU copy
+    Model playerModel(modelPath.c_str(), Common::CpuRetention::None);
     
     // Initialize items (boxes)
     items = {
@@ -165,35 +266,182 @@ int main() {
         glm::vec3(0.0f, 0.5f, 8.0f),
         glm::vec3(8.0f, 0.5f, 0.0f),
     };
+    
+    // --items N scatters N more items over the ground for stress testing
+    // --single-thread renders on the main thread instead of a render thread, for debugging
+    bool threaded = !headless;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--single-thread") == 0) {
+            threaded = false;
+        }
+        if (std::strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            int extraItems = std::atoi(argv[i + 1]);
+            int side = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(std::max(extraItems, 0)))));
+            for (int n = 0; n < extraItems; n++) {
+                float u = ((n % side) + 0.5f) / side - 0.5f;
+                float v = ((n / side) + 0.5f) / side - 0.5f;
+                items.push_back(glm::vec3(u * GROUND_SIZE, 0.5f, v * GROUND_SIZE));
+            }
+        }
+    }
     itemCollected.resize(items.size(), false);
     
+    // Static geometry lives in the shared arena and is drawn by one multi-draw per texture set
+    std::string staticVsPath = findResourcePath("resource/shaders/static.vs");
+    Common::Shader staticShader(staticVsPath.c_str(), findResourcePath("resource/shaders/item.fs").c_str());
+    Common::StaticBatch staticBatch;
+    
     // Create ground plane
-    unsigned int planeVAO = createPlaneVAO();
+    Mesh ground = createGroundMesh();
+    glm::mat4 groundModel = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, GROUND_Y, 0.0f));
+    groundModel = glm::scale(groundModel, glm::vec3(GROUND_SIZE, 1.0f, GROUND_SIZE));
+    staticBatch.add(ground.MakeDrawCommand(staticShader.ID, 0.0f), { groundModel, glm::vec4(0.5f, 0.5f, 0.5f, 1.0f) }); // Gray for ground
     
     // Create cube VAO for items
     unsigned int cubeVAO = createCubeVAO();
     
+    // Items are drawn in one instanced call; collecting one only rewrites the instance buffer
+    std::string itemVsPath = findResourcePath("resource/shaders/item.vs");
+    std::string itemFsPath = findResourcePath("resource/shaders/item.fs");
+    Common::Shader itemShader(itemVsPath.c_str(), itemFsPath.c_str());
+    Common::InstanceBuffer itemBuffer(itemInstanceFormat(), cubeVAO, items.size());
+    itemInstances.resize(items.size());
+    for (size_t i = 0; i < items.size(); i++) {
+        ItemInstance instance{ items[i], glm::vec3(0.2f, 0.6f, 1.0f) }; // Blue for items
+        itemInstances[i] = itemBuffer.add(&instance);
+    }
+    
+    // Draws are collected per frame, sorted by state and issued through the state cache
+    Common::RenderQueue renderQueue;
+    Common::GLStateCache glState;
+    float lastStatsTime = 0.0f;
+    
+    // Timings and image dumps of a headless run; headless runs are single-threaded so timings stay per frame
+    std::unique_ptr<Common::HeadlessRun> headlessRun;
+    if (headless) {
+        headlessRun.reset(new Common::HeadlessRun(headlessOptions));
+    }
+    
+    // The main thread simulates frame N+1 while the render thread submits frame N
+    int viewportWidth = 0, viewportHeight = 0;
+    auto renderFrame = [&](const FramePacket &packet) {
+        if (packet.framebufferWidth != viewportWidth || packet.framebufferHeight != viewportHeight) {
+            viewportWidth = packet.framebufferWidth;
+            viewportHeight = packet.framebufferHeight;
+            glViewport(0, 0, viewportWidth, viewportHeight);
+        }
+        
+        // Render
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        
+        // View/projection transformations and lighting, shared by all shaders through the FrameData block
+        frameUniforms.update(packet.frameData);
+        
+        // Render static geometry
+        glState.stats = Common::RenderStats();
+        {
+            PROFILE_GPU_ZONE("Static batch draw");
+            staticBatch.draw(glState, staticShader.ID);
+        }
+        
+        // Render player
+        {
+            PROFILE_ZONE("LOD selection");
+            playerModel.SelectLod(packet.cameraPosition, packet.zoom, (float)packet.framebufferHeight, packet.playerModel);
+        }
+        playerModel.Submit(renderQueue, shader.ID, queueDepth(packet.playerPosition, packet.cameraPosition), applyObjectUniforms,
+                           ObjectUniforms{ &shader, packet.playerModel, glm::vec3(1.0f, 1.0f, 1.0f), true }); // White fallback
+        
+        // Render items (boxes) - one instanced draw, spun in the vertex shader
+        for (size_t handle : packet.collectedItems) {
+            itemBuffer.remove(handle);
+        }
+        itemBuffer.sync();
+        if (itemBuffer.count() > 0) {
+            Common::DrawCommand itemBatch;
+            itemBatch.sortKey = Common::makeSortKey(Common::RenderPass::Opaque, itemShader.ID, 0, cubeVAO, 0.0f);
+            itemBatch.program = itemShader.ID;
+            itemBatch.vertexArray = cubeVAO;
+            itemBatch.count = 36;
+            itemBatch.instanceCount = itemBuffer.count();
+            renderQueue.submit(itemBatch);
+        }
+        
+        Common::RenderStats renderStats;
+        {
+            PROFILE_GPU_ZONE("Draw submission");
+            renderStats = renderQueue.flush(glState);
+        }
+        if (packet.frameData.time - lastStatsTime >= 5.0f) {
+            Common::logRenderStats("Frame", renderStats);
+            lastStatsTime = packet.frameData.time;
+        }
+        
+        // glfw: swap buffers
+        {
+            PROFILE_ZONE("Swap");
+            if (headless) {
+                headlessRun->present();
+            } else {
+                glfwSwapBuffers(window);
+            }
+        }
+        PROFILE_FRAME();
+    };
+    
+    // The GL context belongs to the render thread from here until the pipeline stops
+    if (threaded) {
+        glfwMakeContextCurrent(NULL);
+    }
+    Common::FramePipeline<FramePacket> pipeline(threaded,
+                                                [window]() {
+                                                    PROFILE_THREAD_NAME("Render");
+                                                    glfwMakeContextCurrent(window);
+                                                },
+                                                renderFrame,
+                                                []() { glfwMakeContextCurrent(NULL); });
+    float lastPipelineStatsTime = 0.0f;
+    
     // Render loop
-    while (!glfwWindowShouldClose(window)) {
-        // Per-frame time logic
-        float currentFrame = static_cast<float>(glfwGetTime());
+    while (headless ? headlessRun->running() : !glfwWindowShouldClose(window)) {
+        // Per-frame time logic, a fixed timestep when headless
+        float currentFrame;
+        if (headless) {
+            headlessRun->beginFrame();
+            currentFrame = headlessRun->time();
+        } else {
+            currentFrame = static_cast<float>(glfwGetTime());
+        }
         deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
         
-        // Input
-        processInput(window);
+        // Input; headless runs walk the player in a fixed circle so every run draws the same frames
+        if (headless) {
+            float heading = currentFrame * 0.6f;
+            movePlayer(glm::vec3(std::cos(heading), 0.0f, std::sin(heading)));
+        } else {
+            processInput(window);
+        }
         
         // Update camera to follow player
         camera.FollowTarget(playerPosition, 0.0f, 5.0f, 10.0f);
         
+        FramePacket &packet = pipeline.beginPacket();
+        packet.collectedItems.clear();
+        
         // Check collisions with items
-        AABB playerBox(playerPosition, glm::vec3(1.0f, 1.0f, 1.0f));
-        for (size_t i = 0; i < items.size(); i++) {
-            if (!itemCollected[i]) {
-                AABB itemBox(items[i], glm::vec3(1.0f, 1.0f, 1.0f));
-                if (checkCollision(playerBox, itemBox)) {
-                    itemCollected[i] = true;
-                    std::cout << "Item collected! " << (items.size() - std::count(itemCollected.begin(), itemCollected.end(), true)) << " items remaining." << std::endl;
+        {
+            PROFILE_ZONE("Item collisions");
+            AABB playerBox(playerPosition, glm::vec3(1.0f, 1.0f, 1.0f));
+            for (size_t i = 0; i < items.size(); i++) {
+                if (!itemCollected[i]) {
+                    AABB itemBox(items[i], glm::vec3(1.0f, 1.0f, 1.0f));
+                    if (checkCollision(playerBox, itemBox)) {
+                        itemCollected[i] = true;
+                        packet.collectedItems.push_back(itemInstances[i]);
+                        std::cout << "Item collected! " << (items.size() - std::count(itemCollected.begin(), itemCollected.end(), true)) << " items remaining." << std::endl;
+                    }
                 }
             }
         }
@@ -204,70 +452,64 @@ int main() {
         if (playerPosition.z > GROUND_SIZE / 2.0f) playerPosition.z = GROUND_SIZE / 2.0f;
         if (playerPosition.z < -GROUND_SIZE / 2.0f) playerPosition.z = -GROUND_SIZE / 2.0f;
         
-        // Render
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        
-        shader.use();
+        // View/projection transformations and lighting
+        // Aspect of what is actually rendered: the headless size or the resized window. A minimized
+        // window reports a zero height, keep the default aspect then
+        packet.framebufferWidth = framebufferWidth;
+        packet.framebufferHeight = framebufferHeight;
+        float aspect = packet.framebufferHeight > 0 ? (float)packet.framebufferWidth / (float)packet.framebufferHeight
+                                                    : (float)SCR_WIDTH / (float)SCR_HEIGHT;
+        packet.frameData = Common::FrameData{};
+        packet.frameData.projection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, FAR_PLANE);
+        packet.frameData.view = camera.GetViewMatrix();
+        packet.frameData.viewPos = camera.Position;
+        packet.frameData.time = currentFrame;
+        packet.frameData.lightPos = glm::vec3(10.0f, 10.0f, 10.0f);
+        packet.frameData.lightColor = glm::vec3(1.0f, 1.0f, 1.0f);
         
-        // View/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        shader.setMat4("projection", projection);
-        shader.setMat4("view", view);
-        
-        // Lighting
-        glm::vec3 lightPos(10.0f, 10.0f, 10.0f);
-        glm::vec3 lightColor(1.0f, 1.0f, 1.0f);
-        shader.setVec3("lightPos", lightPos);
-        shader.setVec3("lightColor", lightColor);
-        shader.setVec3("viewPos", camera.Position);
-        
-        // Render ground plane
+        // Player transform
         glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, GROUND_Y, 0.0f));
-        model = glm::scale(model, glm::vec3(GROUND_SIZE, 1.0f, GROUND_SIZE));
-        shader.setMat4("model", model);
-        shader.setBool("useTexture", false);
-        shader.setVec3("objectColor", glm::vec3(0.5f, 0.5f, 0.5f)); // Gray for ground
-        glBindVertexArray(planeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        
-        // Render player
-        model = glm::mat4(1.0f);
         model = glm::translate(model, playerPosition);
         model = glm::rotate(model, glm::radians(playerRotation), glm::vec3(0.0f, 1.0f, 0.0f));
         model = glm::scale(model, glm::vec3(0.5f, 0.5f, 0.5f)); // Scale down the model
-        shader.setMat4("model", model);
-        shader.setBool("useTexture", true);
-        shader.setVec3("objectColor", glm::vec3(1.0f, 1.0f, 1.0f)); // White fallback
-        playerModel.Draw(shader.ID);
+        packet.playerModel = model;
+        packet.playerPosition = playerPosition;
+        packet.cameraPosition = camera.Position;
+        packet.zoom = camera.Zoom;
+        if (headless) {
+            headlessRun->simulationDone();
+        }
+        pipeline.submit();
+        if (headless) {
+            headlessRun->endFrame();
+        }
         
-        // Render items (boxes) - with a slight rotation for visual appeal
-        for (size_t i = 0; i < items.size(); i++) {
-            if (!itemCollected[i]) {
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, items[i]);
-                model = glm::rotate(model, (float)glfwGetTime() * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-                model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));
-                shader.setMat4("model", model);
-                shader.setBool("useTexture", false);
-                shader.setVec3("objectColor", glm::vec3(0.2f, 0.6f, 1.0f)); // Blue for items
-                glBindVertexArray(cubeVAO);
-                glDrawArrays(GL_TRIANGLES, 0, 36);
-            }
+        if (currentFrame - lastPipelineStatsTime >= 5.0f) {
+            pipeline.logStats("Frame pipeline");
+            lastPipelineStatsTime = currentFrame;
         }
         
-        // glfw: swap buffers and poll IO events
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        // glfw: poll IO events
+        if (!headless) {
+            glfwPollEvents();
+        }
+    }
+    
+    // Let the render thread finish its last frame and give the context back for cleanup
+    pipeline.stop();
+    if (profileFiles) {
+        PROFILE_WRITE_TRACE("profile_trace.json");
+    }
+    if (threaded) {
+        glfwMakeContextCurrent(window);
     }
     
     // Cleanup
-    glDeleteVertexArrays(1, &planeVAO);
     glDeleteVertexArrays(1, &cubeVAO);
     
-    glfwTerminate();
+    if (!headless) {
+        glfwTerminate();
+    }
     return 0;
 }
 
@@ -292,6 +534,11 @@ void processInput(GLFWwindow *window) {
         moveDirection += glm::vec3(1.0f, 0.0f, 0.0f);
     }
     
+    movePlayer(moveDirection);
+}
+
+// Move the player along a direction for this frame and turn it to face that way
+void movePlayer(glm::vec3 moveDirection) {
     // Normalize movement direction
     if (glm::length(moveDirection) > 0.0f) {
         moveDirection = glm::normalize(moveDirection);
@@ -304,7 +551,9 @@ void processInput(GLFWwindow *window) {
 
 // glfw: whenever the window size changed
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    glViewport(0, 0, width, height);
+    // The render thread owns the context, so it applies the viewport with the next frame
+    framebufferWidth = width;
+    framebufferHeight = height;
 }
 
 // glfw: whenever the mouse moves
@@ -332,39 +581,18 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
-// Create a plane VAO
-unsigned int createPlaneVAO() {
-    float vertices[] = {
-        // positions          // normals         // texcoords
-        -0.5f, 0.0f, -0.5f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f,
-         0.5f, 0.0f, -0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 0.0f,
-         0.5f, 0.0f,  0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f,
-         0.5f, 0.0f,  0.5f,  0.0f, 1.0f, 0.0f,  1.0f, 1.0f,
-        -0.5f, 0.0f,  0.5f,  0.0f, 1.0f, 0.0f,  0.0f, 1.0f,
-        -0.5f, 0.0f, -0.5f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f
+// Create the ground plane in the shared geometry arena
+Mesh createGroundMesh() {
+    std::vector<Vertex> vertices = {
+        // positions                     // normals                    // texcoords
+        { glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 0.0f) },
+        { glm::vec3( 0.5f, 0.0f, -0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 0.0f) },
+        { glm::vec3( 0.5f, 0.0f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(1.0f, 1.0f) },
+        { glm::vec3(-0.5f, 0.0f,  0.5f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec2(0.0f, 1.0f) }
     };
+    std::vector<unsigned int> indices = { 0, 1, 2, 2, 3, 0 };
     
-    unsigned int VAO, VBO;
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-    
-    // Position attribute
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    // Normal attribute
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    // Texture coordinate attribute
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    
-    glBindVertexArray(0);
-    
-    return VAO;
+    return Mesh(std::move(vertices), std::move(indices), {}, {}, Common::CpuRetention::None);
 }
 
 // Create a cube VAO
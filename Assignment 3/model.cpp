@@ -1,49 +1,112 @@
 #include "model.h"
+#include "mesh_optimizer.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 #include <cfloat>
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_STATIC
 #include <stb_image.h>
 
+namespace {
+
+// Index triple of a face corner in an OBJ file; -1 marks a missing component
+struct ObjVertexKey {
+    int posIdx = -1;
+    int texIdx = -1;
+    int normIdx = -1;
+
+    bool operator==(const ObjVertexKey &other) const {
+        return posIdx == other.posIdx && texIdx == other.texIdx && normIdx == other.normIdx;
+    }
+};
+
+struct ObjVertexKeyHash {
+    size_t operator()(const ObjVertexKey &key) const {
+        // Large odd multipliers spread the three indices across the word
+        size_t h = static_cast<size_t>(static_cast<unsigned int>(key.posIdx)) * 73856093u;
+        h ^= static_cast<size_t>(static_cast<unsigned int>(key.texIdx)) * 19349663u;
+        h ^= static_cast<size_t>(static_cast<unsigned int>(key.normIdx)) * 83492791u;
+        return h;
+    }
+};
+
+} // namespace
+
 // Mesh implementation
-Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures) {
-    this->vertices = vertices;
-    this->indices = indices;
-    this->textures = textures;
+Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+           std::vector<Common::MeshLod> lods, Common::CpuRetention retention)
+    : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), lods(std::move(lods)) {
+    if (this->lods.empty()) {
+        this->lods.push_back({ 0, static_cast<unsigned int>(this->indices.size()), 0.0f });
+    }
+    
+    // Bounding sphere used for LOD distance
+    glm::vec3 minPos(FLT_MAX), maxPos(-FLT_MAX);
+    for (const auto &vertex : this->vertices) {
+        minPos = glm::min(minPos, vertex.Position);
+        maxPos = glm::max(maxPos, vertex.Position);
+    }
+    boundsCenter = this->vertices.empty() ? glm::vec3(0.0f) : (minPos + maxPos) * 0.5f;
+    boundsRadius = this->vertices.empty() ? 0.0f : glm::length(maxPos - minPos) * 0.5f;
+    
     setupMesh();
+    ReleaseCpuData(retention);
 }
 
-void Mesh::setupMesh() {
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-    
-    glBindVertexArray(VAO);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-    
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-    
-    // Vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    
-    // Vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    
-    // Vertex texture coordinates
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+Mesh::~Mesh() {
+    if (geometry.valid()) {
+        arena().free(geometry);
+    }
+}
+
+Mesh::Mesh(Mesh &&other) noexcept
+    : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+      lods(std::move(other.lods)), positions(std::move(other.positions)), currentLod(other.currentLod),
+      boundsCenter(other.boundsCenter), boundsRadius(other.boundsRadius), geometry(other.geometry) {
+    other.geometry = Common::GeometryAllocation();
+}
+
+void Mesh::ReleaseCpuData(Common::CpuRetention retention) {
+    if (retention == Common::CpuRetention::KeepAll) {
+        return;
+    }
     
-    glBindVertexArray(0);
+    if (retention == Common::CpuRetention::PositionsOnly && !vertices.empty()) {
+        positions.reserve(vertices.size());
+        for (const auto &vertex : vertices) {
+            positions.push_back(vertex.Position);
+        }
+    } else if (retention == Common::CpuRetention::None) {
+        Common::releaseVector(positions);
+        Common::releaseVector(indices);
+    }
+    Common::releaseVector(vertices);
+}
+
+Common::MeshMemoryStats Mesh::GetMemoryStats() const {
+    Common::MeshMemoryStats stats;
+    stats.cpuBytes = Common::vectorBytes(vertices) + Common::vectorBytes(indices) + Common::vectorBytes(positions) +
+                     Common::vectorBytes(textures) + Common::vectorBytes(lods);
+    stats.gpuBytes = geometry.vertexCount * sizeof(Vertex) + geometry.indexCount * sizeof(unsigned int);
+    stats.meshCount = 1;
+    return stats;
+}
+
+Common::GeometryArena &Mesh::arena() {
+    static Common::GeometryArena arena(Common::VertexFormat{ sizeof(Vertex), {
+        { 0, 3, GL_FLOAT, offsetof(Vertex, Position) },
+        { 1, 3, GL_FLOAT, offsetof(Vertex, Normal) },
+        { 2, 2, GL_FLOAT, offsetof(Vertex, TexCoords) } } });
+    return arena;
+}
+
+void Mesh::setupMesh() {
+    geometry = arena().allocate(vertices.data(), vertices.size(), indices.data(), indices.size());
 }
 
 void Mesh::Draw(unsigned int shaderID) {
@@ -54,19 +117,37 @@ void Mesh::Draw(unsigned int shaderID) {
         glUniform1i(glGetUniformLocation(shaderID, "texture_diffuse1"), 0);
     }
     
-    // Draw mesh
-    glBindVertexArray(VAO);
-    glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-    glBindVertexArray(0);
+    // Draw mesh at the selected level of detail; LOD offsets are relative to the mesh's first index
+    const Common::MeshLod &lod = lods[currentLod];
+    glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT,
+                             (void*)((geometry.firstIndex + lod.indexOffset) * sizeof(unsigned int)), geometry.baseVertex);
     
     glActiveTexture(GL_TEXTURE0);
 }
 
+Common::DrawCommand Mesh::MakeDrawCommand(unsigned int program, float depth) const {
+    const Common::MeshLod &lod = lods[currentLod];
+    GLuint texture = textures.empty() ? 0 : textures[0].id;
+    
+    Common::DrawCommand command;
+    command.sortKey = Common::makeSortKey(Common::RenderPass::Opaque, program, texture, arena().vao(), depth);
+    command.program = program;
+    command.vertexArray = arena().vao();
+    command.textures[0] = texture;   // texture_diffuse1 samples unit 0
+    command.indexType = GL_UNSIGNED_INT;
+    command.count = static_cast<GLsizei>(lod.indexCount);
+    command.first = static_cast<GLint>(geometry.firstIndex + lod.indexOffset);
+    command.baseVertex = static_cast<GLint>(geometry.baseVertex);
+    return command;
+}
+
 // Model implementation
-Model::Model(const char *path) {
+Model::Model(const char *path, Common::CpuRetention retention) : cpuRetention(retention) {
     boundingBoxMin = glm::vec3(FLT_MAX);
     boundingBoxMax = glm::vec3(-FLT_MAX);
     loadModel(std::string(path));
+    Common::logMeshMemory("Model " + std::string(path), cpuRetention, getMemoryStats());
+    Mesh::arena().logUsage("Geometry arena");
 }
 
 void Model::loadModel(std::string path) {
@@ -88,6 +169,8 @@ void Model::loadOBJ(std::string path) {
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
+    std::unordered_map<ObjVertexKey, unsigned int, ObjVertexKeyHash> vertexLookup;
+    std::vector<unsigned int> faceIndices;
     
     std::ifstream file(path);
     if (!file.is_open()) {
@@ -141,53 +224,58 @@ void Model::loadOBJ(std::string path) {
             auto parseFaceToken = [&](const std::string &face) {
                 std::stringstream ss(face);
                 std::string token;
-                int posIdx = -1, texIdx = -1, normIdx = -1;
+                ObjVertexKey key;
 
                 if (std::getline(ss, token, '/')) {
-                    if (!token.empty()) posIdx = std::stoi(token) - 1;
+                    if (!token.empty()) key.posIdx = std::stoi(token) - 1;
                 }
                 if (std::getline(ss, token, '/')) {
-                    if (!token.empty()) texIdx = std::stoi(token) - 1;
+                    if (!token.empty()) key.texIdx = std::stoi(token) - 1;
                 }
                 if (std::getline(ss, token, '/')) {
-                    if (!token.empty()) normIdx = std::stoi(token) - 1;
+                    if (!token.empty()) key.normIdx = std::stoi(token) - 1;
+                }
+
+                return key;
+            };
+
+            // Weld the corner: reuse the vertex if this (position, uv, normal) triple was seen before
+            auto weldVertex = [&](const ObjVertexKey &key) {
+                auto inserted = vertexLookup.try_emplace(key, static_cast<unsigned int>(vertices.size()));
+                if (!inserted.second) {
+                    return inserted.first->second;
                 }
 
                 Vertex vertex;
-                if (posIdx >= 0 && posIdx < static_cast<int>(positions.size())) {
-                    vertex.Position = positions[posIdx];
+                if (key.posIdx >= 0 && key.posIdx < static_cast<int>(positions.size())) {
+                    vertex.Position = positions[key.posIdx];
                 }
-                if (texIdx >= 0 && texIdx < static_cast<int>(texCoords.size())) {
-                    vertex.TexCoords = texCoords[texIdx];
+                if (key.texIdx >= 0 && key.texIdx < static_cast<int>(texCoords.size())) {
+                    vertex.TexCoords = texCoords[key.texIdx];
                 } else {
                     vertex.TexCoords = glm::vec2(0.0f);
                 }
-                if (normIdx >= 0 && normIdx < static_cast<int>(normals.size())) {
-                    vertex.Normal = normals[normIdx];
+                if (key.normIdx >= 0 && key.normIdx < static_cast<int>(normals.size())) {
+                    vertex.Normal = normals[key.normIdx];
                 } else {
                     vertex.Normal = glm::vec3(0.0f, 1.0f, 0.0f);
                 }
 
-                return vertex;
+                vertices.push_back(vertex);
+                return inserted.first->second;
             };
 
             // Parse all vertices in the face
-            std::vector<Vertex> faceVertices;
-            faceVertices.reserve(vertexTokens.size());
+            faceIndices.clear();
             for (const auto &token : vertexTokens) {
-                faceVertices.push_back(parseFaceToken(token));
+                faceIndices.push_back(weldVertex(parseFaceToken(token)));
             }
 
             // Triangulate polygon using fan method
-            for (size_t i = 1; i + 1 < faceVertices.size(); ++i) {
-                unsigned int baseIndex = vertices.size();
-                vertices.push_back(faceVertices[0]);
-                vertices.push_back(faceVertices[i]);
-                vertices.push_back(faceVertices[i + 1]);
-
-                indices.push_back(baseIndex);
-                indices.push_back(baseIndex + 1);
-                indices.push_back(baseIndex + 2);
+            for (size_t i = 1; i + 1 < faceIndices.size(); ++i) {
+                indices.push_back(faceIndices[0]);
+                indices.push_back(faceIndices[i]);
+                indices.push_back(faceIndices[i + 1]);
             }
         }
         else if (type == "mtllib") {
@@ -199,6 +287,13 @@ void Model::loadOBJ(std::string path) {
     
     file.close();
     
+    if (!vertices.empty()) {
+        // Reuse ratio: how many triangle corners each unique vertex serves on average
+        float reuseRatio = static_cast<float>(indices.size()) / static_cast<float>(vertices.size());
+        std::cout << "OBJ welded: " << indices.size() << " corners -> " << vertices.size()
+                  << " unique vertices (reuse ratio " << reuseRatio << ")" << std::endl;
+    }
+    
     // Try to load texture
     // Texture paths relative to the model file location
     std::vector<std::string> texturePaths = {
@@ -228,8 +323,10 @@ void Model::loadOBJ(std::string path) {
     }
     
     if (!vertices.empty()) {
-        Mesh mesh(vertices, indices, textures);
-        meshes.push_back(mesh);
+        Common::logMeshOptimization("OBJ mesh optimized", Common::optimizeMesh(vertices, indices));
+        std::vector<Common::MeshLod> lods = Common::buildLodChain(vertices, indices);
+        Common::logMeshLods("OBJ mesh", lods);
+        meshes.emplace_back(std::move(vertices), std::move(indices), std::move(textures), std::move(lods), cpuRetention);
     }
 }
 
@@ -288,9 +385,33 @@ unsigned int Model::TextureFromFile(const char *path, const std::string &directo
 }
 
 void Model::Draw(unsigned int shaderID) {
+    // All meshes share the arena's buffers, so one VAO bind covers them
+    glBindVertexArray(Mesh::arena().vao());
     for (unsigned int i = 0; i < meshes.size(); i++) {
         meshes[i].Draw(shaderID);
     }
+    glBindVertexArray(0);
+}
+
+Common::MeshMemoryStats Model::getMemoryStats() const {
+    Common::MeshMemoryStats stats;
+    for (const auto &mesh : meshes) {
+        stats += mesh.GetMemoryStats();
+    }
+    return stats;
+}
+
+void Model::SelectLod(const glm::vec3 &cameraPosition, float fovYDegrees, float viewportHeight, const glm::mat4 &modelMatrix) {
+    // Largest axis scale, so the error bound holds under non-uniform scaling
+    float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+                           std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+    
+    for (auto &mesh : meshes) {
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(mesh.boundsCenter, 1.0f));
+        float distance = std::max(glm::length(center - cameraPosition) - mesh.boundsRadius * scale, 0.0f);
+        float pixelsPerUnit = Common::lodPixelsPerUnit(distance, glm::radians(fovYDegrees), viewportHeight) * scale;
+        mesh.currentLod = Common::selectLod(mesh.lods, mesh.currentLod, pixelsPerUnit);
+    }
 }
 
 // Stub implementations for unused methods
@@ -6,6 +6,11 @@
 #include <vector>
 #include <string>
 
+#include "geometry_arena.hpp"
+#include "mesh_lod.hpp"
+#include "mesh_memory.hpp"
+#include "render_queue.hpp"
+
 struct Vertex {
     glm::vec3 Position;
     glm::vec3 Normal;
@@ -23,26 +28,61 @@ public:
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
     std::vector<Texture> textures;
-    unsigned int VAO;
+    std::vector<Common::MeshLod> lods;   // Index ranges into `indices`, LOD 0 first
+    std::vector<glm::vec3> positions;    // Only filled with CpuRetention::PositionsOnly
+    int currentLod = 0;
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    Common::GeometryAllocation geometry;   // Where this mesh lives in the shared arena
     
-    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
+    // Takes ownership of the arrays; pass them with std::move to avoid copies
+    Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures,
+         std::vector<Common::MeshLod> lods = {}, Common::CpuRetention retention = Common::CpuRetention::KeepAll);
+    // A mesh owns its ranges of the arena: moving hands them over, a copy would free them twice
+    ~Mesh();
+    Mesh(Mesh &&other) noexcept;
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+    Mesh &operator=(Mesh &&) = delete;
+    // Expects the arena VAO to be bound; Model::Draw binds it once for all meshes
     void Draw(unsigned int shaderID);
+    // Queue-ready draw of the selected LOD; the caller fills in the per-draw uniforms
+    Common::DrawCommand MakeDrawCommand(unsigned int program, float depth) const;
+    // Frees CPU-side arrays the retention policy does not need once the buffers are uploaded
+    void ReleaseCpuData(Common::CpuRetention retention);
+    Common::MeshMemoryStats GetMemoryStats() const;
+    
+    // Shared vertex/index buffers and VAO for every Mesh, created on first use
+    static Common::GeometryArena &arena();
     
 private:
-    unsigned int VBO, EBO;
     void setupMesh();
 };
 
 class Model {
 public:
-    Model(const char *path);
+    Model(const char *path, Common::CpuRetention retention = Common::CpuRetention::KeepAll);
     void Draw(unsigned int shaderID);
+    // Submits every mesh to the render queue with the same per-draw uniforms
+    template <typename T>
+    void Submit(Common::RenderQueue &queue, unsigned int program, float depth, void (*applyUniforms)(const void *), const T &uniforms) const {
+        for (const auto &mesh : meshes) {
+            Common::DrawCommand command = mesh.MakeDrawCommand(program, depth);
+            command.applyUniforms = applyUniforms;
+            queue.submit(command, uniforms);
+        }
+    }
+    // Picks each mesh's LOD from its projected screen-space error for the given camera
+    void SelectLod(const glm::vec3 &cameraPosition, float fovYDegrees, float viewportHeight, const glm::mat4 &modelMatrix);
     glm::vec3 getBoundingBoxMin() const { return boundingBoxMin; }
     glm::vec3 getBoundingBoxMax() const { return boundingBoxMax; }
+    // Resident CPU and GPU memory summed over all meshes
+    Common::MeshMemoryStats getMemoryStats() const;
     
 private:
     std::vector<Mesh> meshes;
     std::string directory;
+    Common::CpuRetention cpuRetention;
     glm::vec3 boundingBoxMin;
     glm::vec3 boundingBoxMax;
     
@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec3 Color;
+
+#include "frame_data.glsl"
+
+void main()
+{
+    // Ambient
+    vec3 ambient = 0.3 * lightColor;
+    
+    // Diffuse
+    vec3 norm = normalize(Normal);
+    vec3 lightDir = normalize(lightPos - FragPos);
+    float diff = max(dot(norm, lightDir), 0.0);
+    vec3 diffuse = diff * lightColor;
+    
+    // Specular
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 reflectDir = reflect(-lightDir, norm);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32.0);
+    vec3 specular = 0.5 * spec * lightColor;
+    
+    vec3 result = (ambient + diffuse + specular) * Color;
+    FragColor = vec4(result, 1.0);
+}
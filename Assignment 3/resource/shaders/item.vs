@@ -0,0 +1,30 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+// Per instance, from the item instance buffer
+layout (location = 3) in vec3 aOffset;
+layout (location = 4) in vec3 aColor;
+
+#include "frame_data.glsl"
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+void main()
+{
+    // Items spin about their own Y axis at 0.5 rad/s
+    float angle = time * 0.5;
+    float s = sin(angle);
+    float c = cos(angle);
+    mat3 spin = mat3(c, 0.0, -s,
+                     0.0, 1.0, 0.0,
+                     s, 0.0, c);
+
+    FragPos = spin * aPos + aOffset;
+    Normal = spin * aNormal;
+    Color = aColor;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
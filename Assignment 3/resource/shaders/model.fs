@@ -5,10 +5,9 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
 
+#include "frame_data.glsl"
+
 uniform sampler2D texture_diffuse1;
-uniform vec3 lightPos;
-uniform vec3 lightColor;
-uniform vec3 viewPos;
 uniform bool useTexture;
 uniform vec3 objectColor;
 
@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+
+#include "static_draw.glsl"
+#include "frame_data.glsl"
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec3 Color;
+
+void main()
+{
+    // Model matrix and color come from this draw's entry in the static batch
+    mat4 model = draws[aDrawID].model;
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    Color = draws[aDrawID].color.rgb;
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+}
@@ -2,6 +2,10 @@
 
 
 
+#include "frame_data.glsl"
+
+
+
 out vec4 FragColor;
 
 in vec2 TexCoords;
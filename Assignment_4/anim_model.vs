@@ -18,11 +18,9 @@ layout(location = 6) in vec4 weights;
 
 
 
-uniform mat4 projection;
+#include "frame_data.glsl"
 
-uniform mat4 view;
-
-uniform mat4 model;
+#include "static_draw.glsl"
 
 
 
@@ -30,7 +28,15 @@ const int MAX_BONES = 100;
 
 const int MAX_BONE_INFLUENCE = 4;
 
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// written per frame into a ring buffer and bound with glBindBufferRange
+
+layout(std140) uniform BonePalette
+
+{
+
+    mat4 finalBonesMatrices[MAX_BONES];
+
+};
 
 
 
@@ -72,7 +78,7 @@ void main()
 
 	
 
-    mat4 viewModel = view * model;
+    mat4 viewModel = view * draws[aDrawID].model;
 
     gl_Position =  projection * viewModel * totalPosition;
 
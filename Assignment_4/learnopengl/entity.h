@@ -5,6 +5,13 @@
 #include <list> //std::list
 #include <array> //std::array
 #include <memory> //std::unique_ptr
+#include <vector> //std::vector
+
+#include "occlusion_culler.hpp" //Common::OcclusionCuller
+#include "bvh.hpp" //Common::Bvh
+#include "frustum_culler.hpp" //Common::BoundsSoA, Common::cullFrustum
+#include "entity_registry.hpp" //Common::EntityRegistry
+#include "render_queue.hpp" //Common::GLStateCache
 
 class Transform
 {
@@ -348,16 +355,14 @@ AABB generateAABB(const Model& model)
 	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
 	for (auto&& mesh : model.meshes)
 	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+		// bounds are computed at upload so they survive the mesh releasing its vertices
+		minAABB.x = std::min(minAABB.x, mesh.boundsMin.x);
+		minAABB.y = std::min(minAABB.y, mesh.boundsMin.y);
+		minAABB.z = std::min(minAABB.z, mesh.boundsMin.z);
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
+		maxAABB.x = std::max(maxAABB.x, mesh.boundsMax.x);
+		maxAABB.y = std::max(maxAABB.y, mesh.boundsMax.y);
+		maxAABB.z = std::max(maxAABB.z, mesh.boundsMax.z);
 	}
 	return AABB(minAABB, maxAABB);
 }
@@ -368,16 +373,14 @@ Sphere generateSphereBV(const Model& model)
 	glm::vec3 maxAABB = glm::vec3(std::numeric_limits<float>::min());
 	for (auto&& mesh : model.meshes)
 	{
-		for (auto&& vertex : mesh.vertices)
-		{
-			minAABB.x = std::min(minAABB.x, vertex.Position.x);
-			minAABB.y = std::min(minAABB.y, vertex.Position.y);
-			minAABB.z = std::min(minAABB.z, vertex.Position.z);
+		// bounds are computed at upload so they survive the mesh releasing its vertices
+		minAABB.x = std::min(minAABB.x, mesh.boundsMin.x);
+		minAABB.y = std::min(minAABB.y, mesh.boundsMin.y);
+		minAABB.z = std::min(minAABB.z, mesh.boundsMin.z);
 
-			maxAABB.x = std::max(maxAABB.x, vertex.Position.x);
-			maxAABB.y = std::max(maxAABB.y, vertex.Position.y);
-			maxAABB.z = std::max(maxAABB.z, vertex.Position.z);
-		}
+		maxAABB.x = std::max(maxAABB.x, mesh.boundsMax.x);
+		maxAABB.y = std::max(maxAABB.y, mesh.boundsMax.y);
+		maxAABB.z = std::max(maxAABB.z, mesh.boundsMax.z);
 	}
 
 	return Sphere((maxAABB + minAABB) * 0.5f, glm::length(minAABB - maxAABB));
@@ -466,20 +469,357 @@ public:
 	}
 
 
-	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, unsigned int& display, unsigned int& total)
+	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
 	{
 		if (boundingVolume->isOnFrustum(frustum, transform))
 		{
 			ourShader.setMat4("model", transform.getModelMatrix());
-			pModel->Draw(ourShader);
+			pModel->Draw(ourShader, glState);
 			display++;
 		}
 		total++;
 
 		for (auto&& child : children)
 		{
-			child->drawSelfAndChild(frustum, ourShader, display, total);
+			child->drawSelfAndChild(frustum, ourShader, glState, display, total);
 		}
 	}
+
+	//Frustum test first, then the software occlusion buffer. Call occlusion.beginFrame() with the camera's
+	//view-projection early in the frame so the occluders are rasterized on its worker meanwhile.
+	void drawSelfAndChild(const Frustum& frustum, Common::OcclusionCuller& occlusion, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
+	{
+		if (boundingVolume->isOnFrustum(frustum, transform))
+		{
+			const AABB globalAABB = getGlobalAABB();
+			if (occlusion.isVisible(globalAABB.center - globalAABB.extents, globalAABB.center + globalAABB.extents))
+			{
+				ourShader.setMat4("model", transform.getModelMatrix());
+				pModel->Draw(ourShader, glState);
+				display++;
+			}
+		}
+		total++;
+
+		for (auto&& child : children)
+		{
+			child->drawSelfAndChild(frustum, occlusion, ourShader, glState, display, total);
+		}
+	}
+
+	//Registers the entity's bounds as an occluder; for solid entities such as walls and buildings
+	size_t addAsOccluder(Common::OcclusionCuller& occlusion) const
+	{
+		const AABB& local = *boundingVolume;
+		return occlusion.addBoxOccluder(local.center - local.extents, local.center + local.extents, transform.getModelMatrix());
+	}
 };
+
+//Same frustum in the plane form the common culling code uses
+inline Common::FrustumPlanes toFrustumPlanes(const Frustum& frustum)
+{
+	Common::FrustumPlanes planes;
+	const Plane* faces[Common::FrustumPlanes::Count] = { &frustum.leftFace, &frustum.rightFace, &frustum.bottomFace,
+		&frustum.topFace, &frustum.nearFace, &frustum.farFace };
+	for (int i = 0; i < Common::FrustumPlanes::Count; i++)
+	{
+		planes.planes[i] = glm::vec4(faces[i]->normal, -faces[i]->distance);
+	}
+	return planes;
+}
+
+//Flat bounding volume hierarchy over a scene graph, for scenes too large to walk entity by entity.
+//Call refit() after updateSelfAndChild(): only entities that moved touch the tree, and it is rebuilt
+//when moving things have let it degrade. drawVisible() then only visits subtrees the frustum reaches.
+class EntityBvh
+{
+public:
+	//Registers the entity and all of its children
+	void add(Entity& entity)
+	{
+		proxies.push_back(bvh.insert(globalBounds(entity), static_cast<uint32_t>(entities.size())));
+		entities.push_back(&entity);
+		models.push_back(entity.transform.getModelMatrix());
+
+		for (auto&& child : entity.children)
+		{
+			add(*child);
+		}
+	}
+
+	//Moves the leaves of entities whose model matrix changed since the last refit; the rest only
+	//cost a matrix compare
+	void refit()
+	{
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const glm::mat4& model = entities[i]->transform.getModelMatrix();
+			if (model != models[i])
+			{
+				models[i] = model;
+				bvh.update(proxies[i], globalBounds(*entities[i]));
+			}
+		}
+		bvh.optimize();
+	}
+
+	void drawVisible(const Frustum& frustum, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
+	{
+		bvh.queryFrustum(toFrustumPlanes(frustum), [&](uint32_t item)
+		{
+			Entity& entity = *entities[item];
+			ourShader.setMat4("model", entity.transform.getModelMatrix());
+			entity.pModel->Draw(ourShader, glState);
+			display++;
+		});
+		total += static_cast<unsigned int>(entities.size());
+	}
+
+	const Common::Bvh& tree() const { return bvh; }
+	Entity& entity(uint32_t item) { return *entities[item]; }
+
+private:
+	Common::Bvh bvh;
+	std::vector<Entity*> entities;
+	std::vector<int> proxies;
+	std::vector<glm::mat4> models; //Model matrix each leaf was last fitted to
+
+	static Common::Bounds globalBounds(Entity& entity)
+	{
+		const AABB globalAABB = entity.getGlobalAABB();
+		return Common::Bounds(globalAABB.center - globalAABB.extents, globalAABB.center + globalAABB.extents);
+	}
+};
+
+//Batched culling for flat crowds of entities: world boxes are kept as structure-of-arrays and tested
+//8 at a time against planes taken from the view-projection matrix, instead of one virtual
+//isOnFrustum() per entity. Call update() after updateSelfAndChild().
+class EntityCuller
+{
+public:
+	//Optional pool: large crowds are culled on its threads
+	explicit EntityCuller(Common::TaskPool* pool = nullptr) : pool{ pool } {}
+
+	//Registers the entity and all of its children
+	void add(Entity& entity)
+	{
+		entities.push_back(&entity);
+		models.push_back(entity.transform.getModelMatrix());
+		bounds.push_back(globalBounds(entity));
+
+		for (auto&& child : entity.children)
+		{
+			add(*child);
+		}
+	}
+
+	//Recomputes world boxes of the entities whose model matrix changed
+	void update()
+	{
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const glm::mat4& model = entities[i]->transform.getModelMatrix();
+			if (model != models[i])
+			{
+				models[i] = model;
+				bounds.set(i, globalBounds(*entities[i]));
+			}
+		}
+	}
+
+	void drawVisible(const glm::mat4& viewProjection, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
+	{
+		const Common::FrustumPlanes frustum = Common::extractFrustumPlanes(viewProjection);
+		display += static_cast<unsigned int>(Common::cullFrustum(frustum, bounds, mask, pool));
+		total += static_cast<unsigned int>(entities.size());
+
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			//Skip 32 culled entities at a time
+			if (mask[i >> 5] == 0)
+			{
+				i |= 31;
+				continue;
+			}
+			if (Common::isVisible(mask, i))
+			{
+				ourShader.setMat4("model", models[i]);
+				entities[i]->pModel->Draw(ourShader, glState);
+			}
+		}
+	}
+
+	const std::vector<uint32_t>& visibility() const { return mask; }
+
+private:
+	Common::TaskPool* pool;
+	std::vector<Entity*> entities;
+	std::vector<glm::mat4> models;
+	Common::BoundsSoA bounds;
+	std::vector<uint32_t> mask;
+
+	static Common::Bounds globalBounds(Entity& entity)
+	{
+		const AABB& local = *entity.boundingVolume;
+		return Common::transformBounds(Common::Bounds(local.center - local.extents, local.center + local.extents), entity.transform.getModelMatrix());
+	}
+};
+
+//Entities stored in a Common::EntityRegistry (dense arrays, parents before children) instead of a
+//pointer tree. EntityScene owns the registry and the table of models the render components refer to;
+//SceneEntity is a small handle with the Entity and Transform calls existing code uses, so scenes can
+//migrate call site by call site. import() copies an existing Entity tree.
+class SceneEntity;
+
+class EntityScene
+{
+public:
+	Common::EntityRegistry registry;
+	std::vector<Model*> models;
+	//Optional: spreads culling and each depth level of the transform update over the pool's threads
+	Common::TaskPool* pool = nullptr;
+
+	SceneEntity create(Model& model, Common::EntityHandle parent = Common::EntityRegistry::Null);
+	SceneEntity import(const Entity& entity, Common::EntityHandle parent = Common::EntityRegistry::Null);
+
+	//Recomputes world matrices of moved entities and their children
+	void update()
+	{
+		registry.updateTransforms(pool);
+	}
+
+	//Culls every entity in one batch and draws the visible ones
+	void draw(const glm::mat4& viewProjection, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
+	{
+		display += static_cast<unsigned int>(Common::cullFrustum(Common::extractFrustumPlanes(viewProjection), registry.worldBounds(), mask, pool));
+		total += static_cast<unsigned int>(registry.size());
+		registry.eachVisible(mask, [&](uint32_t, const glm::mat4& world, const Common::RenderComponent& render)
+		{
+			ourShader.setMat4("model", world);
+			models[render.mesh]->Draw(ourShader, glState);
+		});
+	}
+
+	const std::vector<uint32_t>& visibility() const { return mask; }
+
+private:
+	std::vector<uint32_t> mask;
+	std::vector<uint8_t> subtree;
+
+	friend class SceneEntity;
+
+	uint32_t modelId(Model& model)
+	{
+		for (size_t i = 0; i < models.size(); i++)
+		{
+			if (models[i] == &model)
+				return static_cast<uint32_t>(i);
+		}
+		models.push_back(&model);
+		return static_cast<uint32_t>(models.size() - 1);
+	}
+};
+
+class SceneEntity
+{
+public:
+	SceneEntity(EntityScene& scene, Common::EntityHandle handle) : scene{ &scene }, entity{ handle } {}
+
+	Common::EntityHandle handle() const { return entity; }
+	bool alive() const { return scene->registry.alive(entity); }
+
+	//Transform
+	void setLocalPosition(const glm::vec3& newPosition) { scene->registry.editTransform(entity).position = newPosition; }
+	void setLocalRotation(const glm::vec3& newRotation) { scene->registry.editTransform(entity).rotation = newRotation; }
+	void setLocalScale(const glm::vec3& newScale) { scene->registry.editTransform(entity).scale = newScale; }
+	const glm::vec3& getLocalPosition() const { return scene->registry.transform(entity).position; }
+	const glm::vec3& getLocalRotation() const { return scene->registry.transform(entity).rotation; }
+	const glm::vec3& getLocalScale() const { return scene->registry.transform(entity).scale; }
+	const glm::mat4& getModelMatrix() const { return scene->registry.world(entity); }
+	glm::vec3 getGlobalPosition() const { return scene->registry.world(entity)[3]; }
+
+	//Scene graph
+	SceneEntity addChild(Model& model)
+	{
+		return scene->create(model, entity);
+	}
+
+	void destroy()
+	{
+		scene->registry.destroy(entity);
+	}
+
+	//Updates the whole scene, which only touches entities that moved
+	void updateSelfAndChild()
+	{
+		scene->update();
+	}
+
+	void drawSelfAndChild(const Frustum& frustum, Shader& ourShader, Common::GLStateCache& glState, unsigned int& display, unsigned int& total)
+	{
+		Common::EntityRegistry& registry = scene->registry;
+		std::vector<uint32_t>& mask = scene->mask;
+		std::vector<uint8_t>& subtree = scene->subtree;
+		//setParent() and destroy() leave the dense order stale until a flush, and the subtree pass
+		//below needs parents first; a no-op when nothing changed since updateSelfAndChild()
+		registry.flush();
+		Common::cullFrustum(toFrustumPlanes(frustum), registry.worldBounds(), mask);
+
+		//Parents come first, so one forward pass marks the whole subtree
+		const std::vector<uint32_t>& parents = registry.parents();
+		const uint32_t root = registry.index(entity);
+		subtree.assign(registry.denseSize(), 0);
+		subtree[root] = 1;
+		for (uint32_t i = root + 1; i < subtree.size(); i++)
+		{
+			subtree[i] = parents[i] != Common::EntityRegistry::NoParent && subtree[parents[i]];
+		}
+
+		for (uint32_t i = root; i < subtree.size(); i++)
+		{
+			if (!subtree[i] || !(registry.components()[i] & Common::EntityRegistry::Alive))
+				continue;
+			total++;
+			const Common::RenderComponent* render = registry.render(registry.handle(i));
+			if (render && Common::isVisible(mask, i))
+			{
+				ourShader.setMat4("model", registry.worldMatrices()[i]);
+				scene->models[render->mesh]->Draw(ourShader, glState);
+				display++;
+			}
+		}
+	}
+
+private:
+	EntityScene* scene;
+	Common::EntityHandle entity;
+};
+
+inline SceneEntity EntityScene::create(Model& model, Common::EntityHandle parent)
+{
+	const Common::EntityHandle entity = registry.create(parent);
+	if (entity == Common::EntityRegistry::Null)
+		return SceneEntity(*this, entity);
+
+	const AABB local = generateAABB(model);
+	registry.setLocalBounds(entity, Common::Bounds(local.center - local.extents, local.center + local.extents));
+	Common::RenderComponent render;
+	render.mesh = modelId(model);
+	registry.setRender(entity, render);
+	return SceneEntity(*this, entity);
+}
+
+inline SceneEntity EntityScene::import(const Entity& source, Common::EntityHandle parent)
+{
+	SceneEntity entity = create(*source.pModel, parent);
+	entity.setLocalPosition(source.transform.getLocalPosition());
+	entity.setLocalRotation(source.transform.getLocalRotation());
+	entity.setLocalScale(source.transform.getLocalScale());
+
+	for (auto&& child : source.children)
+	{
+		import(*child, entity.handle());
+	}
+	return entity;
+}
 #endif
@@ -7,7 +7,13 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include "geometry_arena.hpp"
+#include "mesh_lod.hpp"
+#include "mesh_memory.hpp"
+#include "render_queue.hpp"
 
+#include <algorithm>
+#include <cfloat>
 #include <string>
 #include <vector>
 using namespace std;
@@ -37,110 +43,235 @@ struct Texture {
     string path;
 };
 
+// sampler bindings of one mesh, built at load time. every texture type owns a fixed range of
+// units (diffuse N -> unit N-1, specular N -> 4+N-1, ...), so a sampler uniform always means the
+// same unit for every mesh and only has to be assigned once per shader program.
+class Material {
+public:
+    static const unsigned int SlotsPerType = 4;
+    static_assert(4 * SlotsPerType <= Common::GLStateCache::MaxTextureUnits, "every unit must be tracked by the state cache");
+
+    struct Binding {
+        unsigned int unit;
+        unsigned int texture;
+        string sampler;     // e.g. texture_diffuse1
+    };
+    vector<Binding> bindings;
+
+    Material() = default;
+    explicit Material(const vector<Texture>& textures)
+    {
+        static const char* types[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+        unsigned int counts[4] = { 0, 0, 0, 0 };
+        for (const Texture& texture : textures)
+        {
+            unsigned int type = 0;
+            while (type < 4 && texture.type != types[type])
+                type++;
+            if (type == 4 || counts[type] == SlotsPerType)
+            {
+                cout << "Material: no texture unit for " << texture.type << " '" << texture.path << "', skipped" << endl;
+                continue;
+            }
+            unsigned int number = counts[type]++;
+            bindings.push_back({ type * SlotsPerType + number, texture.id, types[type] + std::to_string(number + 1) });
+        }
+    }
+
+    // points the program's sampler uniforms at this material's units; a no-op after the first call per program
+    void Resolve(const Shader& shader)
+    {
+        if (resolvedProgram == shader.ID)
+            return;
+        for (const Binding& binding : bindings)
+        {
+            GLint location = shader.location(binding.sampler);
+            if (location >= 0)
+                glUniform1i(location, (GLint)binding.unit);
+        }
+        resolvedProgram = shader.ID;
+    }
+
+    // binds the textures through the state cache, which skips units that already hold the right one
+    void Bind(Common::GLStateCache& state) const
+    {
+        for (const Binding& binding : bindings)
+            state.bindTexture(binding.unit, binding.texture);
+    }
+
+private:
+    unsigned int resolvedProgram = 0;
+};
+
+// shared buffers for every Mesh, created on first use once a GL context exists.
+// all meshes share its VAO and are drawn by base vertex and first index.
+inline Common::GeometryArena& MeshArena()
+{
+    static Common::GeometryArena arena(Common::VertexFormat{ sizeof(Vertex), {
+        { 0, 3, GL_FLOAT, offsetof(Vertex, Position) },
+        { 1, 3, GL_FLOAT, offsetof(Vertex, Normal) },
+        { 2, 2, GL_FLOAT, offsetof(Vertex, TexCoords) },
+        { 3, 3, GL_FLOAT, offsetof(Vertex, Tangent) },
+        { 4, 3, GL_FLOAT, offsetof(Vertex, Bitangent) },
+        { 5, 4, GL_INT, offsetof(Vertex, m_BoneIDs), true },
+        { 6, 4, GL_FLOAT, offsetof(Vertex, m_Weights) } } });
+    return arena;
+}
+
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
     vector<Texture>      textures;
-    unsigned int VAO;
+    Material             material;  // sampler bindings resolved from textures
+    vector<Common::MeshLod> lods;   // index ranges into indices, LOD 0 first
+    vector<glm::vec3>    positions; // only filled with CpuRetention::PositionsOnly, vertices is released then
+    int currentLod = 0;
+    glm::vec3 boundsMin, boundsMax; // bind pose bounds, valid whatever the retention policy
+    glm::vec3 boundsCenter;
+    float boundsRadius;
+    Common::GeometryAllocation geometry;    // where this mesh lives in MeshArena()
+    unsigned int VAO;                       // the arena's VAO, shared by all meshes
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor, takes ownership of the arrays: pass them with std::move to avoid copying
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, vector<Common::MeshLod> lods = {},
+         Common::CpuRetention retention = Common::CpuRetention::KeepAll)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), lods(std::move(lods))
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        material = Material(this->textures);
+        if (this->lods.empty())
+            this->lods.push_back({ 0, static_cast<unsigned int>(this->indices.size()), 0.0f });
+
+        // bind pose bounding box and sphere, used for culling and LOD distance
+        boundsMin = glm::vec3(FLT_MAX);
+        boundsMax = glm::vec3(-FLT_MAX);
+        for (const Vertex& vertex : this->vertices)
+        {
+            boundsMin = glm::min(boundsMin, vertex.Position);
+            boundsMax = glm::max(boundsMax, vertex.Position);
+        }
+        if (this->vertices.empty())
+            boundsMin = boundsMax = glm::vec3(0.0f);
+        boundsCenter = (boundsMin + boundsMax) * 0.5f;
+        boundsRadius = glm::length(boundsMax - boundsMin) * 0.5f;
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
+
+        // the GPU has its own copy now, drop whatever the policy says we don't need
+        ReleaseCpuData(retention);
     }
 
-    // render the mesh
-    void Draw(Shader &shader) 
+    // hands the mesh's ranges back to the arena so later loads can reuse them; the arena's
+    // buffers themselves live until exit
+    ~Mesh()
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        if (geometry.valid())
+            MeshArena().free(geometry);
+    }
+
+    // a mesh owns its ranges of the arena: moving hands them over, a copy would free them twice
+    Mesh(Mesh&& other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)), textures(std::move(other.textures)),
+          material(std::move(other.material)), lods(std::move(other.lods)), positions(std::move(other.positions)),
+          currentLod(other.currentLod), boundsMin(other.boundsMin), boundsMax(other.boundsMax), boundsCenter(other.boundsCenter),
+          boundsRadius(other.boundsRadius), geometry(other.geometry), VAO(other.VAO)
+    {
+        other.geometry = Common::GeometryAllocation();
+    }
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh& operator=(Mesh&&) = delete;
+
+    // frees CPU-side arrays after upload; only ever narrows what is kept
+    void ReleaseCpuData(Common::CpuRetention retention)
+    {
+        if (retention == Common::CpuRetention::KeepAll)
+            return;
+
+        if (retention == Common::CpuRetention::PositionsOnly && !vertices.empty())
+        {
+            positions.reserve(vertices.size());
+            for (const Vertex& vertex : vertices)
+                positions.push_back(vertex.Position);
+        }
+        else if (retention == Common::CpuRetention::None)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-             else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            Common::releaseVector(positions);
+            Common::releaseVector(indices);
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        Common::releaseVector(vertices);
     }
 
-private:
-    // render data 
-    unsigned int VBO, EBO;
+    // heap and buffer memory currently held by this mesh
+    Common::MeshMemoryStats GetMemoryStats() const
+    {
+        Common::MeshMemoryStats stats;
+        stats.cpuBytes = Common::vectorBytes(vertices) + Common::vectorBytes(indices) + Common::vectorBytes(positions)
+            + Common::vectorBytes(textures) + Common::vectorBytes(lods);
+        stats.gpuBytes = geometry.vertexCount * sizeof(Vertex) + geometry.indexCount * sizeof(unsigned int);
+        stats.meshCount = 1;
+        return stats;
+    }
 
-    // initializes all the buffer objects/arrays
+    // render the mesh, expects the arena VAO to be bound (Model::Draw binds it once for all meshes)
+    void Draw(Shader &shader, Common::GLStateCache& state) 
+    {
+        // assign sampler units once per program, then bind only textures that changed
+        material.Resolve(shader);
+        material.Bind(state);
+
+        // draw mesh at the selected level of detail, LOD offsets are relative to the mesh's first index
+        const Common::MeshLod& lod = lods[currentLod];
+        glDrawElementsBaseVertex(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_INT,
+            (void*)((geometry.firstIndex + lod.indexOffset) * sizeof(unsigned int)), geometry.baseVertex);
+    }
+
+    // queued form of Draw for Common::RenderQueue; the material must already be resolved for the program
+    Common::DrawCommand MakeDrawCommand(unsigned int program, float depth) const
+    {
+        unsigned int materialKey = material.bindings.empty() ? 0 : material.bindings[0].texture;
+        const Common::MeshLod& lod = lods[currentLod];
+
+        Common::DrawCommand command;
+        command.sortKey = Common::makeSortKey(Common::RenderPass::Opaque, program, materialKey, VAO, depth);
+        command.program = program;
+        command.vertexArray = VAO;
+        for (const Material::Binding& binding : material.bindings)
+            command.textures[binding.unit] = binding.texture;
+        command.indexType = GL_UNSIGNED_INT;
+        command.count = (GLsizei)lod.indexCount;
+        command.first = (GLint)(geometry.firstIndex + lod.indexOffset);
+        command.baseVertex = (GLint)geometry.baseVertex;
+        return command;
+    }
+
+    // assigns the sampler units for a program without drawing, expects the program to be in use
+    void ResolveMaterial(const Shader &shader)
+    {
+        material.Resolve(shader);
+    }
+
+    // pick the LOD from its projected screen-space error; scale is the largest axis scale of the model matrix
+    void SelectLod(const glm::vec3& cameraPosition, float fovYRadians, float viewportHeight, const glm::mat4& modelMatrix, float scale)
+    {
+        glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.0f));
+        float distance = std::max(glm::length(center - cameraPosition) - boundsRadius * scale, 0.0f);
+        float pixelsPerUnit = Common::lodPixelsPerUnit(distance, fovYRadians, viewportHeight) * scale;
+        currentLod = Common::selectLod(lods, currentLod, pixelsPerUnit);
+    }
+
+private:
+    // copies the vertex and index data into the shared arena
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        Common::GeometryArena& arena = MeshArena();
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        geometry = arena.allocate(vertices.data(), vertices.size(), indices.data(), indices.size());
+        VAO = arena.vao();
     }
 };
 #endif
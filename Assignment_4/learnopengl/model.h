@@ -12,6 +12,8 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include "mesh_optimizer.hpp"
+#include "static_batch.hpp"
 
 #include <string>
 #include <fstream>
@@ -29,20 +31,77 @@ public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    vector<size_t>  batchHandles;   // one per mesh after AddToBatch
     string directory;
     bool gammaCorrection;
+    Common::CpuRetention cpuRetention;  // what each mesh keeps in system memory after upload
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, Common::CpuRetention retention = Common::CpuRetention::KeepAll)
+        : gammaCorrection(gamma), cpuRetention(retention)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // draws the model, and thus all its meshes; VAO and texture binds go through the state cache
+    void Draw(Shader &shader, Common::GLStateCache& state)
     {
+        // every mesh lives in the same arena, so one VAO bind covers them all
+        state.bindVertexArray(MeshArena().vao());
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, state);
+    }
+
+    // queues every mesh with the same per-draw uniforms, see Common::RenderQueue::submit
+    template <typename T>
+    void Submit(Common::RenderQueue& queue, unsigned int program, float depth, void (*applyUniforms)(const void*), const T& uniforms) const
+    {
+        for (const Mesh& mesh : meshes)
+        {
+            Common::DrawCommand command = mesh.MakeDrawCommand(program, depth);
+            command.applyUniforms = applyUniforms;
+            queue.submit(command, uniforms);
+        }
+    }
+
+    // points the program's samplers at each mesh's units ahead of Submit, expects the program to be in use
+    void ResolveMaterials(const Shader &shader)
+    {
+        for (Mesh& mesh : meshes)
+            mesh.ResolveMaterial(shader);
+    }
+
+    // adds every mesh to a static batch at its current LOD; call UpdateBatch after SelectLod to follow LOD switches
+    void AddToBatch(Common::StaticBatch& batch, const glm::mat4& modelMatrix)
+    {
+        batchHandles.clear();
+        for (const Mesh& mesh : meshes)
+            batchHandles.push_back(batch.add(mesh.MakeDrawCommand(0, 0.0f), { modelMatrix, glm::vec4(1.0f) }));
+    }
+
+    // pushes the selected LOD ranges into the batch; only ranges that changed rewrite its command list
+    void UpdateBatch(Common::StaticBatch& batch) const
+    {
+        for (size_t i = 0; i < batchHandles.size(); i++)
+            batch.setRange(batchHandles[i], meshes[i].MakeDrawCommand(0, 0.0f));
+    }
+
+    // picks each mesh's LOD from its projected screen-space error for the given camera
+    void SelectLod(const glm::vec3& cameraPosition, float fovYDegrees, float viewportHeight, const glm::mat4& modelMatrix)
+    {
+        float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+            std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+        for (auto& mesh : meshes)
+            mesh.SelectLod(cameraPosition, glm::radians(fovYDegrees), viewportHeight, modelMatrix, scale);
+    }
+
+    // resident CPU and GPU memory summed over all meshes
+    Common::MeshMemoryStats GetMemoryStats() const
+    {
+        Common::MeshMemoryStats stats;
+        for (const Mesh& mesh : meshes)
+            stats += mesh.GetMemoryStats();
+        return stats;
     }
     
 private:
@@ -63,6 +122,8 @@ private:
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+        Common::logMeshMemory("Model " + path, cpuRetention, GetMemoryStats());
+        MeshArena().logUsage("Geometry arena");
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -164,8 +225,15 @@ private:
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
+        // reorder triangles and vertices for the post-transform cache, overdraw and vertex fetch
+        Common::logMeshOptimization("Mesh optimized", Common::optimizeMesh(vertices, indices));
+
+        // generate coarser levels of detail into the same index buffer
+        vector<Common::MeshLod> lods = Common::buildLodChain(vertices, indices);
+        Common::logMeshLods("Mesh", lods);
+
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(std::move(vertices), std::move(indices), std::move(textures), std::move(lods), cpuRetention);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
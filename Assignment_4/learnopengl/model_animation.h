@@ -12,6 +12,8 @@
 
 #include <learnopengl/mesh.h>
 #include <learnopengl/shader.h>
+#include "mesh_optimizer.hpp"
+#include "static_batch.hpp"
 
 #include <string>
 #include <fstream>
@@ -51,23 +53,80 @@ public:
     // model data 
     vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
     vector<Mesh>    meshes;
+    vector<size_t>  batchHandles;   // one per mesh after AddToBatch
     string directory;
     bool gammaCorrection;
+    Common::CpuRetention cpuRetention;  // what each mesh keeps in system memory after upload
 	
 	
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, Common::CpuRetention retention = Common::CpuRetention::KeepAll)
+        : gammaCorrection(gamma), cpuRetention(retention)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
-    void Draw(Shader &shader)
+    // draws the model, and thus all its meshes; VAO and texture binds go through the state cache
+    void Draw(Shader &shader, Common::GLStateCache& state)
     {
+        // every mesh lives in the same arena, so one VAO bind covers them all
+        state.bindVertexArray(MeshArena().vao());
         for(unsigned int i = 0; i < meshes.size(); i++)
-            meshes[i].Draw(shader);
+            meshes[i].Draw(shader, state);
     }
+
+	// queues every mesh with the same per-draw uniforms, see Common::RenderQueue::submit
+	template <typename T>
+	void Submit(Common::RenderQueue& queue, unsigned int program, float depth, void (*applyUniforms)(const void*), const T& uniforms) const
+	{
+		for (const Mesh& mesh : meshes)
+		{
+			Common::DrawCommand command = mesh.MakeDrawCommand(program, depth);
+			command.applyUniforms = applyUniforms;
+			queue.submit(command, uniforms);
+		}
+	}
+
+	// points the program's samplers at each mesh's units ahead of Submit, expects the program to be in use
+	void ResolveMaterials(const Shader &shader)
+	{
+		for (Mesh& mesh : meshes)
+			mesh.ResolveMaterial(shader);
+	}
+
+	// adds every mesh to a static batch at its current LOD; call UpdateBatch after SelectLod to follow LOD switches
+	void AddToBatch(Common::StaticBatch& batch, const glm::mat4& modelMatrix)
+	{
+		batchHandles.clear();
+		for (const Mesh& mesh : meshes)
+			batchHandles.push_back(batch.add(mesh.MakeDrawCommand(0, 0.0f), { modelMatrix, glm::vec4(1.0f) }));
+	}
+
+	// pushes the selected LOD ranges into the batch; only ranges that changed rewrite its command list
+	void UpdateBatch(Common::StaticBatch& batch) const
+	{
+		for (size_t i = 0; i < batchHandles.size(); i++)
+			batch.setRange(batchHandles[i], meshes[i].MakeDrawCommand(0, 0.0f));
+	}
+
+	// picks each mesh's LOD from its projected screen-space error for the given camera
+	void SelectLod(const glm::vec3& cameraPosition, float fovYDegrees, float viewportHeight, const glm::mat4& modelMatrix)
+	{
+		float scale = std::max(glm::length(glm::vec3(modelMatrix[0])),
+			std::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+		for (auto& mesh : meshes)
+			mesh.SelectLod(cameraPosition, glm::radians(fovYDegrees), viewportHeight, modelMatrix, scale);
+	}
+
+	// resident CPU and GPU memory summed over all meshes
+	Common::MeshMemoryStats GetMemoryStats() const
+	{
+		Common::MeshMemoryStats stats;
+		for (const Mesh& mesh : meshes)
+			stats += mesh.GetMemoryStats();
+		return stats;
+	}
     
 	auto& GetBoneInfoMap() { return m_BoneInfoMap; }
 	int& GetBoneCount() { return m_BoneCounter; }
@@ -98,6 +157,8 @@ private:
         // process ASSIMP's root node recursively
         std::cout << "  loadModel: Processing nodes..." << std::endl;
         processNode(scene->mRootNode, scene);
+        Common::logMeshMemory("  loadModel: resident memory", cpuRetention, GetMemoryStats());
+        MeshArena().logUsage("  loadModel: geometry arena");
         std::cout << "  loadModel: Done" << std::endl;
     }
 
@@ -175,7 +236,29 @@ private:
 
 		ExtractBoneWeightForVertices(vertices,mesh,scene);
 
-		return Mesh(vertices, indices, textures);
+		// reorder for the post-transform cache only after bone weights are attached, they address assimp's vertex order
+		Common::logMeshOptimization("    processMesh: optimized", Common::optimizeMesh(vertices, indices));
+
+		// simplify only between vertices driven by the same dominant bone so skinning stays intact
+		vector<unsigned int> dominantBones(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			int bone = -1;
+			float weight = 0.0f;
+			for (int j = 0; j < MAX_BONE_INFLUENCE; j++)
+			{
+				if (vertices[i].m_BoneIDs[j] >= 0 && vertices[i].m_Weights[j] > weight)
+				{
+					bone = vertices[i].m_BoneIDs[j];
+					weight = vertices[i].m_Weights[j];
+				}
+			}
+			dominantBones[i] = static_cast<unsigned int>(bone);
+		}
+		vector<Common::MeshLod> lods = Common::buildLodChain(vertices, indices, &dominantBones);
+		Common::logMeshLods("    processMesh", lods);
+
+		return Mesh(std::move(vertices), std::move(indices), std::move(textures), std::move(lods), cpuRetention);
 	}
 
 	void SetVertexBoneData(Vertex& vertex, int boneID, float weight)
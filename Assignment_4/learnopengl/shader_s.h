@@ -8,6 +8,9 @@
 #include <sstream>
 #include <iostream>
 
+#include "frame_data.hpp"
+#include "uniform_table.hpp"
+
 class Shader
 {
 public:
@@ -36,9 +39,9 @@ public:
             // close file handlers
             vShaderFile.close();
             fShaderFile.close();
-            // convert stream into string
-            vertexCode   = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            // convert stream into string, expanding #include "frame_data.glsl"
+            vertexCode   = Common::expandShaderIncludes(vShaderStream.str());
+            fragmentCode = Common::expandShaderIncludes(fShaderStream.str());
         }
         catch (std::ifstream::failure& e)
         {
@@ -64,6 +67,9 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        // look every active uniform up once, the setters below only search this table
+        uniforms.reflect(ID);
+        Common::bindSharedUniformBlocks(ID);
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
@@ -76,22 +82,31 @@ public:
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(Common::UniformName name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        glUniform1i(uniforms.location(name), (int)value); 
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(Common::UniformName name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1i(uniforms.location(name), value); 
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(Common::UniformName name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        glUniform1f(uniforms.location(name), value); 
+    }
+    // ------------------------------------------------------------------------
+    // location handle, for callers that resolve once and call glUniform* themselves
+    GLint location(Common::UniformName name) const
+    {
+        return uniforms.location(name);
     }
 
 private:
+    // active uniforms reflected after link
+    Common::UniformTable uniforms;
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(unsigned int shader, std::string type)
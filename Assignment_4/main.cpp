@@ -22,6 +22,14 @@
 
 #include <learnopengl/model_animation.h>
 
+#include "frame_ring_buffer.hpp"
+
+#include "frame_pipeline.hpp"
+
+#include "headless.hpp"
+
+#include "profiler.hpp"
+
 
 
 
@@ -30,6 +38,11 @@
 
 #include <iostream>
 
+#include <algorithm>
+
+#include <cstring>
+
+#include <memory>
 
 
 
@@ -72,6 +85,36 @@ float lastFrame = 0.0f;
 
 
 
+// framebuffer size, written by the resize callback and applied by the render thread
+
+int framebufferWidth = SCR_WIDTH;
+
+int framebufferHeight = SCR_HEIGHT;
+
+
+
+// everything the render thread needs for one frame, filled by the main thread and read-only afterwards
+
+struct FramePacket
+
+{
+
+	Common::FrameData frameData;
+
+	vector<glm::mat4> bonePalette;
+
+	glm::vec3 cameraPosition;
+
+	float zoom;
+
+	int framebufferWidth;
+
+	int framebufferHeight;
+
+};
+
+
+
 
 
 // enum AnimState {
@@ -96,77 +139,109 @@ float lastFrame = 0.0f;
 
 
 
-int main()
+int main(int argc, char** argv)
 
 {
 
-	// glfw: initialize and configure
+	// --headless renders a fixed number of frames offscreen with no window, see headless.hpp
+
+	Common::HeadlessOptions headlessOptions = Common::parseHeadlessOptions(argc, argv);
 
-	// ------------------------------
+	bool headless = headlessOptions.enabled;
 
-	glfwInit();
+	Common::HeadlessContext headlessContext;
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	GLFWwindow* window = NULL;
 
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	if (headless)
 
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	{
+
+		if (!headlessContext.create(headlessOptions.width, headlessOptions.height))
+
+			return -1;
+
+		framebufferWidth = headlessOptions.width;
+
+		framebufferHeight = headlessOptions.height;
+
+	}
+
+	else
+
+	{
+
+		// glfw: initialize and configure
+
+		// ------------------------------
+
+		glfwInit();
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 
 
 #ifdef __APPLE__
 
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+		glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 
 #endif
 
 
 
-	// glfw window creation
+		// glfw window creation
 
-	// --------------------
+		// --------------------
 
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+		window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
 
-	if (window == NULL)
+		if (window == NULL)
 
-	{
+		{
 
-		std::cout << "Failed to create GLFW window" << std::endl;
+			std::cout << "Failed to create GLFW window" << std::endl;
 
-		glfwTerminate();
+			glfwTerminate();
 
-		return -1;
+			return -1;
 
-	}
+		}
 
-	glfwMakeContextCurrent(window);
+		glfwMakeContextCurrent(window);
 
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
 
-	glfwSetCursorPosCallback(window, mouse_callback);
+		glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
 
-	glfwSetScrollCallback(window, scroll_callback);
+		glfwSetCursorPosCallback(window, mouse_callback);
 
+		glfwSetScrollCallback(window, scroll_callback);
 
 
-	// tell GLFW to capture our mouse
 
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+		// tell GLFW to capture our mouse
 
+		glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
 
-	// glad: load all OpenGL function pointers
 
-	// ---------------------------------------
+		// glad: load all OpenGL function pointers
 
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+		// ---------------------------------------
 
-	{
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+
+		{
+
+			std::cout << "Failed to initialize GLAD" << std::endl;
 
-		std::cout << "Failed to initialize GLAD" << std::endl;
+			return -1;
 
-		return -1;
+		}
 
 	}
 
@@ -186,6 +261,26 @@ int main()
 
 
 
+	// zone timings per frame, see profiler.hpp; compiled out in Release builds
+
+	PROFILE_THREAD_NAME("Main");
+
+	// --profile also writes them to profile.csv, and a Chrome trace on exit
+
+	bool profileFiles = false;
+
+	for (int i = 1; i < argc; i++)
+
+		if (strcmp(argv[i], "--profile") == 0)
+
+			profileFiles = true;
+
+	if (profileFiles)
+
+		PROFILE_OPEN_CSV("profile.csv");
+
+
+
 	// build and compile shaders
 
 	// -------------------------
@@ -193,6 +288,10 @@ int main()
 	Shader ourShader(FileSystem::getPath("Assignment_4/anim_model.vs").c_str(), 
 	                 FileSystem::getPath("Assignment_4/anim_model.fs").c_str());
 
+	// camera and lighting shared by every program through the FrameData uniform block
+
+	Common::FrameUniformBuffer frameUniforms;
+
 
 
 	
@@ -203,7 +302,37 @@ int main()
 
 	// idle 3.3, walk 2.06, run 0.83, punch 1.03, kick 1.6
 
-	Model ourModel(FileSystem::getPath("Assignment_4/resources/objects/mixamo/Ch09_nonPBR.dae"));
+	// keep positions only: bounds and picking need them, the vertex attributes live on the GPU
+	Model ourModel(FileSystem::getPath("Assignment_4/resources/objects/mixamo/Ch09_nonPBR.dae"), false, Common::CpuRetention::PositionsOnly);
+
+
+	// sampler units are fixed per program, assign them before any draw goes through the queue
+
+	ourShader.use();
+
+	ourModel.ResolveMaterials(ourShader);
+
+
+
+	// the model never moves, so its meshes go into a static batch drawn with one multi-draw per texture set
+
+	glm::mat4 model = glm::mat4(1.0f);
+
+	model = glm::translate(model, glm::vec3(0.0f, -0.4f, 0.0f)); // translate it down so it's at the center of the scene
+
+	model = glm::scale(model, glm::vec3(.5f, .5f, .5f));	// it's a bit too big for our scene, so scale it down
+
+	Common::StaticBatch staticBatch;
+
+	ourModel.AddToBatch(staticBatch, model);
+
+	Common::GLStateCache glState;
+
+	float lastStatsTime = 0.0f;
+
+	// bone palettes are bump-allocated per frame from a triple-buffered ring instead of glUniform calls
+
+	Common::FrameRingBuffer frameRing(GL_UNIFORM_BUFFER, 100 * sizeof(glm::mat4));
 
 	Animation chickenDanceAnimation(FileSystem::getPath("Assignment_4/resources/objects/mixamo/Chicken Dance.dae"), &ourModel);
 
@@ -233,19 +362,199 @@ int main()
 
 
 
+	// the main thread simulates frame N+1 while a render thread submits frame N; --single-thread renders inline for debugging
+
+	bool threaded = !headless;
+
+	for (int i = 1; i < argc; i++)
+
+		if (strcmp(argv[i], "--single-thread") == 0)
+
+			threaded = false;
+
+
+
+	// timings and image dumps of a headless run, which is always single-threaded
+
+	std::unique_ptr<Common::HeadlessRun> headlessRun;
+
+	if (headless)
+
+		headlessRun.reset(new Common::HeadlessRun(headlessOptions));
+
+
+
+	int viewportWidth = 0, viewportHeight = 0;
+
+	auto renderFrame = [&](const FramePacket& packet)
+
+	{
+
+		if (packet.framebufferWidth != viewportWidth || packet.framebufferHeight != viewportHeight)
+
+		{
+
+			viewportWidth = packet.framebufferWidth;
+
+			viewportHeight = packet.framebufferHeight;
+
+			glViewport(0, 0, viewportWidth, viewportHeight);
+
+		}
+
+
+
+		// render
+
+		// ------
+
+		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+
+
+		// view/projection transformations, written once per frame for all shaders
+
+		frameUniforms.update(packet.frameData);
+
+
+
+		// bind through the state cache so the batch knows the program is already current
+
+		glState.stats = Common::RenderStats();
+
+		glState.useProgram(ourShader.ID);
+
+
+
+		frameRing.beginFrame();
+
+		{
+
+			PROFILE_ZONE("Bone upload");
+
+			// the BonePalette block holds 100 matrices, the rest of the palette is ignored like before
+
+			size_t paletteBytes = std::min<size_t>(packet.bonePalette.size(), 100) * sizeof(glm::mat4);
+
+			Common::RingAllocation palette = frameRing.allocate(100 * sizeof(glm::mat4));
+
+			if (palette.valid())
+
+			{
+
+				memcpy(palette.data, packet.bonePalette.data(), paletteBytes);
+
+				frameRing.flush();
+
+				glBindBufferRange(GL_UNIFORM_BUFFER, Common::BonePaletteBinding, frameRing.buffer(), palette.offset, palette.size);
+
+			}
+
+		}
+
+
+
+		// render the loaded model, following LOD switches without rebuilding the batch
+
+		{
+
+			PROFILE_ZONE("LOD selection");
+
+			ourModel.SelectLod(packet.cameraPosition, packet.zoom, (float)packet.framebufferHeight, model);
+
+			ourModel.UpdateBatch(staticBatch);
+
+		}
+
+		{
+
+			PROFILE_GPU_ZONE("Draw submission");
+
+			staticBatch.draw(glState, ourShader.ID);
+
+		}
+
+		frameRing.endFrame();
+
+		Common::RenderStats renderStats = glState.stats;
+
+
+
+		if (packet.frameData.time - lastStatsTime >= 5.0f)
+
+		{
+
+			Common::logRenderStats("Frame", renderStats);
+
+			frameRing.logStats("Frame ring");
+
+			lastStatsTime = packet.frameData.time;
+
+		}
+
+
+
+		// glfw: swap buffers
+
+		// ------------------
+
+		{
+
+			PROFILE_ZONE("Swap");
+
+			if (headless)
+
+				headlessRun->present();
+
+			else
+
+				glfwSwapBuffers(window);
+
+		}
+
+		PROFILE_FRAME();
+
+	};
+
+
+
+	// the GL context belongs to the render thread from here until the pipeline stops
+
+	if (threaded)
+
+		glfwMakeContextCurrent(NULL);
+
+	Common::FramePipeline<FramePacket> pipeline(threaded,
+
+		[window]() { PROFILE_THREAD_NAME("Render"); glfwMakeContextCurrent(window); },
+
+		renderFrame,
+
+		[]() { glfwMakeContextCurrent(NULL); });
+
+	float lastPipelineStatsTime = 0.0f;
+
+
+
 	// render loop
 
 	// -----------
 
-	while (!glfwWindowShouldClose(window))
+	while (headless ? headlessRun->running() : !glfwWindowShouldClose(window))
 
 	{
 
-		// per-frame time logic
+		// per-frame time logic, a fixed timestep when headless
 
 		// --------------------
 
-		float currentFrame = glfwGetTime();
+		if (headless)
+
+			headlessRun->beginFrame();
+
+		float currentFrame = headless ? headlessRun->time() : glfwGetTime();
 
 		deltaTime = currentFrame - lastFrame;
 
@@ -253,19 +562,25 @@ int main()
 
 
 
-		// input
+		// input; headless runs have none and keep playing the current animation
 
 		// -----
 
-		processInput(window);
+		if (!headless)
+
+		{
 
-		if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) 
+			processInput(window);
 
-			animator.PlayAnimation(&chickenDanceAnimation, NULL, 0.0f, 0.0f, 0.0f);
+			if (glfwGetKey(window, GLFW_KEY_1) == GLFW_PRESS) 
 
-		if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+				animator.PlayAnimation(&chickenDanceAnimation, NULL, 0.0f, 0.0f, 0.0f);
 
-			animator.PlayAnimation(&jumpAnimation, NULL, 0.0f, 0.0f, 0.0f);
+			if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
+
+				animator.PlayAnimation(&jumpAnimation, NULL, 0.0f, 0.0f, 0.0f);
+
+		}
 
 		// if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
 
@@ -505,81 +820,106 @@ int main()
 
 
 
-		animator.UpdateAnimation(deltaTime);
+		{
 
-		
+			PROFILE_ZONE("Animation update");
 
-		// render
+			animator.UpdateAnimation(deltaTime);
 
-		// ------
+		}
 
-		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
 
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// hand the frame to the render thread
 
+		FramePacket& packet = pipeline.beginPacket();
 
-		// don't forget to enable shader before setting uniforms
+		// aspect of what is actually rendered: the headless size or the resized window. a minimized
+		// window reports a zero height, keep the default aspect then
 
-		ourShader.use();
+		packet.framebufferWidth = framebufferWidth;
 
+		packet.framebufferHeight = framebufferHeight;
 
+		float aspect = packet.framebufferHeight > 0 ? (float)packet.framebufferWidth / (float)packet.framebufferHeight : (float)SCR_WIDTH / (float)SCR_HEIGHT;
 
-		// view/projection transformations
+		packet.frameData = Common::FrameData{};
 
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		packet.frameData.projection = glm::perspective(glm::radians(camera.Zoom), aspect, 0.1f, 100.0f);
 
-		glm::mat4 view = camera.GetViewMatrix();
+		packet.frameData.view = camera.GetViewMatrix();
 
-		ourShader.setMat4("projection", projection);
+		packet.frameData.viewPos = camera.Position;
 
-		ourShader.setMat4("view", view);
+		packet.frameData.time = currentFrame;
 
+		packet.frameData.lightColor = glm::vec3(1.0f);
 
+		const auto& transforms = animator.GetFinalBoneMatrices();
 
-        auto transforms = animator.GetFinalBoneMatrices();
+		packet.bonePalette.assign(transforms.begin(), transforms.end());
 
-		for (int i = 0; i < transforms.size(); ++i)
+		packet.cameraPosition = camera.Position;
 
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+		packet.zoom = camera.Zoom;
 
+		if (headless)
 
+			headlessRun->simulationDone();
 
+		pipeline.submit();
 
+		if (headless)
 
-		// render the loaded model
+			headlessRun->endFrame();
 
-		glm::mat4 model = glm::mat4(1.0f);
 
-		model = glm::translate(model, glm::vec3(0.0f, -0.4f, 0.0f)); // translate it down so it's at the center of the scene
 
-		model = glm::scale(model, glm::vec3(.5f, .5f, .5f));	// it's a bit too big for our scene, so scale it down
+		if (currentFrame - lastPipelineStatsTime >= 5.0f)
 
-		ourShader.setMat4("model", model);
+		{
 
-		ourModel.Draw(ourShader);
+			pipeline.logStats("Frame pipeline");
 
+			lastPipelineStatsTime = currentFrame;
 
+		}
 
 
 
-		// glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+		// glfw: poll IO events (keys pressed/released, mouse moved etc.)
 
 		// -------------------------------------------------------------------------------
 
-		glfwSwapBuffers(window);
+		if (!headless)
 
-		glfwPollEvents();
+			glfwPollEvents();
 
 	}
 
 
 
+	// let the render thread finish its last frame and give the context back for cleanup
+
+	pipeline.stop();
+
+	if (profileFiles)
+
+		PROFILE_WRITE_TRACE("profile_trace.json");
+
+	if (threaded)
+
+		glfwMakeContextCurrent(window);
+
+
+
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 
 	// ------------------------------------------------------------------
 
-	glfwTerminate();
+	if (!headless)
+
+		glfwTerminate();
 
 	return 0;
 
@@ -633,7 +973,11 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 
 	// height will be significantly larger than specified on retina displays.
 
-	glViewport(0, 0, width, height);
+	// the render thread owns the context, so it applies the viewport with the next frame
+
+	framebufferWidth = width;
+
+	framebufferHeight = height;
 
 }
 
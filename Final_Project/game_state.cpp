@@ -0,0 +1,168 @@
+#include "game_state.h"
+
+#include <math.h>
+#include <stddef.h>
+
+namespace {
+
+const float SHIP_STEP = (float)(SPACESHIP_SPEED * (1.0 / TICK_RATE));	//units per tick
+const float LASER_STEP = (float)(LASER_SPEED * (1.0 / TICK_RATE));		//units per tick
+
+//Ship 0 faces and shoots left on screen, the mirrored ship 1 right
+float facing(int ship)
+{
+	return ship == 0 ? -1.0f : 1.0f;
+}
+
+float screenX(const Ship& ship, int index)
+{
+	return index == 0 ? ship.x : -ship.x;
+}
+
+//A bolt from the ship's center, aimed level, or at the top or bottom edge of the far side as the
+//beam used to be
+void fireLaser(GameState& state, int index)
+{
+	const Ship& ship = state.ships[index];
+	float yend = ship.laserDir[0] ? YMAX : (ship.laserDir[1] ? -YMAX : ship.y);
+	float dx = -XMAX - ship.x, dy = yend - ship.y;		//in the ship's own frame
+	float length = sqrtf(dx * dx + dy * dy);
+	if(length <= 0)
+		return;
+	float vx = dx / length * LASER_STEP, vy = dy / length * LASER_STEP;
+	spawnProjectile(state.lasers, screenX(ship, index), ship.y, index == 0 ? vx : -vx, vy, (uint16_t)index, LASER_TICKS);
+}
+
+//A ship either shoots (aiming up or down with the same keys) or moves, never both in one tick
+void moveShip(Ship& ship, const PlayerInput& input, bool mirrored)
+{
+	ship.laserDir[0] = ship.laserDir[1] = false;
+	ship.laser = input.fire;
+	if(ship.laserCooldown > 0)
+		ship.laserCooldown--;
+	if(input.fire) {
+		if(input.up) ship.laserDir[0] = true;
+		if(input.down) ship.laserDir[1] = true;
+		return;
+	}
+	if(input.right) ship.x += mirrored ? -SHIP_STEP : SHIP_STEP;
+	if(input.left) ship.x -= mirrored ? -SHIP_STEP : SHIP_STEP;
+	if(input.up) ship.y += SHIP_STEP;
+	if(input.down) ship.y -= SHIP_STEP;
+}
+
+void placeAtStart(Ship& ship)
+{
+	ship.x = ship.prevX = 500;
+	ship.y = ship.prevY = 0;
+}
+
+uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for(size_t i=0;i<size;i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+}
+
+void resetGame(GameState& state)
+{
+	if(state.lasers.capacity == 0) {
+		initProjectiles(state.lasers, MAX_LASERS, -XMAX, -YMAX, XMAX, YMAX, 2 * SHIP_RADIUS);
+		state.hits.reserve(MAX_LASERS);
+	}
+	clearProjectiles(state.lasers);
+	for(Ship& ship : state.ships) {
+		placeAtStart(ship);
+		ship.life = START_LIFE;
+		ship.laser = false;
+		ship.laserDir[0] = ship.laserDir[1] = false;
+		ship.laserCooldown = 0;
+	}
+	state.over = false;
+	state.ticks = 0;
+}
+
+void step(GameState& state, const GameInputs& inputs)
+{
+	if(state.over)
+		return;
+	for(Ship& ship : state.ships) {
+		ship.prevX = ship.x;
+		ship.prevY = ship.y;
+	}
+	//Player 2 first, the order the keys were always handled in
+	moveShip(state.ships[1], inputs.players[1], true);
+	moveShip(state.ships[0], inputs.players[0], false);
+
+	for(int p=0;p<2;p++) {
+		Ship& ship = state.ships[p];
+		if(ship.laser && ship.laserCooldown == 0) {
+			fireLaser(state, p);
+			ship.laserCooldown = LASER_INTERVAL;
+		}
+	}
+
+	//Hit circles sit a little up and forward of the ship's center
+	float targetX[2], targetY[2], targetRadius[2];
+	for(int p=0;p<2;p++) {
+		const Ship& ship = state.ships[p];
+		targetX[p] = screenX(ship, p) + 8 * facing(p);
+		targetY[p] = ship.y + 8;
+		targetRadius[p] = ship.life > 0 ? SHIP_RADIUS : 0;
+	}
+	state.hits.clear();
+	stepProjectiles(state.lasers, targetX, targetY, targetRadius, 2, state.hits);
+	for(const ProjectileHit& hit : state.hits)
+		state.ships[hit.target].life -= LASER_DAMAGE;
+
+	for(const Ship& ship : state.ships)
+		if(ship.life <= 0)
+			state.over = true;
+	if(state.over) {
+		for(Ship& ship : state.ships)
+			placeAtStart(ship);
+		clearProjectiles(state.lasers);
+	}
+	state.ticks++;
+}
+
+uint64_t hashGameState(const GameState& state)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for(const Ship& ship : state.ships) {
+		const float position[4] = {ship.x, ship.y, ship.prevX, ship.prevY};
+		const unsigned char flags[3] = {ship.laser, ship.laserDir[0], ship.laserDir[1]};
+		hash = hashBytes(hash, position, sizeof(position));
+		hash = hashBytes(hash, &ship.life, sizeof(ship.life));
+		hash = hashBytes(hash, flags, sizeof(flags));
+		hash = hashBytes(hash, &ship.laserCooldown, sizeof(ship.laserCooldown));
+	}
+	const ProjectilePool& lasers = state.lasers;
+	size_t count = lasers.count;
+	hash = hashBytes(hash, &lasers.count, sizeof(lasers.count));
+	hash = hashBytes(hash, lasers.x.data(), count * sizeof(float));
+	hash = hashBytes(hash, lasers.y.data(), count * sizeof(float));
+	hash = hashBytes(hash, lasers.vx.data(), count * sizeof(float));
+	hash = hashBytes(hash, lasers.vy.data(), count * sizeof(float));
+	hash = hashBytes(hash, lasers.owner.data(), count * sizeof(uint16_t));
+	hash = hashBytes(hash, lasers.ticksLeft.data(), count * sizeof(uint16_t));
+	const unsigned char over = state.over;
+	hash = hashBytes(hash, &over, 1);
+	return hashBytes(hash, &state.ticks, sizeof(state.ticks));
+}
+
+uint8_t packInput(const PlayerInput& input)
+{
+	return (input.up ? 1 : 0) | (input.down ? 2 : 0) | (input.left ? 4 : 0) | (input.right ? 8 : 0) | (input.fire ? 16 : 0);
+}
+
+PlayerInput unpackInput(uint8_t bits)
+{
+	PlayerInput input = {(bits & 1) != 0, (bits & 2) != 0, (bits & 4) != 0, (bits & 8) != 0, (bits & 16) != 0};
+	return input;
+}
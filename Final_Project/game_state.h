@@ -0,0 +1,66 @@
+#pragma once
+
+#include "projectiles.h"
+
+#include <stdint.h>
+#include <vector>
+
+//SIMULATION CORE: the Space Shooter rules with no GL, GLUT or clock. The window build and the
+//headless runner both call step() on a GameState once per tick, so the same inputs always give the
+//same state, bit for bit. Positions are in the game screen's units (the 2x scaled ortho space).
+
+#define XMAX 1200
+#define YMAX 700
+#define SPACESHIP_SPEED 1200		//units per second
+#define TICK_RATE 60				//game ticks per second
+#define LASER_DAMAGE 5			//life lost per laser bolt that hits
+#define LASER_SPEED 3000			//bolt speed, units per second
+#define LASER_INTERVAL 3			//ticks between bolts while the fire key is held
+#define LASER_TICKS 60			//bolts still flying after this many ticks are dropped
+#define MAX_LASERS 256
+#define SHIP_RADIUS 50			//approx radius of the spaceship for laser hits
+#define START_LIFE 100
+
+struct Ship {
+	float x, y;
+	float prevX, prevY;			//at the previous tick, for interpolation
+	int life;
+	bool laser;					//fire key held
+	bool laserDir[2];			//aiming up, down
+	int laserCooldown;			//ticks until the next bolt
+};
+
+//Ship 0 (keys i j k l, m to shoot) starts on the right and is PLAYER 2 on the instructions screen.
+//Ship 1 (w a s d, c to shoot) is PLAYER 1, drawn mirrored on the left, so its x grows to the left.
+//Laser bolts live in screen space, where ship 1 is at (-x, y)
+struct GameState {
+	Ship ships[2];
+	bool over;
+	uint32_t ticks;
+	ProjectilePool lasers;
+	std::vector<ProjectileHit> hits;	//scratch for step()
+};
+
+//Left and right are on screen, whichever way the ship faces
+struct PlayerInput {
+	bool up, down, left, right, fire;
+};
+
+struct GameInputs {
+	PlayerInput players[2];
+};
+
+//Both ships back at the start with full life and no bolts in flight. Sets the laser pool up on first use
+void resetGame(GameState& state);
+
+//One tick: movement or shooting, laser bolts moved and hits taken off the life of the ship hit, game
+//over. Once over, the ships are back at the start with the lives they ended on, no bolts are left,
+//and step() does nothing more until resetGame()
+void step(GameState& state, const GameInputs& inputs);
+
+//FNV-1a over every field, to compare runs
+uint64_t hashGameState(const GameState& state);
+
+//One byte per player per tick, for recording and replaying input
+uint8_t packInput(const PlayerInput& input);
+PlayerInput unpackInput(uint8_t bits);
@@ -0,0 +1,175 @@
+//Space Shooter without a window: runs the game rules from game_state.h as fast as they go, for bot
+//training and regression benchmarks.
+//
+//  Final_Project_headless [--ticks N] [--seed S]	random bots for N ticks (10000000), restarting after each game
+//  Final_Project_headless --replay FILE				inputs recorded by Final_Project --record FILE
+//  Final_Project_headless --bench-projectiles N		N projectiles kept in flight among 64 moving ships
+//
+//Replays print the same per-game lines as the recording run, so the two can be diffed.
+#include "game_state.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+//xorshift32: fast, and the same sequence on every platform for a given seed
+uint32_t nextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//Holds a set of keys for a random number of ticks, the way a player would: back towards its own
+//side when it strays, otherwise mostly lining up with the other ship and shooting
+struct Bot {
+	uint32_t random;
+	PlayerInput input;
+	int hold;
+};
+
+PlayerInput botInput(Bot& bot, const GameState& game, int ship)
+{
+	if(bot.hold-- <= 0) {
+		uint32_t r = nextRandom(bot.random);
+		float x = ship == 0 ? game.ships[0].x : -game.ships[1].x;		//on screen
+		float home = ship == 0 ? 500 : -500;
+		float dy = game.ships[1 - ship].y - game.ships[ship].y;
+		if(x > home + 300)
+			bot.input = unpackInput(4);		//left
+		else if(x < home - 300)
+			bot.input = unpackInput(8);		//right
+		else if((r & 3) == 0)
+			bot.input = unpackInput((uint8_t)((r >> 2) & 31));
+		else if(dy > SHIP_RADIUS / 2)
+			bot.input = unpackInput(1);		//up
+		else if(dy < -SHIP_RADIUS / 2)
+			bot.input = unpackInput(2);		//down
+		else
+			bot.input = unpackInput(16);	//fire
+		bot.hold = 5 + (int)((r >> 7) % 40);
+	}
+	return bot.input;
+}
+
+//The projectile pool alone at a scale the game never reaches: 64 ships drifting across the play
+//area and the pool topped back up to `count` shots every tick
+int benchProjectiles(int count)
+{
+	const int ships = 64;
+	const int ticks = 1000;
+	uint32_t random = 12345;
+	auto uniform = [&](float low, float high) { return low + (high - low) * (nextRandom(random) >> 8) * (1.0f / 16777216.0f); };
+
+	float x[ships], y[ships], radius[ships], vx[ships], vy[ships];
+	for(int s=0;s<ships;s++) {
+		x[s] = uniform(-XMAX, XMAX), y[s] = uniform(-YMAX, YMAX), radius[s] = SHIP_RADIUS;
+		vx[s] = uniform(-10, 10), vy[s] = uniform(-10, 10);
+	}
+	ProjectilePool pool;
+	initProjectiles(pool, count, -XMAX, -YMAX, XMAX, YMAX, 2 * SHIP_RADIUS);
+	std::vector<ProjectileHit> hits;
+	hits.reserve(count);
+
+	long long moved = 0, hitTotal = 0;
+	double seconds = 0;
+	for(int t=0;t<ticks;t++) {
+		for(int s=0;s<ships;s++) {
+			x[s] += vx[s], y[s] += vy[s];
+			if(x[s] < -XMAX || x[s] > XMAX) vx[s] = -vx[s];
+			if(y[s] < -YMAX || y[s] > YMAX) vy[s] = -vy[s];
+		}
+		while(pool.count < count) {
+			int s = nextRandom(random) % ships;
+			float angle = uniform(0, 6.2831853f);
+			spawnProjectile(pool, x[s], y[s], cosf(angle) * 50, sinf(angle) * 50, (uint16_t)s, LASER_TICKS);
+		}
+		moved += pool.count;
+		hits.clear();
+		auto start = std::chrono::steady_clock::now();
+		hitTotal += stepProjectiles(pool, x, y, radius, ships, hits);
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	printf("%d projectiles, %d ships, %d ticks: %.3f ms per tick, %.1f ns per projectile, %lld hits\n",
+		count, ships, ticks, seconds * 1000 / ticks, seconds * 1e9 / moved, hitTotal);
+	return 0;
+}
+
+int replay(const char* path)
+{
+	FILE* file = fopen(path, "rb");
+	if(!file) {
+		printf("Could not open %s\n", path);
+		return 1;
+	}
+	std::vector<uint8_t> bytes;
+	uint8_t buffer[4096];
+	size_t read;
+	while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+		bytes.insert(bytes.end(), buffer, buffer + read);
+	fclose(file);
+
+	GameState game;
+	resetGame(game);
+	int games = 0;
+	for(size_t i=0;i+1<bytes.size();i+=2) {
+		GameInputs inputs = {{unpackInput(bytes[i]), unpackInput(bytes[i+1])}};
+		step(game, inputs);
+		if(game.over) {
+			games++;
+			printf("game %d: %u ticks, state hash %016llx\n", games, game.ticks, (unsigned long long)hashGameState(game));
+			resetGame(game);
+		}
+	}
+	if(game.ticks > 0)
+		printf("unfinished game: %u ticks, state hash %016llx\n", game.ticks, (unsigned long long)hashGameState(game));
+	return 0;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	long long ticks = 10000000;
+	uint32_t seed = 1;
+	for(int i=1;i+1<argc;i++) {
+		if(strcmp(argv[i], "--replay") == 0)
+			return replay(argv[i+1]);
+		if(strcmp(argv[i], "--bench-projectiles") == 0)
+			return benchProjectiles(atoi(argv[i+1]));
+		if(strcmp(argv[i], "--ticks") == 0)
+			ticks = atoll(argv[++i]);
+		else if(strcmp(argv[i], "--seed") == 0)
+			seed = (uint32_t)strtoul(argv[++i], NULL, 10);
+	}
+
+	Bot bots[2] = {{seed * 2654435761u | 1u, PlayerInput(), 0}, {(seed + 1) * 2246822519u | 1u, PlayerInput(), 0}};
+	GameState game;
+	resetGame(game);
+	int games = 0, wins[2] = {0, 0};
+	uint64_t hash = 14695981039346656037ull;		//of every finished game, in order
+
+	auto start = std::chrono::steady_clock::now();
+	for(long long t=0;t<ticks;t++) {
+		GameInputs inputs = {{botInput(bots[0], game, 0), botInput(bots[1], game, 1)}};
+		step(game, inputs);
+		if(game.over) {
+			games++;
+			wins[game.ships[1].life > 0 ? 0 : 1]++;		//player 1 is ship 1
+			hash = (hash ^ hashGameState(game)) * 1099511628211ull;
+			resetGame(game);
+		}
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	printf("%lld ticks in %.3f s (%.2f million ticks/s)\n", ticks, seconds, ticks / seconds / 1e6);
+	printf("%d games: player 1 won %d, player 2 won %d\n", games, wins[0], wins[1]);
+	printf("result hash %016llx\n", (unsigned long long)((hash ^ hashGameState(game)) * 1099511628211ull));
+	return 0;
+}
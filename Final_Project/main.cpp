@@ -1,19 +1,26 @@
 #ifdef _WIN32
 	#include<windows.h>
 #endif
+#include <glad/glad.h>          //before GLUT, which pulls in gl.h
 #include<stdio.h>
 #include<stdlib.h>
+#include<stddef.h>
+#include<string.h>
 #ifdef __APPLE__
 #include <GLUT/glut.h>
 #else
 #include <GL/glut.h>
 #endif
 #include<math.h>
+#include <vector>
+#include <string>
+#include <glm/glm.hpp>
+#include "polygon_tessellator.hpp"
+#include "sphere_mesh.hpp"
+#include "game_state.h"
 #define GL_SILENCE_DEPRECATION
 
-#define XMAX 1200
-#define YMAX 700
-#define SPACESHIP_SPEED 20
+#define MAX_FRAME_RATE 120		//rendering cap while playing
 #define TOP 0
 #define RIGHT 1
 #define BOTTOM 2
@@ -27,15 +34,10 @@ enum view {INTRO, MENU, INSTRUCTIONS, GAME, GAMEOVER};
 view viewPage = INTRO; // initial value
 bool keyStates[256] = {false};
 bool direction[4] = {false};
-bool laser1Dir[2] = {false};
-bool laser2Dir[2] = {false};
-
-int alienLife1 = 100;
-int alienLife2 = 100;
-bool gameOver = false;
-float xOne = 500, yOne = 0;
-float xTwo = 500, yTwo = 0;
-bool laser1 = false, laser2 = false;
+
+GameState game;						//ships, lives and lasers; only step() changes them
+FILE* inputRecording = NULL;		//--record FILE: every tick's input, for Final_Project_headless --replay
+int gamesPlayed = 0;
 GLint CI=0;
 GLfloat a[][2]={0,-50, 70,-50, 70,70, -70,70};
 GLfloat LightColor[][3]={1,1,0,   0,1,1,   0,1,0};
@@ -71,6 +73,36 @@ void init()
 	glMatrixMode(GL_MODELVIEW);
 }
 
+//FIXED TIMESTEP: the game only changes in tick(), TICK_RATE times a second of real time however
+//fast frames come. display() runs the ticks that are due and draws the ships between the last two
+//tick states. While playing a timer caps redraws at MAX_FRAME_RATE; the other pages are only redrawn
+//on input.
+const double TICK_DT = 1.0 / TICK_RATE;
+const double MAX_FRAME_TIME = 0.25;	//longer stalls are dropped, not caught up
+double tickAccumulator = 0;
+int lastFrameTime = 0;				//glutGet(GLUT_ELAPSED_TIME) at the previous game frame, in ms
+int gameSession = 0;				//bumped per game so a stale timer from the last one stops
+
+void frameTimer(int session)
+{
+	if(viewPage != GAME || session != gameSession)
+		return;
+	glutPostRedisplay();
+	glutTimerFunc(1000 / MAX_FRAME_RATE, frameTimer, session);
+}
+
+void setViewPage(view page)
+{
+	bool starting = page == GAME && viewPage != GAME;
+	viewPage = page;
+	if(starting) {
+		tickAccumulator = 0;
+		lastFrameTime = glutGet(GLUT_ELAPSED_TIME);
+		glutTimerFunc(0, frameTimer, ++gameSession);
+	}
+	glutPostRedisplay();
+}
+
 void introScreen()
 {
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -100,8 +132,6 @@ void introScreen()
 	displayRasterText(-250, -400, 0.0,"Academic Year 2020-2021");
         glColor3f(1.0, 1.0, 1.0);
 	displayRasterText(-300, -550, 0.0,"Press ENTER to start the game");
-	glFlush();
- 	glutSwapBuffers();
 }
 
 void startScreenDisplay()
@@ -144,9 +174,9 @@ void startScreenDisplay()
 	if(mouseX>=-100 && mouseX<=100 && mouseY>=150 && mouseY<=200){
 		glColor3f(0 ,0 ,1) ;
 		if(mButtonPressed){
-			alienLife1 = alienLife2 = 100;
-			viewPage = GAME;
+			resetGame(game);
 			mButtonPressed = false;
+			setViewPage(GAME);
 		}
 	} else
 		glColor3f(0 , 0, 0);
@@ -156,8 +186,7 @@ void startScreenDisplay()
 	if(mouseX>=-100 && mouseX<=100 && mouseY>=30 && mouseY<=80) {
 		glColor3f(0 ,0 ,1);
 		if(mButtonPressed){
-			viewPage = INSTRUCTIONS;
-			printf("button pressed bitch\n");
+			setViewPage(INSTRUCTIONS);
 			mButtonPressed = false;
 		}
 	} else
@@ -174,17 +203,15 @@ void startScreenDisplay()
 	else
 		glColor3f(0 , 0, 0);
 	displayRasterText(-100 ,-170 ,0.4 ,"    Quit");
-	glutPostRedisplay();
 }
 
 void backButton() {
 	if(mouseX <= -450 && mouseX >= -500 && mouseY >= -275 && mouseY <= -250){
 			glColor3f(0, 0, 1);
 			if(mButtonPressed) {
-				viewPage = MENU;
 				mButtonPressed = false;
 				//instructionsGame = false;
-				glutPostRedisplay();
+				setViewPage(MENU);
 			}
 	}
 	else glColor3f(1, 0, 0);
@@ -220,84 +247,306 @@ void instructionsScreenDisplay()
 	//	nextScreen = false ,previousScreen = false; //as set by backButton()
 }
 
-void DrawAlienBody(bool isPlayer1)
+//ALIEN SPRITE: the polygons above tessellated once into a VBO (concave ones included). Each ship is
+//two draws from it: the fills as triangles with vertex colors, one copy per body color, and all the
+//outlines as lines. Outline pieces hidden under a later part are cut away when building, so the
+//layering is the same as drawing the parts one after another.
+struct SpriteVertex {
+	GLfloat x, y;
+	GLubyte r, g, b, a;
+};
+GLuint alienSpriteVbo = 0;
+GLint alienFillFirst[2] = {0, 0};		//player 1, player 2
+GLsizei alienFillCount = 0;
+GLint alienOutlineFirst = 0;
+GLsizei alienOutlineCount = 0;
+
+std::vector<glm::vec2> spritePoints(const GLfloat points[][2], int count)
 {
-	if(isPlayer1)
-		glColor3f(0,1,0);
-	else
-		glColor3f(1,1,0);		//BODY color
-	glBegin(GL_POLYGON);
-	for(int i=0;i<=8;i++)
-		glVertex2fv(AlienBody[i]);
-	glEnd();
+	std::vector<glm::vec2> result;
+	for(int i=0;i<count;i++)
+		result.push_back(glm::vec2(points[i][0], points[i][1]));
+	return result;
+}
+
+void addSpriteVertex(std::vector<SpriteVertex>& vertices, const glm::vec2& point, const GLubyte color[3])
+{
+	SpriteVertex vertex = {point.x, point.y, color[0], color[1], color[2], 255};
+	vertices.push_back(vertex);
+}
+
+void buildAlienSprite()
+{
+	const GLfloat bodyEffect[][2] = {{-13,11}, {-15,9}};
+	const GLfloat earEffect[][2] = {{3.3,22}, {4.4,23.5}, {6.3,26}};
+	const GLubyte bodyColor[2][3] = {{0,255,0}, {255,255,0}};		//BODY color per player
+	const GLubyte black[3] = {0,0,0};
+
+	//Drawing order: body, collar, face, beak. A color of NULL means the player's body color
+	struct Part {
+		std::vector<glm::vec2> outline;
+		std::vector<glm::vec2> effect;		//extra line strip drawn with the outline
+		const GLubyte* color;
+		std::vector<glm::vec2> triangles;
+	};
+	const GLubyte collarColor[3] = {255,0,0};
+	const GLubyte faceColor[3] = {0,0,255};
+	const GLubyte beakColor[3] = {255,255,0};
+	Part parts[4] = {
+		{spritePoints(AlienBody, 9), spritePoints(bodyEffect, 2), NULL, std::vector<glm::vec2>()},
+		{spritePoints(AlienCollar, 21), std::vector<glm::vec2>(), collarColor, std::vector<glm::vec2>()},
+		{spritePoints(ALienFace, 43), spritePoints(earEffect, 3), faceColor, std::vector<glm::vec2>()},
+		{spritePoints(ALienBeak, 15), std::vector<glm::vec2>(), beakColor, std::vector<glm::vec2>()}
+	};
+	for(Part& part : parts) {
+		std::vector<unsigned int> indices = Common::tessellatePolygon(part.outline);
+		for(unsigned int index : indices)
+			part.triangles.push_back(part.outline[index]);
+	}
+
+	std::vector<SpriteVertex> vertices;
+	for(int player=0;player<2;player++) {
+		alienFillFirst[player] = (GLint)vertices.size();
+		for(Part& part : parts)
+			for(const glm::vec2& point : part.triangles)
+				addSpriteVertex(vertices, point, part.color ? part.color : bodyColor[player]);
+	}
+	alienFillCount = (GLsizei)vertices.size() / 2;
+
+	alienOutlineFirst = (GLint)vertices.size();
+	for(int i=0;i<4;i++) {
+		std::vector<glm::vec2> covering;
+		for(int j=i+1;j<4;j++)
+			covering.insert(covering.end(), parts[j].triangles.begin(), parts[j].triangles.end());
+
+		std::vector<glm::vec2> pieces;
+		const std::vector<glm::vec2>* strips[2] = {&parts[i].outline, &parts[i].effect};
+		for(const std::vector<glm::vec2>* strip : strips)
+			for(size_t k=1;k<strip->size();k++)
+				if((*strip)[k-1] != (*strip)[k])
+					Common::clipSegmentOutsideTriangles((*strip)[k-1], (*strip)[k], covering, pieces);
+		for(const glm::vec2& point : pieces)
+			addSpriteVertex(vertices, point, black);
+	}
+	alienOutlineCount = (GLsizei)vertices.size() - alienOutlineFirst;
+
+	glGenBuffers(1, &alienSpriteVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, alienSpriteVbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SpriteVertex), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void DrawAlienSprite(bool isPlayer1)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, alienSpriteVbo);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_COLOR_ARRAY);
+	glVertexPointer(2, GL_FLOAT, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, x));
+	glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(SpriteVertex), (void*)offsetof(SpriteVertex, r));
 
-	glColor3f(0,0,0);			//BODY Outline
+	glDrawArrays(GL_TRIANGLES, alienFillFirst[isPlayer1 ? 0 : 1], alienFillCount);		//BODY, COLLAR, FACE, BEAK
 	glLineWidth(1);
-	glBegin(GL_LINE_STRIP);
-	for(int i=0;i<=8;i++)
-		glVertex2fv(AlienBody[i]);
-	glEnd();
+	glDrawArrays(GL_LINES, alienOutlineFirst, alienOutlineCount);		//outlines and effects
 
-	glBegin(GL_LINES);                //BODY effect
-		glVertex2f(-13,11);
-		glVertex2f(-15,9);
-	glEnd();
+	glDisableClientState(GL_COLOR_ARRAY);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
 }
-void DrawAlienCollar()
+//SPHERE CACHE: unit spheres tessellated once at a few levels into one VBO. Every ellipse below
+//(eyes, dome, base, lights) draws the smallest level whose outline stays within half a pixel of
+//the true curve at its current on-screen size, instead of tessellating a new sphere every call.
+const int SPHERE_LEVELS = 4;
+const int SphereSlices[SPHERE_LEVELS] = {8, 16, 32, 64};		//stacks are half the slices
+GLuint sphereVbo = 0;
+GLint sphereFirst[SPHERE_LEVELS];
+GLsizei sphereCount[SPHERE_LEVELS];
+
+//SHIP LIGHTS: all nine in one instanced draw, each instance placed and colored from uniforms
+const int LIGHT_COUNT = 9;
+GLuint lightProgram = 0;			//0 when instancing is unavailable: one draw per light instead
+GLint lightColorLocation = -1;
+
+void buildSphereCache()
 {
-	glColor3f(1,0,0);				//COLLAR
-	glBegin(GL_POLYGON);
-	for(int i=0;i<=20 ;i++)
-		glVertex2fv(AlienCollar[i]);
-	glEnd();
+	std::vector<glm::vec3> vertices;
+	for(int level=0;level<SPHERE_LEVELS;level++) {
+		sphereFirst[level] = (GLint)vertices.size();
+		Common::buildUnitSphere(SphereSlices[level], SphereSlices[level] / 2, vertices);
+		sphereCount[level] = (GLsizei)vertices.size() - sphereFirst[level];
+	}
+	glGenBuffers(1, &sphereVbo);
+	glBindBuffer(GL_ARRAY_BUFFER, sphereVbo);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(glm::vec3), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-	glColor3f(0,0,0);				//COLLAR outline
-	glBegin(GL_LINE_STRIP);
-	for(int i=0;i<=20 ;i++)
-		glVertex2fv(AlienCollar[i]);
-	glEnd();
+//Level for a unit sphere under the current modelview and projection
+int sphereLevel()
+{
+	GLfloat modelview[16], projection[16];
+	GLint viewport[4];
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelview);
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glm::mat4 mvp(0.0f);
+	for(int column=0;column<4;column++)
+		for(int row=0;row<4;row++)
+			for(int k=0;k<4;k++)
+				mvp[column][row] += projection[k*4 + row] * modelview[column*4 + k];
+
+	int segments = Common::circleSegmentsForRadius(Common::projectedRadiusPixels(mvp, glm::vec2(viewport[2], viewport[3])));
+	for(int level=0;level<SPHERE_LEVELS;level++)
+		if(SphereSlices[level] >= segments)
+			return level;
+	return SPHERE_LEVELS - 1;
 }
-void DrawAlienFace(bool isPlayer1)
+
+void beginSphereDraws()
 {
-	//glColor3f(0.6,0.0,0.286);				//FACE
-	//glColor3f(0.8,0.2,0.1);
-	//glColor3f(0,0.5,1);
-	//if(isPlayer1)
-	glColor3f(0,0,1);
-	// else
-	// 	glColor3f(0,1,0);
+	glBindBuffer(GL_ARRAY_BUFFER, sphereVbo);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(3, GL_FLOAT, sizeof(glm::vec3), (void*)0);
+}
 
-	glBegin(GL_POLYGON);
-	for(int i=0;i<=42 ;i++)
-		glVertex2fv(ALienFace[i]);
-	glEnd();
+void endSphereDraws()
+{
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-	glColor3f(0,0,0);				//FACE outline
-	glBegin(GL_LINE_STRIP);
-	for(int i=0;i<=42 ;i++)
-		glVertex2fv(ALienFace[i]);
-	glEnd();
+//Stands in for glutSolidSphere(1, ...) in the current color
+void DrawCachedSphere()
+{
+	int level = sphereLevel();
+	beginSphereDraws();
+	glDrawArrays(GL_TRIANGLES, sphereFirst[level], sphereCount[level]);
+	endSphereDraws();
+}
 
-	glBegin(GL_LINE_STRIP);      //EAR effect
-		glVertex2f(3.3,22);
-		glVertex2f(4.4,23.5);
-		glVertex2f(6.3,26);
-	glEnd();
+//Whole file as a string, looked up next to the executable's working directory first, then in the
+//build and source trees. Returns an empty string when it is nowhere
+std::string readResource(const char* name)
+{
+	const std::string candidates[3] = {
+		std::string("resources/") + name,
+		std::string(PROJECT_BINARY_DIR) + "/resources/" + name,
+		std::string(PROJECT_SOURCE_DIR) + "/resources/" + name
+	};
+	for(const std::string& path : candidates) {
+		FILE* file = fopen(path.c_str(), "rb");
+		if(!file)
+			continue;
+		std::string text;
+		char buffer[4096];
+		size_t read;
+		while((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			text.append(buffer, read);
+		fclose(file);
+		return text;
+	}
+	printf("ERROR::FILE_NOT_SUCCESSFULLY_READ: resources/%s\n", name);
+	return "";
 }
-void DrawAlienBeak()
+
+GLuint compileShader(GLenum type, const std::string& source)
 {
-	glColor3f(1,1,0);				//BEAK color
-	glBegin(GL_POLYGON);
-	for(int i=0;i<=14 ;i++)
-		glVertex2fv(ALienBeak[i]);
-	glEnd();
+	const char* code = source.c_str();
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 1, &code, NULL);
+	glCompileShader(shader);
+	GLint success;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if(!success) {
+		char infoLog[1024];
+		glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+		printf("ERROR::SHADER_COMPILATION_ERROR of type: %s\n%s\n", type == GL_VERTEX_SHADER ? "VERTEX" : "FRAGMENT", infoLog);
+		glDeleteShader(shader);
+		return 0;
+	}
+	return shader;
+}
 
-	glColor3f(0,0,0);				//BEAK outline
-	glBegin(GL_LINE_STRIP);
-	for(int i=0;i<=14 ;i++)
-		glVertex2fv(ALienBeak[i]);
-	glEnd();
+//Needs GL 3.2 for gl_InstanceID alongside the fixed-function matrices; older contexts (the legacy
+//macOS one GLUT creates, for instance) keep lightProgram at 0 and draw the lights one by one
+void buildLightProgram()
+{
+	if(!GLAD_GL_VERSION_3_2)
+		return;
+	std::string vertexCode = readResource("vs/light_instanced.vs");
+	std::string fragmentCode = readResource("fs/light_instanced.fs");
+	if(vertexCode.empty() || fragmentCode.empty())
+		return;
+	GLuint vertex = compileShader(GL_VERTEX_SHADER, vertexCode);
+	GLuint fragment = compileShader(GL_FRAGMENT_SHADER, fragmentCode);
+	if(vertex && fragment) {
+		GLuint program = glCreateProgram();
+		glAttachShader(program, vertex);
+		glAttachShader(program, fragment);
+		glLinkProgram(program);
+		GLint success;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if(success)
+			lightProgram = program;
+		else {
+			char infoLog[1024];
+			glGetProgramInfoLog(program, 1024, NULL, infoLog);
+			printf("ERROR::PROGRAM_LINKING_ERROR of type: PROGRAM\n%s\n", infoLog);
+			glDeleteProgram(program);
+		}
+	}
+	glDeleteShader(vertex);
+	glDeleteShader(fragment);
+	if(!lightProgram)
+		return;
+
+	//Same spots as before: scaled by 3, the first 20 units left of center, 5 apart
+	GLfloat offsets[LIGHT_COUNT][3];
+	for(int k=0;k<LIGHT_COUNT;k++) {
+		offsets[k][0] = 3 * (-20 + 5 * k);
+		offsets[k][1] = 0;
+		offsets[k][2] = 0;
+	}
+	glUseProgram(lightProgram);
+	glUniform3fv(glGetUniformLocation(lightProgram, "instanceOffset"), LIGHT_COUNT, &offsets[0][0]);
+	glUniform3f(glGetUniformLocation(lightProgram, "instanceScale"), 3, 3, 1);
+	lightColorLocation = glGetUniformLocation(lightProgram, "instanceColor");
+	glUseProgram(0);
+}
+
+void DrawShipLights()
+{
+	//Colors rotate through LightColor, starting at CI
+	GLfloat colors[LIGHT_COUNT][3];
+	for(int k=0;k<LIGHT_COUNT;k++)
+		memcpy(colors[k], LightColor[(CI+k)%3], sizeof(colors[k]));
+
+	glPushMatrix();
+	glScalef(3,3,1);
+	int level = sphereLevel();
+	glPopMatrix();
+
+	beginSphereDraws();
+	if(lightProgram) {
+		glUseProgram(lightProgram);
+		glUniform3fv(lightColorLocation, LIGHT_COUNT, &colors[0][0]);
+		glDrawArraysInstanced(GL_TRIANGLES, sphereFirst[level], sphereCount[level], LIGHT_COUNT);
+		glUseProgram(0);
+	}
+	else {
+		glPushMatrix();
+		glScalef(3,3,1);
+		glTranslated(-20,0,0);
+		for(int k=0;k<LIGHT_COUNT;k++) {
+			glColor3fv(colors[k]);
+			glDrawArrays(GL_TRIANGLES, sphereFirst[level], sphereCount[level]);
+			glTranslated(5,0,0);
+		}
+		glPopMatrix();
+	}
+	endSphereDraws();
 }
+
 void DrawAlienEyes(bool isPlayer1)
 {
 	// if(isPlayer1)
@@ -309,22 +558,19 @@ void DrawAlienEyes(bool isPlayer1)
 	glRotated(-10,0,0,1);
 	glTranslated(-6,32.5,0);      //Left eye
 	glScalef(2.5,4,0);
-	glutSolidSphere(1,20,30);
+	DrawCachedSphere();
 	glPopMatrix();
 
 	glPushMatrix();
 	glRotated(-1,0,0,1);
 	glTranslated(-8,36,0);							//Right eye
 	glScalef(2.5,4,0);
-	glutSolidSphere(1,100,100);
+	DrawCachedSphere();
 	glPopMatrix();
 }
 void DrawAlien(bool isPlayer1)
 {
-	DrawAlienBody(isPlayer1);
-	DrawAlienCollar();
-	DrawAlienFace(isPlayer1);
-	DrawAlienBeak();
+	DrawAlienSprite(isPlayer1);
 	DrawAlienEyes(isPlayer1);
 }
 void DrawSpaceshipBody(bool isPlayer1)
@@ -336,40 +582,10 @@ void DrawSpaceshipBody(bool isPlayer1)
 
 	glPushMatrix();
 	glScalef(70,20,1);
-	glutSolidSphere(1,50,50);
+	DrawCachedSphere();
 	glPopMatrix();
 
-	glPushMatrix();							//LIGHTS
-	glScalef(3,3,1);
-	glTranslated(-20,0,0);			//1
-	glColor3fv(LightColor[(CI+0)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//2
-	glColor3fv(LightColor[(CI+1)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//3
-	glColor3fv(LightColor[(CI+2)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//4
-	glColor3fv(LightColor[(CI+0)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//5
-	glColor3fv(LightColor[(CI+1)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//6
-	glColor3fv(LightColor[(CI+2)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//7
-	glColor3fv(LightColor[(CI+0)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//8
-	glColor3fv(LightColor[(CI+1)%3]);
-	glutSolidSphere(1,1000,1000);
-	glTranslated(5,0,0);					//9
-	glColor3fv(LightColor[(CI+2)%3]);
-	glutSolidSphere(1,1000,1000);
-
-	glPopMatrix();
+	DrawShipLights();						//LIGHTS
 }
 void DrawSteeringWheel()
 {
@@ -388,27 +604,26 @@ void DrawSpaceshipDoom()
 	glPushMatrix();
 	glTranslated(0,30,0);
 	glScalef(35,50,1);
-	glutSolidSphere(1,50,50);
+	DrawCachedSphere();
 	glPopMatrix();
 }
 
-void DrawLaser(int x, int y, bool dir[]) {
-	//glPushMatrix();
-	int xend = -XMAX, yend = y;
-	if(dir[0])
-		yend = YMAX;
-	else if(dir[1])
-		yend = -YMAX;
+//Laser bolts in screen space, each a short streak behind where it is alpha of the way through the tick
+void DrawLasers(float alpha) {
+	const ProjectilePool& lasers = game.lasers;
 	glLineWidth(5);
 	glColor3f(1, 0, 0);
 	glBegin(GL_LINES);
+	for(int i=0;i<lasers.count;i++) {
+		float x = lasers.x[i] - lasers.vx[i] * (1 - alpha);
+		float y = lasers.y[i] - lasers.vy[i] * (1 - alpha);
+		glVertex2f(x - lasers.vx[i], y - lasers.vy[i]);
 		glVertex2f(x, y);
-		glVertex2f(xend, yend);
+	}
 	glEnd();
-	//glPopMatrix();
 }
 
-void SpaceshipCreate(int x, int y, bool isPlayer1){
+void SpaceshipCreate(float x, float y, bool isPlayer1){
 	glPushMatrix();
 	glTranslated(x,y,0);
 	// if(!checkIfSpaceShipIsSafe() && alienLife1 ){
@@ -430,95 +645,48 @@ void SpaceshipCreate(int x, int y, bool isPlayer1){
 	glPopMatrix();
 }
 
-void DisplayHealthBar1() {
+void DisplayHealthBar1() {				//PLAYER 1, the ship on the left
 	char temp1[40];
 	glColor3f(1 ,1 ,1);
-	sprintf(temp1,"  LIFE = %d",alienLife1);
+	sprintf(temp1,"  LIFE = %d",game.ships[1].life);
 	displayRasterText(-1100 ,600 ,0.4 ,temp1);
 	glColor3f(1 ,0 ,0);
 }
 
-void DisplayHealthBar2() {
+void DisplayHealthBar2() {				//PLAYER 2, on the right
 	char temp2[40];
 	glColor3f(1 ,1 ,1);
-	sprintf(temp2,"  LIFE = %d",alienLife2);
+	sprintf(temp2,"  LIFE = %d",game.ships[0].life);
 	displayRasterText(800 ,600 ,0.4 ,temp2);
 	glColor3f(1 ,0 ,0);
 }
 
-void checkLaserContact(int x, int y, bool dir[], int xp, int yp, bool player1) {
-	int xend = -XMAX, yend = y;
-	xp += 8; yp += 8; // moving circle slightly up to fix laser issue
-	if(dir[0])
-		yend = YMAX;
-	else if(dir[1])
-		yend = -YMAX;
-
-	// Here we find out if the laser(line) intersects with spaceship(circle)
-	// by solving the equations for the same and finding the discriminant of the
-	// quadratic equation obtained
-	float m = (float)(yend - y) / (float)(xend - x);
-	float k = y - m * x ;
-	int r = 50; // approx radius of the spaceship
-
-	//calculating value of b, a, and c needed to find discriminant
-	float b = 2 * xp - 2 * m * (k - yp);
-	float a = 1 + m * m;
-	float c = xp * xp + (k - yp) * (k - yp) - r * r;
-
-	float d = (b * b - 4 * a * c); // discriminant for the equation
-	printf("\nDisc: %f x: %d, y: %d, xp: %d, yp: %d", d, x, y, xp, yp);
-	if(d >= 0) {
-		if(player1)
-			alienLife1 -= 5;
-		else
-			alienLife2 -= 5;
-
-		printf("%d %d\n", alienLife1, alienLife2);
-	}
-}
-
-void gameScreenDisplay()
+//Draws the ships alpha of the way from the previous tick to the current one
+void gameScreenDisplay(float alpha)
 {
 	DisplayHealthBar1();
 	DisplayHealthBar2();
 	glScalef(2, 2 ,0);
 
-	if(alienLife1 > 0){
-		SpaceshipCreate(xOne, yOne, true);
-		if(laser1) {
-			DrawLaser(xOne, yOne, laser1Dir);
-			checkLaserContact(xOne, yOne, laser1Dir, -xTwo, yTwo, true);
-		}
-	}
-	else {
-		viewPage = GAMEOVER;
-	}
-
-	if(alienLife2 > 0) {
+	for(int p=0;p<2;p++) {
+		Ship& ship = game.ships[p];
+		if(ship.life <= 0)
+			continue;
+		float x = ship.prevX + (ship.x - ship.prevX) * alpha;
+		float y = ship.prevY + (ship.y - ship.prevY) * alpha;
 		glPushMatrix();
-		glScalef(-1, 1, 1);
-		SpaceshipCreate(xTwo, yTwo, false);
-		if(laser2) {
-			DrawLaser(xTwo, yTwo, laser2Dir);
-			checkLaserContact(xTwo, yTwo, laser2Dir, -xOne, yOne, false);
-		}
+		if(p == 1)
+			glScalef(-1, 1, 1);			//player 2 faces the other way
+		SpaceshipCreate(x, y, p == 0);
 		glPopMatrix();
 	}
-	else {
-		viewPage = GAMEOVER;
-	}
-
-	if(viewPage == GAMEOVER) {
-		xOne = xTwo = 500;
-		yOne = yTwo = 0;
-	}
+	DrawLasers(alpha);
 }
 
 void displayGameOverMessage() {
 	glColor3f(1, 1, 0);
 	char* message;
-	if(alienLife1 > 0)
+	if(game.ships[1].life > 0)
 		message = "Game Over! Player 1 won the game";
 	else
 		message = "Game Over! Player 2 won the game";
@@ -526,47 +694,55 @@ void displayGameOverMessage() {
 	displayRasterText(-350 ,600 ,0.4 , message);
 }
 
-void keyOperations() {
-	if(keyStates[13] == true && viewPage == INTRO) {
-		viewPage = MENU;
-		printf("view value changed to %d", viewPage);
-		printf("enter key pressed\n");
+GameInputs readInputs() {
+	GameInputs inputs;
+	PlayerInput& one = inputs.players[0];
+	one.up = keyStates['i'], one.down = keyStates['k'], one.left = keyStates['j'], one.right = keyStates['l'];
+	one.fire = keyStates['m'];
+	PlayerInput& two = inputs.players[1];
+	two.up = keyStates['w'], two.down = keyStates['s'], two.left = keyStates['a'], two.right = keyStates['d'];
+	two.fire = keyStates['c'];
+	return inputs;
+}
+
+//One fixed step of the game from the keys held now
+void tick() {
+	GameInputs inputs = readInputs();
+	step(game, inputs);
+	if(inputRecording) {
+		uint8_t bytes[2] = {packInput(inputs.players[0]), packInput(inputs.players[1])};
+		fwrite(bytes, 1, 2, inputRecording);
 	}
-	if(viewPage == GAME) {
-		laser1Dir[0] = laser1Dir[1] = false;
-		laser2Dir[0] = laser2Dir[1] = false;
-		if(keyStates['c'] == true) {
-			laser2 = true;
-			if(keyStates['w'] == true) 	laser2Dir[0] = true;
-			if(keyStates['s'] == true) 	laser2Dir[1] = true;
-		}
-		else {
-			laser2 = false;
-			if(keyStates['d'] == true) xTwo-=SPACESHIP_SPEED;
-			if(keyStates['a'] == true) xTwo+=SPACESHIP_SPEED;
-			if(keyStates['w'] == true) yTwo+=SPACESHIP_SPEED;
-			if(keyStates['s'] == true) yTwo-=SPACESHIP_SPEED;
+	if(game.over) {
+		gamesPlayed++;
+		if(inputRecording) {
+			fflush(inputRecording);
+			printf("game %d: %u ticks, state hash %016llx\n", gamesPlayed, game.ticks, (unsigned long long)hashGameState(game));
 		}
+		setViewPage(GAMEOVER);
+	}
+}
 
-		if(keyStates['m'] == true) {
-			laser1 = true;
-			if(keyStates['i'] == true) laser1Dir[0] = true;
-			if(keyStates['k'] == true) laser1Dir[1] = true;
-		}
-		else {
-			laser1 = false;
-			if(keyStates['l'] == true) xOne+=SPACESHIP_SPEED;
-			if(keyStates['j'] == true) xOne-=SPACESHIP_SPEED;
-			if(keyStates['i'] == true) yOne+=SPACESHIP_SPEED;
-			if(keyStates['k'] == true) yOne-=SPACESHIP_SPEED;
-		}
+//Runs the ticks that real time since the last frame calls for
+void advanceGame() {
+	int now = glutGet(GLUT_ELAPSED_TIME);
+	double frameTime = (now - lastFrameTime) / 1000.0;
+	lastFrameTime = now;
+	if(frameTime > MAX_FRAME_TIME)
+		frameTime = MAX_FRAME_TIME;
+
+	tickAccumulator += frameTime;
+	while(tickAccumulator >= TICK_DT && viewPage == GAME) {
+		tick();
+		tickAccumulator -= TICK_DT;
 	}
 }
 
 void display()
 {
 	//glClearColor(, 0 , 0, 1);
-	keyOperations();
+	if(viewPage == GAME)
+		advanceGame();
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	switch (viewPage)
@@ -581,7 +757,7 @@ void display()
 			instructionsScreenDisplay();
 			break;
 		case GAME:
-			gameScreenDisplay();
+			gameScreenDisplay(tickAccumulator / TICK_DT);
 			//reset scaling values
 			glScalef(1/2 ,1/2 ,0);
 			break;
@@ -636,11 +812,8 @@ void mouseClick(int buttonPressed ,int state ,int x, int y) {
 void keyPressed(unsigned char key, int x, int y)
 {
 	keyStates[key] = true;
-	glutPostRedisplay();
-}
-
-void refresh() {
-	glutPostRedisplay();
+	if(key == 13 && viewPage == INTRO)
+		setViewPage(MENU);
 }
 
 void keyReleased(unsigned char key, int x, int y) {
@@ -650,13 +823,23 @@ void keyReleased(unsigned char key, int x, int y) {
 int main(int argc, char **argv)
 {
 	glutInit(&argc, argv);
-	glutInitDisplayMode(GLUT_SINGLE|GLUT_RGB);
+	glutInitDisplayMode(GLUT_DOUBLE|GLUT_RGB);
     glutInitWindowPosition(0, 0);
     glutInitWindowSize(1200, 600);
     glutCreateWindow("Space Shooter");
+	for(int i=1;i+1<argc;i++)
+		if(strcmp(argv[i], "--record") == 0 && !(inputRecording = fopen(argv[i+1], "wb")))
+			printf("Could not open %s for recording\n", argv[i+1]);
+	if(!gladLoadGL()) {
+		printf("Failed to initialize GLAD\n");
+		return -1;
+	}
     init();
+	resetGame(game);
+	buildAlienSprite();
+	buildSphereCache();
+	buildLightProgram();
     //glutReshapeFunc(reshape);
-	glutIdleFunc(refresh);
     glutKeyboardFunc(keyPressed);
 	glutKeyboardUpFunc(keyReleased);
 	glutMouseFunc(mouseClick);
@@ -0,0 +1,187 @@
+#include "projectiles.h"
+
+#include <math.h>
+
+namespace {
+
+int clampCell(int cell, int cells)
+{
+	return cell < 0 ? 0 : (cell >= cells ? cells - 1 : cell);
+}
+
+int cellColumn(const TargetGrid& grid, float x)
+{
+	return clampCell((int)floorf((x - grid.minX) / grid.cellSize), grid.columns);
+}
+
+int cellRow(const TargetGrid& grid, float y)
+{
+	return clampCell((int)floorf((y - grid.minY) / grid.cellSize), grid.rows);
+}
+
+void buildTargetGrid(TargetGrid& grid, const float* x, const float* y, const float* radius, int targets)
+{
+	for(int t=0;t<targets;t++) {
+		if(radius[t] <= 0)
+			continue;
+		int c0 = cellColumn(grid, x[t] - radius[t]), c1 = cellColumn(grid, x[t] + radius[t]);
+		int r0 = cellRow(grid, y[t] - radius[t]), r1 = cellRow(grid, y[t] + radius[t]);
+		for(int row=r0;row<=r1;row++)
+			for(int column=c0;column<=c1;column++) {
+				int cell = row * grid.columns + column;
+				if(grid.cellHead[cell] < 0)
+					grid.usedCells.push_back(cell);
+				grid.nodeNext.push_back(grid.cellHead[cell]);
+				grid.nodeTarget.push_back((uint16_t)t);
+				grid.cellHead[cell] = (int)grid.nodeTarget.size() - 1;
+			}
+	}
+}
+
+void clearTargetGrid(TargetGrid& grid)
+{
+	for(int cell : grid.usedCells)
+		grid.cellHead[cell] = -1;
+	grid.usedCells.clear();
+	grid.nodeNext.clear();
+	grid.nodeTarget.clear();
+}
+
+void removeProjectile(ProjectilePool& pool, int i)
+{
+	int last = --pool.count;
+	pool.x[i] = pool.x[last];
+	pool.y[i] = pool.y[last];
+	pool.vx[i] = pool.vx[last];
+	pool.vy[i] = pool.vy[last];
+	pool.owner[i] = pool.owner[last];
+	pool.ticksLeft[i] = pool.ticksLeft[last];
+}
+
+}
+
+bool sweepSegmentCircle(float p0x, float p0y, float dx, float dy, float cx, float cy, float radius, float& t)
+{
+	float fx = cx - p0x, fy = cy - p0y;
+	float c = fx * fx + fy * fy - radius * radius;
+	if(c <= 0) {
+		t = 0;
+		return true;
+	}
+	float a = dx * dx + dy * dy;
+	float b = fx * dx + fy * dy;		//along the path towards the center
+	if(a <= 0 || b <= 0)
+		return false;
+	float discriminant = b * b - a * c;
+	if(discriminant < 0)
+		return false;
+	t = (b - sqrtf(discriminant)) / a;
+	return t <= 1;
+}
+
+void initProjectiles(ProjectilePool& pool, int capacity, float minX, float minY, float maxX, float maxY, float cellSize)
+{
+	pool.capacity = capacity;
+	pool.count = 0;
+	pool.minX = minX, pool.minY = minY, pool.maxX = maxX, pool.maxY = maxY;
+	pool.x.assign(capacity, 0);
+	pool.y.assign(capacity, 0);
+	pool.vx.assign(capacity, 0);
+	pool.vy.assign(capacity, 0);
+	pool.owner.assign(capacity, 0);
+	pool.ticksLeft.assign(capacity, 0);
+
+	TargetGrid& grid = pool.grid;
+	grid.minX = minX, grid.minY = minY, grid.cellSize = cellSize;
+	grid.columns = (int)ceilf((maxX - minX) / cellSize);
+	grid.rows = (int)ceilf((maxY - minY) / cellSize);
+	if(grid.columns < 1) grid.columns = 1;
+	if(grid.rows < 1) grid.rows = 1;
+	grid.cellHead.assign(grid.columns * grid.rows, -1);
+	clearTargetGrid(grid);
+	pool.testedAt.clear();
+	pool.testStamp = 0;
+}
+
+void clearProjectiles(ProjectilePool& pool)
+{
+	pool.count = 0;
+}
+
+bool spawnProjectile(ProjectilePool& pool, float x, float y, float vx, float vy, uint16_t owner, uint16_t ticks)
+{
+	if(pool.count >= pool.capacity)
+		return false;
+	int i = pool.count++;
+	pool.x[i] = x;
+	pool.y[i] = y;
+	pool.vx[i] = vx;
+	pool.vy[i] = vy;
+	pool.owner[i] = owner;
+	pool.ticksLeft[i] = ticks;
+	return true;
+}
+
+int stepProjectiles(ProjectilePool& pool, const float* targetX, const float* targetY, const float* targetRadius, int targets, std::vector<ProjectileHit>& hits)
+{
+	if(pool.count == 0)
+		return 0;
+	TargetGrid& grid = pool.grid;
+	buildTargetGrid(grid, targetX, targetY, targetRadius, targets);
+	if((int)pool.testedAt.size() < targets)
+		pool.testedAt.resize(targets, 0);
+	//Stamps only need to differ within a step; start over well before they could wrap
+	if(pool.testStamp > 0x7fffffffu) {
+		for(uint32_t& stamp : pool.testedAt)
+			stamp = 0;
+		pool.testStamp = 0;
+	}
+
+	int hitCount = 0;
+	int i = 0;
+	while(i < pool.count) {
+		float x = pool.x[i], y = pool.y[i];
+		float dx = pool.vx[i], dy = pool.vy[i];
+		uint32_t stamp = ++pool.testStamp;
+
+		int c0 = cellColumn(grid, dx < 0 ? x + dx : x), c1 = cellColumn(grid, dx < 0 ? x : x + dx);
+		int r0 = cellRow(grid, dy < 0 ? y + dy : y), r1 = cellRow(grid, dy < 0 ? y : y + dy);
+		int hitTarget = -1;
+		float hitT = 2;
+		for(int row=r0;row<=r1;row++)
+			for(int column=c0;column<=c1;column++) {
+				for(int node=grid.cellHead[row * grid.columns + column];node>=0;node=grid.nodeNext[node]) {
+					int t = grid.nodeTarget[node];
+					if(pool.testedAt[t] == stamp || t == pool.owner[i])
+						continue;
+					pool.testedAt[t] = stamp;
+					float entry;
+					//Nearest along the path; the lower index on a tie so the result never depends on cell order
+					if(sweepSegmentCircle(x, y, dx, dy, targetX[t], targetY[t], targetRadius[t], entry)
+					   && (entry < hitT || (entry == hitT && t < hitTarget))) {
+						hitT = entry;
+						hitTarget = t;
+					}
+				}
+			}
+
+		if(hitTarget >= 0) {
+			ProjectileHit hit = {(uint16_t)hitTarget, pool.owner[i], x + dx * hitT, y + dy * hitT};
+			hits.push_back(hit);
+			hitCount++;
+			removeProjectile(pool, i);
+			continue;
+		}
+		x += dx;
+		y += dy;
+		if(--pool.ticksLeft[i] == 0 || x < pool.minX || x > pool.maxX || y < pool.minY || y > pool.maxY) {
+			removeProjectile(pool, i);
+			continue;
+		}
+		pool.x[i] = x;
+		pool.y[i] = y;
+		i++;
+	}
+	clearTargetGrid(grid);
+	return hitCount;
+}
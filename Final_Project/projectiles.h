@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+//PROJECTILES: a fixed-capacity pool stored as parallel arrays, moved and collided in one pass per
+//tick. A projectile's path over a tick is a segment, tested against the target circles in the
+//uniform grid cells it crosses. Fast shots cannot skip through a ship, and the cost follows the
+//shots and the targets near them instead of shots times targets. No GL, and once the first steps
+//have sized the grid's lists, no allocation either.
+
+struct ProjectileHit {
+	uint16_t target;
+	uint16_t owner;
+	float x, y;						//where the path entered the circle
+};
+
+//Target indices bucketed by every cell their circle's bounding box overlaps, as a list per cell;
+//targets past the edges go in the edge cells. Only the cells used are reset after a step, so the
+//cost follows the targets rather than the size of the grid
+struct TargetGrid {
+	float minX = 0, minY = 0, cellSize = 1;
+	int columns = 0, rows = 0;
+	std::vector<int> cellHead;		//first node per cell, -1 when empty
+	std::vector<int> nodeNext;
+	std::vector<uint16_t> nodeTarget;
+	std::vector<int> usedCells;
+};
+
+struct ProjectilePool {
+	int capacity = 0;
+	int count = 0;					//[0, count) are live, in no particular order
+	float minX = 0, minY = 0, maxX = 0, maxY = 0;	//projectiles leaving these are dropped
+	std::vector<float> x, y;
+	std::vector<float> vx, vy;		//units per tick
+	std::vector<uint16_t> owner;	//the target that fired it, which it never hits
+	std::vector<uint16_t> ticksLeft;
+
+	TargetGrid grid;
+	std::vector<uint32_t> testedAt;	//per target, the last segment test it was in, so targets spanning cells are tested once
+	uint32_t testStamp = 0;
+};
+
+//Sizes every array for `capacity` projectiles. Bounds cover the play area; cellSize about twice the
+//largest target radius works well
+void initProjectiles(ProjectilePool& pool, int capacity, float minX, float minY, float maxX, float maxY, float cellSize);
+void clearProjectiles(ProjectilePool& pool);
+//False when the pool is full
+bool spawnProjectile(ProjectilePool& pool, float x, float y, float vx, float vy, uint16_t owner, uint16_t ticks);
+
+//Moves every projectile one tick against the target circles (arrays of `targets` centers and radii;
+//a radius of 0 or less leaves a target out). A projectile that hits is removed and appended to
+//`hits`, the nearest target along its path winning; ones that leave the bounds or run out of ticks
+//are removed quietly. Returns the number of hits. Reserve `hits` to keep the step allocation free.
+int stepProjectiles(ProjectilePool& pool, const float* targetX, const float* targetY, const float* targetRadius, int targets, std::vector<ProjectileHit>& hits);
+
+//Entry point of segment p0 + t * d, t in [0, 1], into the circle around c: t at the first touch, 0
+//when p0 is already inside. Returns false when the segment misses
+bool sweepSegmentCircle(float p0x, float p0y, float dx, float dy, float cx, float cy, float radius, float& t);
@@ -0,0 +1,7 @@
+#version 150 compatibility
+flat in vec3 lightColor;
+
+void main()
+{
+    gl_FragColor = vec4(lightColor, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 150 compatibility
+// Ship lights: one unit sphere mesh, one instance per light
+uniform vec3 instanceOffset[9];
+uniform vec3 instanceColor[9];
+uniform vec3 instanceScale;
+
+flat out vec3 lightColor;
+
+void main()
+{
+    vec3 position = gl_Vertex.xyz * instanceScale + instanceOffset[gl_InstanceID];
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(position, 1.0);
+    lightColor = instanceColor[gl_InstanceID];
+}
@@ -0,0 +1,216 @@
+//Checks for the GL-free game rules: projectile sweeps and the grid broadphase, the pool's capacity,
+//and that the same inputs replay to the same state. Exits non-zero when a check fails.
+#include "game_state.h"
+
+#include "check.hpp"
+
+#include <math.h>
+#include <vector>
+
+namespace {
+
+//Play area of 1000 x 1000 in cells of 100
+void initArea(ProjectilePool& pool, int capacity)
+{
+	initProjectiles(pool, capacity, 0, 0, 1000, 1000, 100);
+}
+
+void fastProjectileCannotTunnel()
+{
+	ProjectilePool pool;
+	initArea(pool, 8);
+	std::vector<ProjectileHit> hits;
+	//One target in the middle, 100 across; the bolt moves 900 in one tick, from one side to the other
+	float x[1] = {500}, y[1] = {500}, radius[1] = {50};
+	CHECK(spawnProjectile(pool, 50, 510, 900, 0, 7, 10));
+	CHECK(stepProjectiles(pool, x, y, radius, 1, hits) == 1);
+	CHECK(hits.size() == 1);
+	CHECK(hits[0].target == 0);
+	CHECK(hits[0].owner == 7);
+	//Entered on the near side of the circle
+	CHECK(fabsf(hits[0].x - (500 - sqrtf(50 * 50 - 10 * 10))) < 0.01f);
+	CHECK(fabsf(hits[0].y - 510) < 0.01f);
+	CHECK(pool.count == 0);
+
+	//Two targets on the path: the nearer one takes the hit
+	float x2[2] = {800, 300}, y2[2] = {500, 500}, radius2[2] = {50, 50};
+	hits.clear();
+	CHECK(spawnProjectile(pool, 50, 500, 900, 0, 7, 10));
+	CHECK(stepProjectiles(pool, x2, y2, radius2, 2, hits) == 1);
+	CHECK(hits.size() == 1 && hits[0].target == 1);
+
+	//Never hits its owner, even starting inside it
+	hits.clear();
+	CHECK(spawnProjectile(pool, 500, 500, 900, 0, 0, 10));
+	CHECK(stepProjectiles(pool, x, y, radius, 1, hits) == 0);
+	CHECK(pool.count == 0);		//flew out of the bounds
+}
+
+void hitsAcrossCellBoundaries()
+{
+	ProjectilePool pool;
+	initArea(pool, 8);
+	std::vector<ProjectileHit> hits;
+
+	//Target centered on a cell corner, so its circle spans four cells; each bolt stays in one of them
+	float x[1] = {300}, y[1] = {300}, radius[1] = {30};
+	const float paths[4][4] = {
+		{210, 290, 80, 0},		//left of the corner, below it, moving right
+		{390, 310, -80, 0},		//right of it, above it, moving left
+		{290, 390, 0, -80},
+		{310, 210, 0, 80},
+	};
+	for(const float* path : paths) {
+		hits.clear();
+		CHECK(spawnProjectile(pool, path[0], path[1], path[2], path[3], 1, 10));
+		CHECK(stepProjectiles(pool, x, y, radius, 1, hits) == 1);
+		CHECK(hits.size() == 1 && hits[0].target == 0);
+		CHECK(pool.count == 0);
+	}
+
+	//Path crossing from one cell into the next, target only in the far cell
+	float x2[1] = {470}, y2[1] = {150}, radius2[1] = {20};
+	hits.clear();
+	CHECK(spawnProjectile(pool, 310, 150, 150, 0, 1, 10));
+	CHECK(stepProjectiles(pool, x2, y2, radius2, 1, hits) == 1);
+
+	//Grazing past a target in a shared cell without touching it
+	float x3[1] = {500}, y3[1] = {500}, radius3[1] = {20};
+	hits.clear();
+	CHECK(spawnProjectile(pool, 420, 521, 160, 0, 1, 10));
+	CHECK(stepProjectiles(pool, x3, y3, radius3, 1, hits) == 0);
+	CHECK(pool.count == 1);
+
+	//Targets past the edges of the area still collide in the edge cells
+	float x4[1] = {1020}, y4[1] = {500}, radius4[1] = {40};
+	clearProjectiles(pool);
+	hits.clear();
+	CHECK(spawnProjectile(pool, 950, 500, 60, 0, 1, 10));
+	CHECK(stepProjectiles(pool, x4, y4, radius4, 1, hits) == 1);
+}
+
+void poolAtCapacity()
+{
+	ProjectilePool pool;
+	initArea(pool, 4);
+	std::vector<ProjectileHit> hits;
+	for(int i=0;i<4;i++)
+		CHECK(spawnProjectile(pool, 100, 100 + 100 * i, 10, 0, 9, (uint16_t)(i + 1)));
+	CHECK(pool.count == 4);
+	CHECK(!spawnProjectile(pool, 100, 100, 10, 0, 9, 5));
+	CHECK(pool.count == 4);
+
+	//The one with a single tick left runs out and frees a slot
+	CHECK(stepProjectiles(pool, NULL, NULL, NULL, 0, hits) == 0);
+	CHECK(pool.count == 3);
+	CHECK(spawnProjectile(pool, 100, 100, 10, 0, 9, 5));
+	CHECK(!spawnProjectile(pool, 100, 100, 10, 0, 9, 5));
+
+	//A full pool all hitting in one step empties it
+	float x[1] = {300}, y[1] = {300}, radius[1] = {400};
+	CHECK(stepProjectiles(pool, x, y, radius, 1, hits) == 4);
+	CHECK(hits.size() == 4);
+	CHECK(pool.count == 0);
+
+	clearProjectiles(pool);
+	for(int i=0;i<4;i++)
+		CHECK(spawnProjectile(pool, 100, 100, 10, 0, 9, 5));
+	clearProjectiles(pool);
+	CHECK(pool.count == 0);
+
+	//The game's own pool: holding fire for long enough never spawns past it
+	GameState game;
+	resetGame(game);
+	CHECK(game.lasers.capacity == MAX_LASERS);
+	GameInputs inputs = {};
+	inputs.players[0].fire = inputs.players[1].fire = true;
+	for(int tick=0;tick<LASER_TICKS * 2;tick++) {
+		step(game, inputs);
+		CHECK(game.lasers.count <= game.lasers.capacity);
+	}
+}
+
+//xorshift32, the same sequence everywhere for a given seed
+uint32_t nextRandom(uint32_t& state)
+{
+	state ^= state << 13;
+	state ^= state >> 17;
+	state ^= state << 5;
+	return state;
+}
+
+//Lines up with the other ship and fires, with a random input held now and then
+PlayerInput aimInput(const GameState& game, int ship, uint32_t& random)
+{
+	uint32_t r = nextRandom(random);
+	if((r & 7) == 0)
+		return unpackInput((uint8_t)((r >> 3) & 31));
+	float dy = game.ships[1 - ship].y - game.ships[ship].y;
+	if(dy > SHIP_RADIUS / 2)
+		return unpackInput(1);		//up
+	if(dy < -SHIP_RADIUS / 2)
+		return unpackInput(2);		//down
+	return unpackInput(16);			//fire
+}
+
+//Plays from packed inputs, restarting after each game, and returns a hash of every state. With
+//`record` set the inputs are chosen by aimInput() and appended instead, `ticks` of them
+uint64_t play(std::vector<uint8_t>& recording, bool record, int ticks, int& games, int& hits)
+{
+	GameState game;
+	resetGame(game);
+	uint32_t random = 12345;
+	uint64_t hash = 14695981039346656037ull;
+	games = 0;
+	hits = 0;
+	for(int tick=0;tick<ticks;tick++) {
+		GameInputs inputs;
+		for(int player=0;player<2;player++) {
+			if(record)
+				recording.push_back(packInput(aimInput(game, player, random)));
+			inputs.players[player] = unpackInput(recording[tick * 2 + player]);
+		}
+		int life = game.ships[0].life + game.ships[1].life;
+		step(game, inputs);
+		hits += (life - game.ships[0].life - game.ships[1].life) / LASER_DAMAGE;
+		hash = (hash ^ hashGameState(game)) * 1099511628211ull;
+		if(game.over) {
+			games++;
+			resetGame(game);
+		}
+	}
+	return hash;
+}
+
+void replayMatches()
+{
+	const int ticks = 20000;
+	std::vector<uint8_t> recording;
+	int games[2], hits[2];
+	uint64_t first = play(recording, true, ticks, games[0], hits[0]);
+	uint64_t second = play(recording, false, ticks, games[1], hits[1]);
+	CHECK(first == second);
+	CHECK(games[0] == games[1] && hits[0] == hits[1]);
+	//The run exercised the lasers and finished games, not just movement
+	CHECK(hits[0] > 0);
+	CHECK(games[0] > 0);
+
+	//A single changed input changes the hash
+	recording[recording.size() / 2] ^= 16;
+	CHECK(play(recording, false, ticks, games[1], hits[1]) != first);
+
+	//Inputs survive the one byte packing
+	for(int bits=0;bits<32;bits++)
+		CHECK(packInput(unpackInput((uint8_t)bits)) == bits);
+}
+
+}
+
+int main()
+{
+	fastProjectileCannotTunnel();
+	hitsAcrossCellBoundaries();
+	poolAtCapacity();
+	replayMatches();
+	return Common::Test::checkResult();
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Common {
+    // Axis-aligned box; default constructed it is empty and absorbs whatever is merged into it
+    struct Bounds {
+        glm::vec3 min = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 max = glm::vec3(-std::numeric_limits<float>::max());
+
+        Bounds() = default;
+        Bounds(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+        bool empty() const { return min.x > max.x || min.y > max.y || min.z > max.z; }
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+        glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+        float surfaceArea() const {
+            if (empty())
+                return 0.0f;
+            glm::vec3 size = max - min;
+            return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+        }
+
+        void expand(const glm::vec3& point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+        void expand(const Bounds& other) {
+            min = glm::min(min, other.min);
+            max = glm::max(max, other.max);
+        }
+
+        bool contains(const Bounds& other) const {
+            return min.x <= other.min.x && min.y <= other.min.y && min.z <= other.min.z &&
+                   max.x >= other.max.x && max.y >= other.max.y && max.z >= other.max.z;
+        }
+        bool overlaps(const Bounds& other) const {
+            return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y &&
+                   min.z <= other.max.z && max.z >= other.min.z;
+        }
+        bool operator==(const Bounds& other) const { return min == other.min && max == other.max; }
+        bool operator!=(const Bounds& other) const { return !(*this == other); }
+    };
+
+    inline Bounds merge(const Bounds& a, const Bounds& b) {
+        Bounds result = a;
+        result.expand(b);
+        return result;
+    }
+
+    // Tight box around `local` after an affine transform: each output axis takes the larger and the
+    // smaller of every matrix entry times the box's extremes (Arvo)
+    inline Bounds transformBounds(const Bounds& local, const glm::mat4& model) {
+        glm::vec3 translation(model[3]);
+        Bounds result(translation, translation);
+        for (int column = 0; column < 3; column++) {
+            for (int row = 0; row < 3; row++) {
+                float a = model[column][row] * local.min[column];
+                float b = model[column][row] * local.max[column];
+                result.min[row] += std::min(a, b);
+                result.max[row] += std::max(a, b);
+            }
+        }
+        return result;
+    }
+
+    // Six planes (xyz normal pointing inwards, w offset): a point p is inside when dot(xyz, p) + w >= 0
+    struct FrustumPlanes {
+        enum { Left, Right, Bottom, Top, Near, Far, Count };
+        glm::vec4 planes[Count];
+    };
+
+    // Gribb/Hartmann: the planes are sums and differences of the view-projection rows, normalized
+    // so plane distances are in world units. Works for any GL-style projection
+    inline FrustumPlanes extractFrustumPlanes(const glm::mat4& viewProjection) {
+        glm::vec4 row[4];
+        for (int i = 0; i < 4; i++)
+            row[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        FrustumPlanes frustum;
+        frustum.planes[FrustumPlanes::Left] = row[3] + row[0];
+        frustum.planes[FrustumPlanes::Right] = row[3] - row[0];
+        frustum.planes[FrustumPlanes::Bottom] = row[3] + row[1];
+        frustum.planes[FrustumPlanes::Top] = row[3] - row[1];
+        frustum.planes[FrustumPlanes::Near] = row[3] + row[2];
+        frustum.planes[FrustumPlanes::Far] = row[3] - row[2];
+        for (glm::vec4& plane : frustum.planes)
+            plane = plane / glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
+    enum class Containment { Outside, Intersecting, Inside };
+
+    inline Containment classify(const FrustumPlanes& frustum, const Bounds& bounds) {
+        glm::vec3 center = bounds.center();
+        glm::vec3 extents = bounds.extents();
+        Containment result = Containment::Inside;
+        for (const glm::vec4& plane : frustum.planes) {
+            glm::vec3 normal(plane);
+            float distance = glm::dot(normal, center) + plane.w;
+            float radius = glm::dot(glm::abs(normal), extents);
+            if (distance < -radius)
+                return Containment::Outside;
+            if (distance < radius)
+                result = Containment::Intersecting;
+        }
+        return result;
+    }
+}
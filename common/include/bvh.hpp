@@ -0,0 +1,191 @@
+#pragma once
+
+#include "bounds.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Common {
+    // Dynamic bounding volume hierarchy over world space boxes, one item per leaf. Moving items
+    // refit only the ancestors whose bounds actually change; insertions pick their sibling by
+    // surface area cost. Refitting lets the tree degrade as things move, so optimize() measures the
+    // SAH cost against the cost after the last rebuild and rebuilds top-down with binned SAH past a
+    // threshold. Queries prune whole subtrees, and subtrees entirely inside a frustum are reported
+    // without testing their boxes, so culling cost follows the visible set rather than world size.
+    //
+    // Proxies (returned by insert) are leaf node indices and stay valid across rebuilds.
+    class Bvh {
+    public:
+        static const int Null = -1;
+
+        int insert(const Bounds& bounds, uint32_t item);
+        void remove(int proxy);
+        void update(int proxy, const Bounds& bounds);
+
+        // Rebuilds if cost() grew past `degradation` times the cost after the last rebuild; call once a frame
+        bool optimize(float degradation = 1.5f);
+        void rebuild();
+        // Sum of internal node surface areas relative to the root: expected node visits per random query
+        float cost() const;
+
+        size_t size() const { return proxyCount; }
+        const Bounds& bounds(int proxy) const { return nodes[proxy].bounds; }
+        uint32_t item(int proxy) const { return nodes[proxy].item; }
+
+        // visit(uint32_t item) for every item whose box is at least partly inside
+        template <typename Visit>
+        void queryFrustum(const FrustumPlanes& frustum, Visit&& visit) const;
+        // visit(uint32_t item) for every item whose box overlaps the sphere
+        template <typename Visit>
+        void querySphere(const glm::vec3& center, float radius, Visit&& visit) const;
+        // visit(uint32_t item, float entryDistance) for boxes the ray enters within maxDistance, returning the
+        // distance of a real hit on the item (or anything >= the current limit for a miss); hits shorten the ray
+        template <typename Visit>
+        void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Visit&& visit) const;
+
+    private:
+        struct Node {
+            Bounds bounds;
+            int parent = Null;
+            int left = Null;        // Null for leaves
+            int right = Null;
+            uint32_t item = 0;
+            int nextFree = Null;
+            bool leaf() const { return left == Null; }
+        };
+
+        std::vector<Node> nodes;
+        int root = Null;
+        int freeList = Null;
+        size_t proxyCount = 0;
+        float rebuildCost = 0.0f;
+
+        int allocateNode();
+        void freeNode(int node);
+        void insertLeaf(int leaf);
+        void removeLeaf(int leaf);
+        void refitFrom(int node);
+        int buildRange(std::vector<int>& leaves, size_t begin, size_t end, int parent);
+
+        template <typename Visit>
+        void visitSubtree(int node, std::vector<int>& stack, Visit& visit) const;
+    };
+
+    template <typename Visit>
+    void Bvh::visitSubtree(int node, std::vector<int>& stack, Visit& visit) const {
+        size_t base = stack.size();
+        stack.push_back(node);
+        while (stack.size() > base) {
+            const Node& current = nodes[stack.back()];
+            stack.pop_back();
+            if (current.leaf()) {
+                visit(current.item);
+            } else {
+                stack.push_back(current.left);
+                stack.push_back(current.right);
+            }
+        }
+    }
+
+    template <typename Visit>
+    void Bvh::queryFrustum(const FrustumPlanes& frustum, Visit&& visit) const {
+        if (root == Null)
+            return;
+        std::vector<int> stack;
+        stack.reserve(64);
+        stack.push_back(root);
+        while (!stack.empty()) {
+            int index = stack.back();
+            stack.pop_back();
+            const Node& node = nodes[index];
+            Containment containment = classify(frustum, node.bounds);
+            if (containment == Containment::Outside)
+                continue;
+            if (containment == Containment::Inside || node.leaf()) {
+                visitSubtree(index, stack, visit);
+                continue;
+            }
+            stack.push_back(node.left);
+            stack.push_back(node.right);
+        }
+    }
+
+    template <typename Visit>
+    void Bvh::querySphere(const glm::vec3& center, float radius, Visit&& visit) const {
+        if (root == Null)
+            return;
+        std::vector<int> stack;
+        stack.reserve(64);
+        stack.push_back(root);
+        while (!stack.empty()) {
+            const Node& node = nodes[stack.back()];
+            stack.pop_back();
+            // Squared distance from the center to the box
+            glm::vec3 closest = glm::min(glm::max(center, node.bounds.min), node.bounds.max);
+            glm::vec3 offset = closest - center;
+            if (glm::dot(offset, offset) > radius * radius)
+                continue;
+            if (node.leaf()) {
+                visit(node.item);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(node.right);
+            }
+        }
+    }
+
+    template <typename Visit>
+    void Bvh::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, Visit&& visit) const {
+        if (root == Null)
+            return;
+        // Slab test; 1/0 gives infinities, which the comparisons handle
+        glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+        auto entryDistance = [&](const Bounds& bounds) {
+            float enter = 0.0f, exit = maxDistance;
+            for (int axis = 0; axis < 3; axis++) {
+                float t0 = (bounds.min[axis] - origin[axis]) * inverse[axis];
+                float t1 = (bounds.max[axis] - origin[axis]) * inverse[axis];
+                if (t0 > t1)
+                    std::swap(t0, t1);
+                enter = std::max(enter, t0);
+                exit = std::min(exit, t1);
+            }
+            return enter <= exit ? enter : -1.0f;
+        };
+
+        std::vector<std::pair<int, float>> stack;
+        stack.reserve(64);
+        float rootEntry = entryDistance(nodes[root].bounds);
+        if (rootEntry >= 0.0f)
+            stack.push_back({ root, rootEntry });
+        while (!stack.empty()) {
+            std::pair<int, float> top = stack.back();
+            stack.pop_back();
+            if (top.second > maxDistance)
+                continue;       // A closer hit was found since this node was pushed
+            const Node& node = nodes[top.first];
+            if (node.leaf()) {
+                float hit = visit(node.item, top.second);
+                if (hit >= 0.0f && hit < maxDistance)
+                    maxDistance = hit;
+                continue;
+            }
+            // Push the nearer child last so it is visited first and can shorten the ray for the other
+            float leftEntry = entryDistance(nodes[node.left].bounds);
+            float rightEntry = entryDistance(nodes[node.right].bounds);
+            bool leftFirst = leftEntry >= 0.0f && (rightEntry < 0.0f || leftEntry <= rightEntry);
+            if (leftFirst) {
+                if (rightEntry >= 0.0f)
+                    stack.push_back({ node.right, rightEntry });
+                stack.push_back({ node.left, leftEntry });
+            } else {
+                if (leftEntry >= 0.0f)
+                    stack.push_back({ node.left, leftEntry });
+                if (rightEntry >= 0.0f)
+                    stack.push_back({ node.right, rightEntry });
+            }
+        }
+    }
+}
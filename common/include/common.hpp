@@ -6,6 +6,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "frame_data.hpp"
+#include "uniform_table.hpp"
+
 #include <iostream>
 #include <string>
 #include <fstream>
@@ -39,13 +42,20 @@ namespace Common {
         ~Shader();
         
         void use();
-        void setBool(const std::string &name, bool value) const;
-        void setInt(const std::string &name, int value) const;
-        void setFloat(const std::string &name, float value) const;
-        void setVec3(const std::string &name, const glm::vec3 &value) const;
-        void setMat4(const std::string &name, const glm::mat4 &mat) const;
+        // Setters resolve names through the reflected uniform table, never the driver
+        void setBool(UniformName name, bool value) const;
+        void setInt(UniformName name, int value) const;
+        void setFloat(UniformName name, float value) const;
+        void setVec3(UniformName name, const glm::vec3 &value) const;
+        void setMat4(UniformName name, const glm::mat4 &mat) const;
+        void setMat4Array(UniformName name, const glm::mat4 *mats, int count) const;
+        
+        // Location handle for callers that want to resolve once and call glUniform* themselves
+        GLint location(UniformName name) const { return uniforms.location(name); }
         
     private:
+        UniformTable uniforms;
+        
         void checkCompileErrors(unsigned int shader, const std::string &type);
     };
     
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "frustum_culler.hpp"
+#include "task_pool.hpp"
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+    // Stable reference to an entity: slot in the low 24 bits, generation in the high 8, so a
+    // handle to a destroyed entity stops being alive() even after its slot is reused
+    using EntityHandle = uint32_t;
+
+    // Local space, same convention as learnopengl's Transform: Euler angles in degrees applied Y * X * Z
+    struct TransformComponent {
+        glm::vec3 position = glm::vec3(0.0f);
+        glm::vec3 rotation = glm::vec3(0.0f);
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    // Ids into tables the application owns (models, materials)
+    struct RenderComponent {
+        uint32_t mesh = 0;
+        uint32_t material = 0;
+    };
+
+    struct AnimationComponent {
+        uint32_t clip = 0;
+        float time = 0.0f;
+        float speed = 1.0f;
+        bool playing = true;
+    };
+
+    // Entities stored as dense, index-aligned component arrays instead of a pointer tree. Every
+    // entity has a transform, a world matrix and bounds; render and animation are optional and
+    // flagged per entity. The hierarchy is a parent index per entity, and entities are stored
+    // sorted by depth: parents come before their children and each depth level is contiguous, so
+    // world matrices are one forward pass (level by level in parallel) and every per-entity loop
+    // is a linear walk over contiguous memory.
+    //
+    // Dense indices move when flush() compacts destroyed entities or restores the order after a
+    // reparent; hold EntityHandles across frames, and dense indices only within one.
+    class EntityRegistry {
+    public:
+        static constexpr EntityHandle Null = 0xffffffffu;
+        static constexpr uint32_t NoParent = 0xffffffffu;
+
+        // Which optional components an entity has
+        enum ComponentBits : uint8_t { Alive = 1, HasRender = 2, HasAnimation = 4 };
+
+        void reserve(size_t count);
+        EntityHandle create(EntityHandle parent = Null);
+        // Destroys the entity and its descendants; their storage is reclaimed at the next flush()
+        void destroy(EntityHandle entity);
+        bool alive(EntityHandle entity) const;
+        // Fails (and logs) if it would create a cycle
+        bool setParent(EntityHandle entity, EntityHandle parent);
+        EntityHandle parent(EntityHandle entity) const;
+        size_t size() const { return liveCount; }
+
+        const TransformComponent& transform(EntityHandle entity) const { return locals[index(entity)]; }
+        // Marks the entity's world matrix (and its descendants') for the next updateTransforms()
+        TransformComponent& editTransform(EntityHandle entity);
+        void setLocalBounds(EntityHandle entity, const Bounds& bounds);
+        const glm::mat4& world(EntityHandle entity) const { return worlds[index(entity)]; }
+
+        void setRender(EntityHandle entity, const RenderComponent& render);
+        void removeRender(EntityHandle entity);
+        const RenderComponent* render(EntityHandle entity) const;
+        void setAnimation(EntityHandle entity, const AnimationComponent& animation);
+        void removeAnimation(EntityHandle entity);
+        AnimationComponent* animation(EntityHandle entity);
+
+        // Compacts destroyed entities and restores the depth order; cheap when nothing changed
+        void flush();
+        // flush(), then recomputes world matrices and world bounds of entities whose transform was
+        // edited and of their descendants, one depth level at a time, each level spread over the
+        // pool's threads. Returns how many world matrices were recomputed
+        size_t updateTransforms(TaskPool* pool = nullptr);
+        void advanceAnimations(float deltaTime);
+
+        // Dense arrays, valid until the next flush(). Entries with no Alive bit are destroyed and awaiting flush()
+        size_t denseSize() const { return handles.size(); }
+        uint32_t index(EntityHandle entity) const { return slotIndex[entity & SlotMask]; }
+        EntityHandle handle(uint32_t index) const { return handles[index]; }
+        const std::vector<uint32_t>& parents() const { return parentIndex; }
+        const std::vector<uint8_t>& components() const { return componentBits; }
+        const std::vector<glm::mat4>& worldMatrices() const { return worlds; }
+        // Feed straight to cullFrustum(); the mask bits line up with dense indices
+        const BoundsSoA& worldBounds() const { return worldBoxes; }
+
+        // fn(uint32_t index, const glm::mat4& world, const RenderComponent& render)
+        template <typename Fn>
+        void eachRenderable(Fn&& fn) const;
+        // As eachRenderable, only for entities whose bit is set in a cullFrustum() mask over worldBounds()
+        template <typename Fn>
+        void eachVisible(const std::vector<uint32_t>& mask, Fn&& fn) const;
+        // fn(uint32_t index, AnimationComponent& animation)
+        template <typename Fn>
+        void eachAnimated(Fn&& fn);
+
+    private:
+        static constexpr uint32_t SlotMask = 0x00ffffffu;
+        static constexpr uint32_t FreeSlot = 0xffffffffu;
+        // Entities per parallel chunk: large enough that scheduling stays a small fraction of the work
+        static constexpr size_t TransformGrain = 2048;
+
+        // Slot tables behind the handles
+        std::vector<uint32_t> slotIndex;
+        std::vector<uint8_t> slotGeneration;
+        std::vector<uint32_t> freeSlots;
+
+        // Dense, index-aligned
+        std::vector<EntityHandle> handles;
+        std::vector<uint32_t> parentIndex;
+        std::vector<uint8_t> componentBits;
+        std::vector<uint8_t> dirty;         // Local transform edited since the last update
+        std::vector<uint8_t> changed;       // World matrix recomputed this update (dirty or a moved ancestor)
+        std::vector<uint32_t> depths;
+        std::vector<glm::mat4> localMatrices;
+        std::vector<TransformComponent> locals;
+        std::vector<glm::mat4> worlds;
+        std::vector<Bounds> localBoxes;
+        BoundsSoA worldBoxes;
+        std::vector<RenderComponent> renders;
+        std::vector<AnimationComponent> animations;
+
+        size_t liveCount = 0;
+        bool needsCompaction = false;
+        bool needsSort = false;
+        bool levelsDirty = true;
+        bool anyDirty = false;
+        std::vector<uint32_t> levelStart;   // First index of each depth level, plus the end
+
+        void releaseSlot(uint32_t index);
+        void reorder(const std::vector<uint32_t>& order);
+    };
+
+    // Local TRS matrix of a transform component
+    glm::mat4 localMatrix(const TransformComponent& transform);
+
+    template <typename Fn>
+    void EntityRegistry::eachRenderable(Fn&& fn) const {
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            if ((componentBits[i] & (Alive | HasRender)) == (Alive | HasRender))
+                fn(i, worlds[i], renders[i]);
+        }
+    }
+
+    template <typename Fn>
+    void EntityRegistry::eachVisible(const std::vector<uint32_t>& mask, Fn&& fn) const {
+        for (uint32_t word = 0; word < mask.size(); word++) {
+            if (mask[word] == 0)
+                continue;
+            uint32_t last = std::min<uint32_t>(word * 32 + 32, static_cast<uint32_t>(handles.size()));
+            for (uint32_t i = word * 32; i < last; i++) {
+                if (((mask[word] >> (i & 31)) & 1u) && (componentBits[i] & (Alive | HasRender)) == (Alive | HasRender))
+                    fn(i, worlds[i], renders[i]);
+            }
+        }
+    }
+
+    template <typename Fn>
+    void EntityRegistry::eachAnimated(Fn&& fn) {
+        for (uint32_t i = 0; i < handles.size(); i++) {
+            if ((componentBits[i] & (Alive | HasAnimation)) == (Alive | HasAnimation))
+                fn(i, animations[i]);
+        }
+    }
+}
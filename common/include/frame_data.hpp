@@ -0,0 +1,56 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <string>
+
+namespace Common {
+    // Uniform buffer binding point reserved for FrameData in every program
+    constexpr GLuint FrameDataBinding = 0;
+    // Binding point of the BonePalette block skinned shaders declare; filled per frame from a FrameRingBuffer
+    constexpr GLuint BonePaletteBinding = 2;
+
+    // Per-frame camera and lighting values, laid out to match the std140 block in FrameDataGlsl.
+    // Each vec3 is followed by a float so it fills the 16-byte slot std140 gives it.
+    struct FrameData {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec3 viewPos;
+        float time;
+        glm::vec3 lightPos;
+        float padding0;
+        glm::vec3 lightColor;
+        float padding1;
+    };
+    static_assert(offsetof(FrameData, viewPos) == 128 && offsetof(FrameData, lightPos) == 144 &&
+                  offsetof(FrameData, lightColor) == 160 && sizeof(FrameData) == 176,
+                  "FrameData must match the std140 layout of the GLSL block");
+
+    // GLSL declaration of the block, pulled into shaders with `#include "frame_data.glsl"`
+    extern const char* const FrameDataGlsl;
+
+    // Replaces `#include "frame_data.glsl"` and `#include "static_draw.glsl"` lines with their declarations.
+    // GLSL 3.30 has no include directive, so shader loaders run sources through this first.
+    std::string expandShaderIncludes(const std::string& source);
+
+    // Points the program's FrameData, StaticDrawData and BonePalette blocks (if it declares them) at their binding points.
+    // GLSL 3.30 cannot put `binding = N` in the layout, so this runs after every link.
+    void bindSharedUniformBlocks(GLuint program);
+
+    // The buffer behind FrameDataBinding, written once per frame with a single glBufferSubData
+    class FrameUniformBuffer {
+    public:
+        FrameUniformBuffer();
+        ~FrameUniformBuffer();
+        FrameUniformBuffer(const FrameUniformBuffer&) = delete;
+        FrameUniformBuffer& operator=(const FrameUniformBuffer&) = delete;
+
+        void update(const FrameData& data);
+        GLuint buffer() const { return ubo; }
+
+    private:
+        GLuint ubo = 0;
+    };
+}
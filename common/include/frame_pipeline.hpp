@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Common {
+    // Averages over the frames since the last logStats()
+    struct FrameTimings {
+        unsigned int frames = 0;
+        double simulateMilliseconds = 0.0;   // Between acquire() returning and publish()
+        double waitMilliseconds = 0.0;       // Simulation thread blocked in acquire()
+        double renderMilliseconds = 0.0;     // Inside the render callback
+    };
+
+    // Runs a render callback on its own thread, fed through two packet slots. The simulation thread
+    // fills one slot while the render thread draws the other, and acquire() blocks until the
+    // previous packet has been picked up, so rendering is never more than one frame behind.
+    // Single-threaded mode calls the render callback inline from publish(), for debugging.
+    class RenderThread {
+    public:
+        struct Callbacks {
+            std::function<void()> begin;              // On the render thread before the first frame (make the context current)
+            std::function<void(int slot)> render;
+            std::function<void()> end;                // On the render thread after the last frame (release the context)
+        };
+
+        RenderThread(bool threaded, Callbacks callbacks);
+        ~RenderThread();
+        RenderThread(const RenderThread&) = delete;
+        RenderThread& operator=(const RenderThread&) = delete;
+
+        // Slot (0 or 1) the simulation thread may write next
+        int acquire();
+        void publish(int slot);
+        // Renders the last published packet, then joins the render thread
+        void stop();
+
+        bool threaded() const { return threadedMode; }
+        void logStats(const std::string& label);
+
+    private:
+        Callbacks callbacks;
+        bool threadedMode;
+        std::thread renderThread;
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool stopping = false;
+        int pending = -1;       // Published, not yet picked up
+        int rendering = -1;     // Being drawn right now
+        int nextSlot = 0;
+
+        std::chrono::steady_clock::time_point acquiredAt;
+        std::mutex statsMutex;  // Timings are added to from both threads
+        FrameTimings timings;
+
+        void run();
+        void renderSlot(int slot);
+    };
+
+    // Typed front end of RenderThread: packets are written by the simulation thread between
+    // beginPacket() and submit() and are read-only to the render callback afterwards.
+    template <typename Packet>
+    class FramePipeline {
+    public:
+        FramePipeline(bool threaded, std::function<void()> begin, std::function<void(const Packet&)> render, std::function<void()> end)
+            : thread(threaded, { std::move(begin), [this, render](int slot) { render(packets[slot]); }, std::move(end) }) {}
+
+        // Reused between frames, so containers inside keep their capacity
+        Packet& beginPacket() {
+            current = thread.acquire();
+            return packets[current];
+        }
+        void submit() { thread.publish(current); }
+        void stop() { thread.stop(); }
+
+        bool threaded() const { return thread.threaded(); }
+        void logStats(const std::string& label) { thread.logStats(label); }
+
+    private:
+        Packet packets[2];
+        int current = 0;
+        RenderThread thread;    // Last, so the packets exist before the render thread starts
+    };
+}
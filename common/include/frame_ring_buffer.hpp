@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // Bytes handed out by FrameRingBuffer::allocate. `offset` is relative to buffer() and is what
+    // glBindBufferRange or an attribute pointer wants; `data` is where the CPU writes this frame's values.
+    struct RingAllocation {
+        void* data = nullptr;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+
+        bool valid() const { return data != nullptr; }
+    };
+
+    struct RingBufferStats {
+        unsigned int frames = 0;
+        unsigned int stalls = 0;         // beginFrame() calls that had to block on a fence
+        double stallMilliseconds = 0.0;
+        size_t peakFrameBytes = 0;
+        unsigned int overflows = 0;      // allocate() calls refused because the frame section was full
+    };
+
+    // Per-frame dynamic data (bone palettes, model matrices, instance data) bump-allocated from one
+    // GL buffer split into `frames` sections. With GL 4.4 / ARB_buffer_storage the buffer is mapped once,
+    // persistently and coherently, and a fence per section keeps the CPU from overwriting data the GPU
+    // has not read yet. Without buffer storage, allocations go to a CPU copy that is uploaded into
+    // a freshly orphaned buffer in flush(), so offsets and usage stay the same.
+    class FrameRingBuffer {
+    public:
+        // `target` decides the offset alignment, e.g. GL_UNIFORM_BUFFER uses GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+        FrameRingBuffer(GLenum target, size_t bytesPerFrame, unsigned int frames = 3);
+        ~FrameRingBuffer();
+        FrameRingBuffer(const FrameRingBuffer&) = delete;
+        FrameRingBuffer& operator=(const FrameRingBuffer&) = delete;
+
+        // Moves to the next section, waiting for the GPU if it still reads from it
+        void beginFrame();
+        // Returns an invalid allocation when the frame's section is full
+        RingAllocation allocate(size_t bytes);
+        // Makes the frame's allocations visible to the GPU; call once they are written and before the
+        // draws that read them. Only the orphaning path has work to do here, coherent mappings need nothing.
+        void flush();
+        // Fences the section so it is not reused before the GPU is done; call after the frame's draws
+        void endFrame();
+
+        GLuint buffer() const { return ringBuffer; }
+        bool persistent() const { return mappedMemory != nullptr; }
+        const RingBufferStats& stats() const { return counters; }
+        void logStats(const std::string& label) const;
+
+    private:
+        GLenum target;
+        GLuint ringBuffer = 0;
+        size_t sectionBytes;
+        unsigned int sectionCount;
+        size_t alignment = 16;
+
+        unsigned char* mappedMemory = nullptr;   // Whole buffer, persistent path only
+        std::vector<unsigned char> staging;      // One section, orphaning path only
+        std::vector<GLsync> fences;
+
+        unsigned int section = 0;
+        size_t head = 0;                         // Bytes used in the current section
+        RingBufferStats counters;
+    };
+}
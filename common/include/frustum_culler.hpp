@@ -0,0 +1,49 @@
+#pragma once
+
+#include "bounds.hpp"
+#include "task_pool.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+    // World space boxes as structure-of-arrays (center and half extents per axis), so the culling
+    // kernel loads 8 boxes per register with no shuffling
+    struct BoundsSoA {
+        std::vector<float> centerX, centerY, centerZ;
+        std::vector<float> extentX, extentY, extentZ;
+
+        size_t size() const { return centerX.size(); }
+        void resize(size_t count);
+        void clear() { resize(0); }
+        // Empty bounds are stored as a finite box every kernel rejects, not as -inf extents
+        // that turn into NaN against planes with a zero normal component
+        void set(size_t index, const Bounds& bounds);
+        size_t push_back(const Bounds& bounds);
+    };
+
+    // Bit i of the mask (word i / 32, bit i % 32) is set when box i is at least partly inside
+    std::vector<uint32_t>& resizeVisibilityMask(std::vector<uint32_t>& mask, size_t count);
+    inline bool isVisible(const std::vector<uint32_t>& mask, size_t index) {
+        return (mask[index >> 5] >> (index & 31)) & 1u;
+    }
+
+    // Tests boxes [begin, end) against all six planes. begin must be a multiple of 32 so that
+    // concurrent calls on disjoint ranges never write the same mask word; the mask must already
+    // be sized for bounds.size(). Uses AVX2 (8 boxes per iteration) when the CPU has it, else SSE
+    // (4) or scalar code.
+    void cullFrustum(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask);
+
+    // Whole array, split over the pool's threads when there are enough boxes to pay for them.
+    // Returns the number of visible boxes.
+    size_t cullFrustum(const FrustumPlanes& frustum, const BoundsSoA& bounds, std::vector<uint32_t>& mask, TaskPool* pool = nullptr);
+
+    // Name of the kernel cullFrustum() dispatches to: "avx2", "sse" or "scalar"
+    const char* frustumCullKernel();
+
+    // As the ranged cullFrustum(), with the named kernel instead of the one it picks, so the
+    // kernels can be checked against each other. Returns false when that kernel is not built
+    // in or this CPU lacks it.
+    bool cullFrustumWithKernel(const char* kernel, const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask);
+}
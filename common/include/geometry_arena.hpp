@@ -0,0 +1,91 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // First-fit free-list allocator over an abstract range of units (vertices or indices).
+    // Freed ranges are merged with their neighbours so the list stays short.
+    class RangeAllocator {
+    public:
+        static constexpr size_t InvalidOffset = ~size_t(0);
+
+        explicit RangeAllocator(size_t capacity = 0);
+
+        size_t allocate(size_t size);            // Returns InvalidOffset when no free range is large enough
+        void free(size_t offset, size_t size);
+        void grow(size_t newCapacity);           // Appends the new tail as free space
+
+        size_t capacity() const { return totalCapacity; }
+        size_t used() const { return usedUnits; }
+        size_t largestFreeRange() const;
+        size_t freeRangeCount() const { return freeRanges.size(); }
+
+    private:
+        std::map<size_t, size_t> freeRanges;     // offset -> size, sorted so neighbours are adjacent
+        size_t totalCapacity = 0;
+        size_t usedUnits = 0;
+    };
+
+    // One attribute of an interleaved vertex format, as passed to glVertexAttrib(I)Pointer
+    struct VertexAttribute {
+        GLuint index;
+        GLint components;
+        GLenum type;
+        size_t offset;
+        bool integer = false;       // Uses glVertexAttribIPointer (bone IDs)
+        GLboolean normalized = GL_FALSE;
+    };
+
+    struct VertexFormat {
+        size_t stride = 0;
+        std::vector<VertexAttribute> attributes;
+    };
+
+    // Where a mesh lives inside an arena: draw with glDrawElementsBaseVertex using these
+    struct GeometryAllocation {
+        unsigned int baseVertex = 0;
+        unsigned int firstIndex = 0;
+        unsigned int vertexCount = 0;
+        unsigned int indexCount = 0;
+
+        bool valid() const { return vertexCount != 0 || indexCount != 0; }
+    };
+
+    // Shared vertex and index buffers for every mesh of one vertex format, with a single VAO.
+    // Meshes are sub-allocated and addressed by base vertex and first index, so switching
+    // between them needs no buffer or VAO binds. Buffers grow by copying on the GPU when full.
+    // Like the per-mesh buffers it replaces, GL objects live until the context is destroyed.
+    class GeometryArena {
+    public:
+        GeometryArena(const VertexFormat& format, size_t vertexCapacity = 1 << 16, size_t indexCapacity = 1 << 18);
+
+        // Copies the data into the shared buffers. Indices stay relative to the mesh's own vertices.
+        GeometryAllocation allocate(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+        void free(const GeometryAllocation& allocation);
+
+        GLuint vao() const { return vertexArray; }
+        const VertexFormat& format() const { return vertexFormat; }
+        size_t gpuBytes() const;
+
+        // Prints usage and fragmentation of both buffers
+        void logUsage(const std::string& label) const;
+
+    private:
+        VertexFormat vertexFormat;
+        GLuint vertexArray = 0;
+        GLuint vertexBuffer = 0;
+        GLuint indexBuffer = 0;
+        RangeAllocator vertexRanges;
+        RangeAllocator indexRanges;
+        unsigned int allocationCount = 0;
+
+        void createVertexArray();
+        void growVertexBuffer(size_t minCapacity);
+        void growIndexBuffer(size_t minCapacity);
+    };
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // Command line switches for windowless perf runs:
+    //   --headless                 enable
+    //   --headless-size WxH        framebuffer resolution (1280x720)
+    //   --headless-frames N        frames to run (600)
+    //   --headless-dt SECONDS      fixed timestep (1/60)
+    //   --headless-out DIR         output directory for timings.csv and images (headless_out)
+    //   --headless-dump-every N    write every Nth frame as a PPM image, 0 for none (0)
+    struct HeadlessOptions {
+        bool enabled = false;
+        int width = 1280;
+        int height = 720;
+        int frames = 600;
+        float timestep = 1.0f / 60.0f;
+        std::string outputDirectory = "headless_out";
+        int dumpEvery = 0;
+    };
+
+    HeadlessOptions parseHeadlessOptions(int argc, char** argv);
+
+    // A GL 3.3 core context with no window or display: surfaceless EGL (Mesa llvmpipe works),
+    // rendering into an FBO that stays bound as the draw framebuffer. Needs the common library
+    // to be built with EGL; otherwise create() reports that and fails.
+    class HeadlessContext {
+    public:
+        HeadlessContext() = default;
+        ~HeadlessContext();
+        HeadlessContext(const HeadlessContext&) = delete;
+        HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+        // Creates the context, makes it current, loads GL through glad and binds the FBO
+        bool create(int width, int height);
+
+        GLuint framebuffer() const { return fbo; }
+
+    private:
+        void* display = nullptr;   // EGLDisplay / EGLContext, kept opaque so EGL stays out of this header
+        void* context = nullptr;
+        GLuint fbo = 0;
+        GLuint colorBuffer = 0;
+        GLuint depthBuffer = 0;
+    };
+
+    // Drives a fixed number of fixed-timestep frames and writes one CSV row of CPU timings per frame.
+    // With a single-threaded FramePipeline, call beginFrame() before simulating, simulationDone()
+    // before submitting the packet, present() at the end of the render callback and endFrame() after submit.
+    class HeadlessRun {
+    public:
+        explicit HeadlessRun(const HeadlessOptions& options);
+        ~HeadlessRun();
+
+        bool running() const { return frame < options.frames; }
+        int frameIndex() const { return frame; }
+        float time() const { return frame * options.timestep; }
+        float timestep() const { return options.timestep; }
+
+        void beginFrame();
+        void simulationDone();
+        // Waits for the frame with glFinish so software rasterization is timed, then dumps the image if due
+        void present();
+        void endFrame();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        HeadlessOptions options;
+        std::ofstream csv;
+        int frame = 0;
+        Clock::time_point frameStart;
+        Clock::time_point submitStart;
+        double simulateMilliseconds = 0.0;
+        std::vector<double> frameMilliseconds;
+        std::vector<unsigned char> pixels;
+
+        void dumpImage(const std::string& path);
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "geometry_arena.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // Per-instance vertex attributes in one GL buffer, attached to a VAO with divisor 1.
+    // Instances stay packed: remove() moves the last instance into the hole, so the draw always
+    // covers [0, count()) and a removal touches a single element. Changes are kept in a CPU copy
+    // and uploaded as one dirty range by sync(), so adding thousands of instances costs one upload.
+    class InstanceBuffer {
+    public:
+        static constexpr size_t InvalidHandle = ~static_cast<size_t>(0);
+
+        // `format` describes one instance; its attribute indices must not clash with the VAO's vertex attributes
+        InstanceBuffer(const VertexFormat& format, GLuint vertexArray, size_t capacity = 1024);
+        ~InstanceBuffer();
+        InstanceBuffer(const InstanceBuffer&) = delete;
+        InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+        // Copies format.stride bytes; the handle stays valid until the instance is removed
+        size_t add(const void* instance);
+        void update(size_t handle, const void* instance);
+        void remove(size_t handle);
+        bool contains(size_t handle) const;
+
+        // Uploads everything changed since the last call. Call once per frame before drawing.
+        void sync();
+
+        GLsizei count() const { return static_cast<GLsizei>(handleOfSlot.size()); }
+        GLuint buffer() const { return instanceBuffer; }
+        size_t gpuBytes() const { return capacity * format.stride; }
+
+    private:
+        VertexFormat format;
+        GLuint vertexArray;
+        GLuint instanceBuffer = 0;
+        size_t capacity = 0;
+
+        std::vector<unsigned char> instances;   // CPU copy, packed like the GL buffer
+        std::vector<size_t> slotOfHandle;       // InvalidHandle for removed handles
+        std::vector<size_t> handleOfSlot;
+        std::vector<size_t> freeHandles;
+
+        // Slots [dirtyBegin, dirtyEnd) differ from the GL buffer
+        size_t dirtyBegin = 0;
+        size_t dirtyEnd = 0;
+        bool reallocate = false;
+
+        void markDirty(size_t slot);
+    };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "mesh_optimizer.hpp"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // One level of detail stored in a shared index buffer: LOD 0 first, coarser levels appended after it
+    struct MeshLod {
+        unsigned int indexOffset = 0;
+        unsigned int indexCount = 0;
+        float error = 0.0f;     // Geometric deviation from LOD 0 in object space units
+    };
+
+    struct LodSettings {
+        float thresholdPixels = 1.0f;   // Largest acceptable on-screen deviation
+        float hysteresis = 0.25f;       // Fraction around the threshold where the current LOD is kept
+    };
+
+    // Largest extent of the positions' bounding box; multiplies relative simplification error into object space
+    float simplifyScale(const float* positions, size_t vertexCount, size_t stride);
+
+    // Quadric error edge collapse. Vertices are only ever collapsed onto existing vertices, so every
+    // attribute (normals, UVs, skin weights) of the survivors is preserved as-is. Vertices sharing a
+    // position are moved together; open borders are locked. When `collapseGroups` is given a vertex
+    // may only collapse into a vertex of the same group (e.g. same dominant bone).
+    // `targetError` and `resultError` are relative to simplifyScale(). Returns the new index count.
+    size_t simplifyMesh(std::vector<unsigned int>& destination, const std::vector<unsigned int>& indices,
+                        const float* positions, size_t vertexCount, size_t stride,
+                        size_t targetIndexCount, float targetError,
+                        const std::vector<unsigned int>* collapseGroups = nullptr, float* resultError = nullptr);
+
+    // Appends up to `maxLods - 1` simplified levels (halving triangles each step) to `indices`
+    // and returns the LOD table, LOD 0 included. Each level is reordered for the vertex cache.
+    template <typename VertexT>
+    std::vector<MeshLod> buildLodChain(const std::vector<VertexT>& vertices, std::vector<unsigned int>& indices,
+                                       const std::vector<unsigned int>* collapseGroups = nullptr, unsigned int maxLods = 4) {
+        std::vector<MeshLod> lods;
+        lods.push_back({ 0, static_cast<unsigned int>(indices.size()), 0.0f });
+        if (vertices.empty() || indices.size() < 3)
+            return lods;
+
+        const float* positions = &vertices[0].Position.x;
+        const float scale = simplifyScale(positions, vertices.size(), sizeof(VertexT));
+
+        std::vector<unsigned int> previous(indices.begin(), indices.end());
+        std::vector<unsigned int> simplified;
+        float accumulatedError = 0.0f;
+
+        for (unsigned int level = 1; level < maxLods; level++) {
+            size_t target = (previous.size() / 2) / 3 * 3;
+            float error = 0.0f;
+            simplifyMesh(simplified, previous, positions, vertices.size(), sizeof(VertexT), target, 0.05f, collapseGroups, &error);
+
+            // Stop once a level no longer saves enough to be worth its index memory
+            if (simplified.empty() || simplified.size() > previous.size() * 9 / 10)
+                break;
+
+            optimizeVertexCache(simplified, vertices.size());
+            accumulatedError += error * scale;
+
+            lods.push_back({ static_cast<unsigned int>(indices.size()), static_cast<unsigned int>(simplified.size()), accumulatedError });
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+            previous.swap(simplified);
+        }
+
+        return lods;
+    }
+
+    // Prints the index count and error of every level in the chain
+    void logMeshLods(const std::string& label, const std::vector<MeshLod>& lods);
+
+    // Screen pixels covered by one object-space unit at the given distance with a perspective projection
+    float lodPixelsPerUnit(float distance, float fovYRadians, float viewportHeight);
+
+    // Picks the coarsest LOD whose projected error stays under the threshold. Switching coarser needs the
+    // error to be comfortably below it and switching finer needs the current one clearly above it, so an
+    // object sitting on the boundary does not pop back and forth every frame.
+    int selectLod(const std::vector<MeshLod>& lods, int currentLod, float pixelsPerUnit, const LodSettings& settings = LodSettings());
+}
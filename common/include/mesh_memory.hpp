@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // What a mesh keeps in system memory once its buffers have been uploaded to the GPU
+    enum class CpuRetention {
+        KeepAll,        // Full vertex and index arrays (default, needed to re-upload or re-process)
+        PositionsOnly,  // Tightly packed positions for bounds and raycasts; indices are kept as well
+        None            // Nothing beyond the LOD table and bounds
+    };
+
+    struct MeshMemoryStats {
+        size_t cpuBytes = 0;    // Heap owned by the CPU-side arrays, by capacity
+        size_t gpuBytes = 0;    // Vertex and index buffer storage
+        unsigned int meshCount = 0;
+
+        MeshMemoryStats& operator+=(const MeshMemoryStats& other) {
+            cpuBytes += other.cpuBytes;
+            gpuBytes += other.gpuBytes;
+            meshCount += other.meshCount;
+            return *this;
+        }
+    };
+
+    const char* cpuRetentionName(CpuRetention retention);
+
+    // Prints the resident CPU and GPU memory of a model's meshes
+    void logMeshMemory(const std::string& label, CpuRetention retention, const MeshMemoryStats& stats);
+
+    // Heap bytes held by a vector; capacity rather than size since that is what stays allocated
+    template <typename T>
+    size_t vectorBytes(const std::vector<T>& values) {
+        return values.capacity() * sizeof(T);
+    }
+
+    // Frees a vector's storage; clear() alone keeps the capacity
+    template <typename T>
+    void releaseVector(std::vector<T>& values) {
+        std::vector<T>().swap(values);
+    }
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // Post-transform cache statistics for an indexed triangle list
+    struct VertexCacheStats {
+        unsigned int vertexCount = 0;       // Unique vertices referenced by the index buffer
+        unsigned int triangleCount = 0;
+        unsigned int verticesTransformed = 0;
+        float acmr = 0.0f;                  // Average cache miss ratio: transformed / triangles (best 0.5, worst 3.0)
+        float atvr = 0.0f;                  // Average transformed vertex ratio: transformed / vertices (best 1.0)
+    };
+
+    struct MeshOptimizationStats {
+        VertexCacheStats before;
+        VertexCacheStats after;
+    };
+
+    // Prints before/after cache statistics for an optimized mesh
+    void logMeshOptimization(const std::string& label, const MeshOptimizationStats& stats);
+
+    // Simulates a FIFO post-transform cache of the given size over the index buffer
+    VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+
+    // Reorders triangles so vertices are reused while they are still in the post-transform cache
+    void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Splits the cache-ordered triangle list into clusters and sorts them so outward facing
+    // clusters draw first, trading at most `threshold` times the ACMR for less overdraw.
+    // `positions` points at the first vertex position, `stride` is the vertex size in bytes.
+    void optimizeOverdraw(std::vector<unsigned int>& indices, const float* positions, size_t vertexCount, size_t stride, float threshold = 1.05f);
+
+    // Builds a remap table assigning vertices new indices in order of first use.
+    // Unreferenced vertices map to ~0u. Returns the number of vertices kept.
+    size_t buildVertexFetchRemap(std::vector<unsigned int>& remap, const std::vector<unsigned int>& indices, size_t vertexCount);
+
+    // Reorders the vertex buffer to match index order so vertex fetch walks memory linearly
+    template <typename VertexT>
+    void optimizeVertexFetch(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices) {
+        std::vector<unsigned int> remap;
+        size_t kept = buildVertexFetchRemap(remap, indices, vertices.size());
+
+        std::vector<VertexT> reordered(kept);
+        for (size_t i = 0; i < vertices.size(); i++) {
+            if (remap[i] != ~0u)
+                reordered[remap[i]] = vertices[i];
+        }
+        for (auto& index : indices)
+            index = remap[index];
+
+        vertices.swap(reordered);
+    }
+
+    // Import-time pipeline: vertex cache order, overdraw cluster sort, then fetch order.
+    // VertexT must expose a glm::vec3 `Position` member.
+    template <typename VertexT>
+    MeshOptimizationStats optimizeMesh(std::vector<VertexT>& vertices, std::vector<unsigned int>& indices) {
+        MeshOptimizationStats stats;
+        stats.before = analyzeVertexCache(indices, vertices.size());
+        if (indices.size() < 3 || vertices.empty()) {
+            stats.after = stats.before;
+            return stats;
+        }
+
+        optimizeVertexCache(indices, vertices.size());
+        optimizeOverdraw(indices, &vertices[0].Position.x, vertices.size(), sizeof(VertexT));
+        optimizeVertexFetch(vertices, indices);
+
+        stats.after = analyzeVertexCache(indices, vertices.size());
+        return stats;
+    }
+}
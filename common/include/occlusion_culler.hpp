@@ -0,0 +1,98 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Common {
+    struct OcclusionStats {
+        unsigned int frames = 0;
+        unsigned long long occluderTriangles = 0;   // Rasterized, after clipping
+        unsigned long long tested = 0;
+        unsigned long long occluded = 0;
+        double rasterMilliseconds = 0.0;            // Worker time: rasterization and hierarchy build
+        double waitMilliseconds = 0.0;              // Callers blocked on the worker before testing
+    };
+
+    // Software occlusion culling that needs no GPU. A small set of designated occluder meshes is
+    // rasterized (SSE where available, 4 pixels at a time) into a low resolution depth buffer,
+    // from which a min/max depth pyramid is built; bounding boxes are then tested against the
+    // pyramid, coarse to fine, before anything is submitted.
+    //
+    // beginFrame() hands the frame's view-projection to a worker thread and returns at once, so
+    // rasterization overlaps whatever the caller does next (animation, simulation); the first
+    // isVisible() of the frame waits for it. Occluders may only be changed between frames: the
+    // editing calls wait for the worker first. Single-threaded mode rasterizes inside beginFrame().
+    class OcclusionCuller {
+    public:
+        explicit OcclusionCuller(int width = 256, int height = 128, bool threaded = true);
+        ~OcclusionCuller();
+        OcclusionCuller(const OcclusionCuller&) = delete;
+        OcclusionCuller& operator=(const OcclusionCuller&) = delete;
+
+        // Triangle list in object space. Occluders should be solid and cheap: walls, terrain, building shells
+        size_t addOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model);
+        size_t addBoxOccluder(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model);
+        void setOccluderTransform(size_t handle, const glm::mat4& model);
+        void removeOccluder(size_t handle);
+
+        void beginFrame(const glm::mat4& viewProjection);
+        // World space box. Conservative: false only if the box is certainly behind occluders
+        bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+        int width() const { return bufferWidth; }
+        int height() const { return bufferHeight; }
+        // Level 0 of the pyramid, normalized depth with 1 at the far plane; valid after isVisible() or finish()
+        const std::vector<float>& depth() const { return maxDepth[0]; }
+        // Waits for the worker to finish the current frame
+        void finish();
+
+        OcclusionStats stats();
+        void logStats(const std::string& label);
+
+    private:
+        struct Occluder {
+            std::vector<glm::vec3> vertices;
+            std::vector<unsigned int> indices;
+            glm::mat4 model;
+            bool active = true;
+        };
+
+        int bufferWidth;
+        int bufferHeight;
+        std::vector<Occluder> occluders;
+        std::vector<size_t> freeOccluders;
+        glm::mat4 frameViewProjection = glm::mat4(1.0f);
+        bool haveFrame = false;
+
+        // Level 0 is the depth buffer itself (min and max equal); each level halves both sides
+        std::vector<std::vector<float>> minDepth;
+        std::vector<std::vector<float>> maxDepth;
+        std::vector<int> levelWidth;
+        std::vector<int> levelHeight;
+        std::vector<glm::vec4> clipVertices;
+
+        bool threadedMode;
+        std::thread worker;
+        std::mutex mutex;
+        std::condition_variable changed;
+        bool busy = false;
+        bool stopping = false;
+        bool ready = true;      // Pyramid matches the last beginFrame()
+        bool frameSynced = true;    // Caller thread only: already waited for this frame
+        OcclusionStats counters;
+
+        void run();
+        void rasterizeFrame();
+        void rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c);
+        void drawTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+        void buildHierarchy();
+        bool visibleIn(int level, int x, int y, int rectMinX, int rectMinY, int rectMaxX, int rectMaxY, float nearestDepth) const;
+        void waitUntilReady();
+    };
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace Common {
+    // Ear clipping triangulation of a 2D outline, concave or not, in either winding. Repeated
+    // consecutive points and a closing point equal to the first are ignored. Outlines that
+    // cross themselves still produce triangles covering roughly the same area instead of
+    // failing. Returns indices into `points`, three per triangle, all wound counter-clockwise.
+    std::vector<unsigned int> tessellatePolygon(const std::vector<glm::vec2>& points);
+
+    // Appends to `pieces` (two points per piece) the parts of segment a-b that are not strictly
+    // inside any of `triangles` (three points per triangle, any winding). Used to pre-clip
+    // outlines against shapes drawn on top of them.
+    void clipSegmentOutsideTriangles(const glm::vec2& a, const glm::vec2& b, const std::vector<glm::vec2>& triangles, std::vector<glm::vec2>& pieces);
+}
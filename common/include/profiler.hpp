@@ -0,0 +1,76 @@
+#pragma once
+
+// Frame profiler: nestable per-thread CPU zones, GL timer query zones read back a few frames
+// late so the GPU never stalls, Chrome trace-event JSON (chrome://tracing, Perfetto) and a
+// rolling CSV. Use the PROFILE_* macros only; without COMMON_PROFILING (Release builds, or the
+// COMMON_PROFILING CMake option off) they expand to nothing and none of this is compiled.
+//
+//   PROFILE_ZONE("Animation update");       CPU zone until the end of the scope
+//   PROFILE_GPU_ZONE("Draw submission");    CPU zone plus GL timestamps around the scope, GL thread only
+//   PROFILE_THREAD_NAME("Render");          Name the calling thread in the trace
+//   PROFILE_FRAME();                        End of a frame, on the GL thread after the swap
+//   PROFILE_OPEN_CSV("profile.csv");        One row per zone per frame, rolled to profile.csv.old
+//   PROFILE_WRITE_TRACE("profile.json");    Retained frames as a Chrome trace
+//
+// Zone names must be string literals or otherwise outlive the profiler; only the pointer is kept.
+
+#ifdef COMMON_PROFILING
+
+#include <string>
+
+namespace Common {
+    namespace Profiler {
+        void beginZone(const char* name);
+        void endZone();
+        void beginGpuZone(const char* name);
+        void endGpuZone();
+        void setThreadName(const char* name);
+
+        // Collects finished CPU zones and any GPU zones whose queries are available, never waiting for them
+        void endFrame();
+
+        // Frames kept for writeChromeTrace(), oldest dropped first (600)
+        void setHistoryFrames(unsigned int frames);
+        // After rollFrames frames the file is renamed to <path>.old and started again
+        bool openCsv(const std::string& path, unsigned int rollFrames = 3600);
+        bool writeChromeTrace(const std::string& path);
+    }
+
+    class ProfileZone {
+    public:
+        explicit ProfileZone(const char* name) { Profiler::beginZone(name); }
+        ~ProfileZone() { Profiler::endZone(); }
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+    };
+
+    class GpuProfileZone {
+    public:
+        explicit GpuProfileZone(const char* name) { Profiler::beginGpuZone(name); }
+        ~GpuProfileZone() { Profiler::endGpuZone(); }
+        GpuProfileZone(const GpuProfileZone&) = delete;
+        GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+    };
+}
+
+#define COMMON_PROFILE_JOIN2(a, b) a##b
+#define COMMON_PROFILE_JOIN(a, b) COMMON_PROFILE_JOIN2(a, b)
+#define PROFILE_ZONE(name) Common::ProfileZone COMMON_PROFILE_JOIN(profileZone, __LINE__)(name)
+#define PROFILE_GPU_ZONE(name) \
+    Common::ProfileZone COMMON_PROFILE_JOIN(profileZone, __LINE__)(name); \
+    Common::GpuProfileZone COMMON_PROFILE_JOIN(gpuProfileZone, __LINE__)(name)
+#define PROFILE_THREAD_NAME(name) Common::Profiler::setThreadName(name)
+#define PROFILE_FRAME() Common::Profiler::endFrame()
+#define PROFILE_OPEN_CSV(path) Common::Profiler::openCsv(path)
+#define PROFILE_WRITE_TRACE(path) Common::Profiler::writeChromeTrace(path)
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_GPU_ZONE(name) ((void)0)
+#define PROFILE_THREAD_NAME(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_OPEN_CSV(path) ((void)0)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+
+#endif
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace Common {
+    // Per-frame counters; skipped binds are calls the state cache found already in place
+    struct RenderStats {
+        unsigned int drawCalls = 0;
+        unsigned int stateChanges = 0;
+        unsigned int redundantBindsSkipped = 0;
+    };
+
+    void logRenderStats(const std::string& label, const RenderStats& stats);
+
+    // Shadows the bits of GL state the render queue touches and drops calls that would not change it.
+    // Anything that binds programs, VAOs or textures behind its back must call invalidate().
+    class GLStateCache {
+    public:
+        static constexpr unsigned int MaxTextureUnits = 16;
+
+        void useProgram(GLuint program);
+        void bindVertexArray(GLuint vertexArray);
+        void bindTexture(unsigned int unit, GLuint texture);   // GL_TEXTURE_2D
+        void invalidate();
+
+        RenderStats stats;
+
+    private:
+        // ~0u means unknown, so the first call after invalidate() always goes through
+        GLuint program = ~0u;
+        GLuint vertexArray = ~0u;
+        GLuint activeUnit = ~0u;
+        GLuint textures[MaxTextureUnits] = { ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u,
+                                             ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u, ~0u };
+    };
+
+    // Render passes in submission-key order; transparent draws sort back to front
+    enum class RenderPass : uint8_t {
+        Opaque = 0,
+        Transparent = 8,
+        Overlay = 15
+    };
+
+    // 64-bit key, most significant first: pass (4) | shader (12) | material (16) | VAO (12) | depth (20).
+    // Sorting on it groups draws by the most expensive state first and then goes front to back.
+    // `depth` is view distance divided by the far plane, clamped to [0, 1].
+    uint64_t makeSortKey(RenderPass pass, GLuint program, uint32_t material, GLuint vertexArray, float depth);
+
+    constexpr unsigned int MaxDrawTextures = GLStateCache::MaxTextureUnits;
+
+    struct DrawCommand {
+        uint64_t sortKey = 0;
+        GLuint program = 0;
+        GLuint vertexArray = 0;
+        GLuint textures[MaxDrawTextures] = {};  // Unit i gets textures[i]; 0 leaves the unit as it is
+        GLenum primitive = GL_TRIANGLES;
+        GLenum indexType = 0;                   // 0 draws arrays, otherwise GL_UNSIGNED_INT etc.
+        GLsizei count = 0;
+        GLint first = 0;                        // First vertex, or first index for indexed draws
+        GLint baseVertex = 0;
+        GLsizei instanceCount = 1;
+
+        // Per-draw uniforms, called with the data passed to submit() after the program is bound
+        void (*applyUniforms)(const void* data) = nullptr;
+        uint32_t uniformOffset = 0;
+    };
+
+    // Collects draws for a frame, sorts them by key and issues them through a GLStateCache.
+    // Storage is reused between frames, so a steady scene allocates nothing after warm-up.
+    class RenderQueue {
+    public:
+        void submit(const DrawCommand& command);
+
+        // Copies trivially copyable per-draw uniform data into the frame's arena for applyUniforms
+        template <typename T>
+        void submit(DrawCommand command, const T& uniforms) {
+            static_assert(std::is_trivially_copyable<T>::value, "per-draw uniforms are copied bytewise");
+            size_t offset = (uniformArena.size() + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+            uniformArena.resize(offset + sizeof(T));
+            std::memcpy(uniformArena.data() + offset, &uniforms, sizeof(T));
+            command.uniformOffset = static_cast<uint32_t>(offset);
+            submit(command);
+        }
+
+        // Sorts, draws everything and clears the queue. Returns state.stats, which keeps
+        // accumulating across flushes until the caller resets it (once per frame).
+        RenderStats flush(GLStateCache& state);
+
+        size_t size() const { return commands.size(); }
+
+    private:
+        struct SortEntry {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        std::vector<DrawCommand> commands;
+        std::vector<SortEntry> entries;
+        std::vector<SortEntry> scratch;
+        std::vector<unsigned char> uniformArena;
+
+        void radixSort();
+    };
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+namespace Common {
+    // Appends a unit sphere centred on the origin as a triangle list (three positions per
+    // triangle): `slices` segments around Z and `stacks` from pole to pole, the same layout as
+    // glutSolidSphere. Scale it for ellipses and ellipsoids.
+    void buildUnitSphere(int slices, int stacks, std::vector<glm::vec3>& triangles);
+
+    // Screen-space radius in pixels of a unit sphere drawn with `modelViewProjection`: its longest
+    // projected axis, measured at the centre's depth
+    float projectedRadiusPixels(const glm::mat4& modelViewProjection, const glm::vec2& viewportSize);
+
+    // Fewest segments around a circle of `radiusPixels` whose chords stay within `tolerancePixels`
+    // of the true outline; pick the sphere level with at least this many slices
+    int circleSegmentsForRadius(float radiusPixels, float tolerancePixels = 0.5f);
+}
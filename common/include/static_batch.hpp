@@ -0,0 +1,104 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "render_queue.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Common {
+    // Uniform buffer binding point of the StaticDrawData block
+    constexpr GLuint StaticDrawDataBinding = 1;
+    // Vertex attribute carrying the draw index; must be unused by the batched meshes' own formats
+    constexpr GLuint DrawIdAttribute = 8;
+    // 80 bytes each, so the block stays under the 16 KiB GL_MAX_UNIFORM_BLOCK_SIZE minimum.
+    // The array size in StaticDrawGlsl has to match.
+    constexpr size_t MaxStaticDraws = 128;
+
+    // Per-draw values, laid out to match one element of the std140 array in StaticDrawGlsl
+    struct StaticDrawData {
+        glm::mat4 model;
+        glm::vec4 color;
+    };
+    static_assert(sizeof(StaticDrawData) == 80, "StaticDrawData must match the std140 array stride");
+
+    // Matches the indirect command layout glMultiDrawElementsIndirect reads
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Vertex shader declarations pulled in with `#include "static_draw.glsl"`: the aDrawID input and
+    // the StaticDrawData block, so `draws[aDrawID].model` is this draw's model matrix
+    extern const char* const StaticDrawGlsl;
+
+    // Static indexed draws packed into one indirect command list and drawn with glMultiDrawElementsIndirect,
+    // one call per VAO and texture set. The draw index reaches the shader as an instanced attribute
+    // offset by baseInstance (GLSL 3.30 has no gl_DrawID). The command list and data block are only
+    // rewritten when something was added, removed or changed. Without GL 4.3 it falls back to one
+    // draw per command, setting aDrawID as a constant attribute.
+    class StaticBatch {
+    public:
+        StaticBatch();
+        ~StaticBatch();
+        StaticBatch(const StaticBatch&) = delete;
+        StaticBatch& operator=(const StaticBatch&) = delete;
+
+        // Takes the VAO, textures and index range of an indexed command; program and sort key are ignored.
+        // Returns InvalidHandle when the batch is full.
+        size_t add(const DrawCommand& command, const StaticDrawData& data);
+        // Replaces the index range (e.g. after a LOD switch); no-op if it did not change
+        void setRange(size_t handle, const DrawCommand& command);
+        void setData(size_t handle, const StaticDrawData& data);
+        void remove(size_t handle);
+
+        // Rebuilds whatever changed, then draws every command with `program`
+        void draw(GLStateCache& state, GLuint program);
+
+        size_t size() const { return liveCount; }
+        size_t batchCount() const { return groups.size(); }
+        bool usesMultiDrawIndirect() const { return multiDraw; }
+
+        static constexpr size_t InvalidHandle = ~static_cast<size_t>(0);
+
+    private:
+        struct Entry {
+            DrawCommand command;
+            StaticDrawData data;
+            bool live = false;
+        };
+        // Commands [first, first + count) share the VAO, primitive and textures of entries[handle]
+        struct Group {
+            size_t handle;
+            size_t first;
+            size_t count;
+        };
+
+        std::vector<Entry> entries;            // Indexed by handle
+        std::vector<size_t> freeHandles;
+        size_t liveCount = 0;
+
+        std::vector<size_t> order;             // Handles in draw order; the position is the draw index
+        std::vector<DrawElementsIndirectCommand> commands;
+        std::vector<StaticDrawData> drawData;
+        std::vector<Group> groups;
+        std::vector<GLuint> attachedArrays;    // VAOs that already read aDrawID from drawIdBuffer
+
+        GLuint indirectBuffer = 0;
+        GLuint drawDataBuffer = 0;
+        GLuint drawIdBuffer = 0;
+        bool multiDraw = false;
+        bool rebuildOrder = false;
+        bool commandsDirty = false;
+        bool dataDirty = false;
+
+        void rebuild(GLStateCache& state);
+        void attachDrawId(GLStateCache& state, GLuint vertexArray);
+    };
+}
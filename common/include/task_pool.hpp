@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Common {
+    // Persistent worker threads for data-parallel loops within a frame. parallelFor() splits
+    // [0, count) into chunks that the workers and the calling thread take from a shared counter,
+    // and returns once every chunk has run. One parallelFor() at a time, from one thread.
+    class TaskPool {
+    public:
+        // Total threads including the caller; 0 means one per hardware thread
+        explicit TaskPool(unsigned int threads = 0);
+        ~TaskPool();
+        TaskPool(const TaskPool&) = delete;
+        TaskPool& operator=(const TaskPool&) = delete;
+
+        unsigned int threadCount() const { return static_cast<unsigned int>(workers.size()) + 1; }
+
+        // fn(size_t begin, size_t end) over chunks of `grain` items; runs inline when there is only one chunk
+        template <typename Fn>
+        void parallelFor(size_t count, size_t grain, Fn&& fn) {
+            if (count == 0)
+                return;
+            if (workers.empty() || count <= grain) {
+                fn(static_cast<size_t>(0), count);
+                return;
+            }
+            run(count, grain, std::function<void(size_t, size_t)>(std::forward<Fn>(fn)));
+        }
+
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::condition_variable done;
+        bool stopping = false;
+        uint64_t generation = 0;
+        unsigned int busyWorkers = 0;
+
+        const std::function<void(size_t, size_t)>* job = nullptr;
+        size_t jobCount = 0;
+        size_t jobGrain = 1;
+        std::atomic<size_t> nextItem{ 0 };
+
+        void run(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn);
+        void work();
+        void workerLoop();
+    };
+}
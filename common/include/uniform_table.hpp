@@ -0,0 +1,58 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Common {
+    // FNV-1a; constexpr so names written as `constexpr UniformName` are hashed by the compiler
+    constexpr uint32_t hashUniformName(const char* name) {
+        uint32_t hash = 2166136261u;
+        for (; *name; ++name)
+            hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+        return hash;
+    }
+
+    // A uniform name reduced to its hash. Implicitly built from string literals and std::string,
+    // so existing shader.setMat4("name", ...) calls keep working without any heap allocation.
+    // The pointer is only kept for the debug warning about missing uniforms.
+    struct UniformName {
+        uint32_t hash;
+        const char* name;
+
+        constexpr UniformName(const char* name) : hash(hashUniformName(name)), name(name) {}
+        UniformName(const std::string& name) : UniformName(name.c_str()) {}
+    };
+
+    // Active uniforms of a linked program, reflected once into a flat array sorted by name hash.
+    // Array uniforms are registered as "name", "name[0]" and every "name[i]".
+    class UniformTable {
+    public:
+        void reflect(GLuint program);
+
+        // Location for the name, -1 if the program has no such active uniform (glUniform* ignores -1).
+        // Debug builds print a warning the first time each missing name is asked for.
+        GLint location(UniformName name) const;
+        // Number of elements for array uniforms, 1 for plain ones, 0 when missing
+        GLint arraySize(UniformName name) const;
+
+        size_t size() const { return entries.size(); }
+
+    private:
+        struct Entry {
+            uint32_t hash;
+            GLint location;
+            GLint arraySize;
+        };
+
+        GLuint program = 0;
+        std::vector<Entry> entries;
+#ifndef NDEBUG
+        mutable std::vector<uint32_t> reportedMissing;
+#endif
+
+        const Entry* find(uint32_t hash) const;
+    };
+}
@@ -0,0 +1,270 @@
+#include "bvh.hpp"
+
+#include <algorithm>
+
+namespace Common {
+
+namespace {
+
+const int SahBins = 12;
+
+} // namespace
+
+int Bvh::allocateNode() {
+    if (freeList != Null) {
+        int node = freeList;
+        freeList = nodes[node].nextFree;
+        nodes[node] = Node();
+        return node;
+    }
+    nodes.emplace_back();
+    return static_cast<int>(nodes.size()) - 1;
+}
+
+void Bvh::freeNode(int node) {
+    nodes[node] = Node();
+    nodes[node].nextFree = freeList;
+    freeList = node;
+}
+
+int Bvh::insert(const Bounds& bounds, uint32_t item) {
+    int leaf = allocateNode();
+    nodes[leaf].bounds = bounds;
+    nodes[leaf].item = item;
+    insertLeaf(leaf);
+    proxyCount++;
+    return leaf;
+}
+
+void Bvh::remove(int proxy) {
+    removeLeaf(proxy);
+    freeNode(proxy);
+    proxyCount--;
+}
+
+void Bvh::update(int proxy, const Bounds& bounds) {
+    if (nodes[proxy].bounds == bounds)
+        return;
+    nodes[proxy].bounds = bounds;
+    refitFrom(nodes[proxy].parent);
+}
+
+void Bvh::refitFrom(int node) {
+    // Stops at the first ancestor whose bounds come out unchanged
+    while (node != Null) {
+        Bounds refit = merge(nodes[nodes[node].left].bounds, nodes[nodes[node].right].bounds);
+        if (refit == nodes[node].bounds)
+            break;
+        nodes[node].bounds = refit;
+        node = nodes[node].parent;
+    }
+}
+
+void Bvh::insertLeaf(int leaf) {
+    if (root == Null) {
+        root = leaf;
+        nodes[root].parent = Null;
+        return;
+    }
+
+    // Descend towards the sibling that adds the least surface area, stopping when pairing with the
+    // current node is cheaper than pushing the leaf further down (branch cost as in Box2D's tree)
+    const Bounds leafBounds = nodes[leaf].bounds;
+    int index = root;
+    while (!nodes[index].leaf()) {
+        const Node& node = nodes[index];
+        float area = node.bounds.surfaceArea();
+        float combinedArea = merge(node.bounds, leafBounds).surfaceArea();
+        float cost = 2.0f * combinedArea;
+        float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int child) {
+            float merged = merge(leafBounds, nodes[child].bounds).surfaceArea();
+            return (nodes[child].leaf() ? merged : merged - nodes[child].bounds.surfaceArea()) + inheritanceCost;
+        };
+        float leftCost = descendCost(node.left);
+        float rightCost = descendCost(node.right);
+        if (cost < leftCost && cost < rightCost)
+            break;
+        index = leftCost < rightCost ? node.left : node.right;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[sibling].parent;
+    int newParent = allocateNode();
+    nodes[newParent].parent = oldParent;
+    nodes[newParent].bounds = merge(leafBounds, nodes[sibling].bounds);
+    nodes[newParent].left = sibling;
+    nodes[newParent].right = leaf;
+    nodes[sibling].parent = newParent;
+    nodes[leaf].parent = newParent;
+
+    if (oldParent == Null) {
+        root = newParent;
+    } else {
+        if (nodes[oldParent].left == sibling)
+            nodes[oldParent].left = newParent;
+        else
+            nodes[oldParent].right = newParent;
+        refitFrom(oldParent);
+    }
+}
+
+void Bvh::removeLeaf(int leaf) {
+    if (leaf == root) {
+        root = Null;
+        return;
+    }
+
+    // The sibling takes the parent's place
+    int parent = nodes[leaf].parent;
+    int grandParent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+
+    if (grandParent == Null) {
+        root = sibling;
+        nodes[sibling].parent = Null;
+    } else {
+        if (nodes[grandParent].left == parent)
+            nodes[grandParent].left = sibling;
+        else
+            nodes[grandParent].right = sibling;
+        nodes[sibling].parent = grandParent;
+        refitFrom(grandParent);
+    }
+    freeNode(parent);
+}
+
+float Bvh::cost() const {
+    if (root == Null)
+        return 0.0f;
+    float rootArea = nodes[root].bounds.surfaceArea();
+    if (rootArea <= 0.0f)
+        return 0.0f;
+    float internalArea = 0.0f;
+    std::vector<int> stack;
+    stack.push_back(root);
+    while (!stack.empty()) {
+        const Node& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.leaf())
+            continue;
+        internalArea += node.bounds.surfaceArea();
+        stack.push_back(node.left);
+        stack.push_back(node.right);
+    }
+    return internalArea / rootArea;
+}
+
+bool Bvh::optimize(float degradation) {
+    if (proxyCount < 3)
+        return false;
+    float current = cost();
+    if (rebuildCost > 0.0f && current <= rebuildCost * degradation)
+        return false;
+    rebuild();
+    return true;
+}
+
+void Bvh::rebuild() {
+    std::vector<int> leaves;
+    leaves.reserve(proxyCount);
+    // Internal nodes are rebuilt from scratch; leaves keep their indices so proxies stay valid
+    for (size_t i = 0; i < nodes.size(); i++) {
+        const Node& node = nodes[i];
+        bool live = node.parent != Null || static_cast<int>(i) == root;
+        if (!live)
+            continue;
+        if (node.leaf())
+            leaves.push_back(static_cast<int>(i));
+    }
+    for (size_t i = 0; i < nodes.size(); i++) {
+        bool live = nodes[i].parent != Null || static_cast<int>(i) == root;
+        if (live && !nodes[i].leaf())
+            freeNode(static_cast<int>(i));
+    }
+
+    root = leaves.empty() ? Null : buildRange(leaves, 0, leaves.size(), Null);
+    rebuildCost = cost();
+}
+
+int Bvh::buildRange(std::vector<int>& leaves, size_t begin, size_t end, int parent) {
+    size_t count = end - begin;
+    if (count == 1) {
+        nodes[leaves[begin]].parent = parent;
+        return leaves[begin];
+    }
+
+    Bounds centroids;
+    for (size_t i = begin; i < end; i++)
+        centroids.expand(nodes[leaves[i]].bounds.center());
+    glm::vec3 spread = centroids.max - centroids.min;
+    int axis = spread.x > spread.y ? (spread.x > spread.z ? 0 : 2) : (spread.y > spread.z ? 1 : 2);
+
+    size_t middle = begin + count / 2;
+    if (spread[axis] > 0.0f && count > 2) {
+        // Binned SAH: bucket centroids along the widest axis and cut where
+        // area(left) * count(left) + area(right) * count(right) is smallest
+        Bounds binBounds[SahBins];
+        size_t binCounts[SahBins] = {};
+        float scale = SahBins / spread[axis];
+        auto binOf = [&](int leaf) {
+            int bin = static_cast<int>((nodes[leaf].bounds.center()[axis] - centroids.min[axis]) * scale);
+            return std::min(bin, SahBins - 1);
+        };
+        for (size_t i = begin; i < end; i++) {
+            int bin = binOf(leaves[i]);
+            binBounds[bin].expand(nodes[leaves[i]].bounds);
+            binCounts[bin]++;
+        }
+
+        float rightAreas[SahBins];
+        size_t rightCounts[SahBins];
+        Bounds accumulated;
+        size_t accumulatedCount = 0;
+        for (int bin = SahBins - 1; bin > 0; bin--) {
+            accumulated.expand(binBounds[bin]);
+            accumulatedCount += binCounts[bin];
+            rightAreas[bin] = accumulated.surfaceArea();
+            rightCounts[bin] = accumulatedCount;
+        }
+
+        float bestCost = -1.0f;
+        int bestSplit = 1;
+        accumulated = Bounds();
+        accumulatedCount = 0;
+        for (int split = 1; split < SahBins; split++) {
+            accumulated.expand(binBounds[split - 1]);
+            accumulatedCount += binCounts[split - 1];
+            if (accumulatedCount == 0 || rightCounts[split] == 0)
+                continue;
+            float splitCost = accumulated.surfaceArea() * accumulatedCount + rightAreas[split] * rightCounts[split];
+            if (bestCost < 0.0f || splitCost < bestCost) {
+                bestCost = splitCost;
+                bestSplit = split;
+            }
+        }
+        if (bestCost >= 0.0f) {
+            auto split = std::partition(leaves.begin() + begin, leaves.begin() + end, [&](int leaf) { return binOf(leaf) < bestSplit; });
+            middle = static_cast<size_t>(split - leaves.begin());
+        }
+    }
+    if (middle == begin || middle == end) {
+        // Coincident centroids: any even split is as good as another
+        middle = begin + count / 2;
+        std::nth_element(leaves.begin() + begin, leaves.begin() + middle, leaves.begin() + end, [&](int a, int b) {
+            return nodes[a].bounds.center()[axis] < nodes[b].bounds.center()[axis];
+        });
+    }
+
+    int node = allocateNode();
+    nodes[node].parent = parent;
+    int left = buildRange(leaves, begin, middle, node);
+    int right = buildRange(leaves, middle, end, node);
+    nodes[node].left = left;
+    nodes[node].right = right;
+    nodes[node].bounds = merge(nodes[left].bounds, nodes[right].bounds);
+    return node;
+}
+
+}
@@ -1,5 +1,7 @@
 #include "common.hpp"
 
+#include <algorithm>
+
 namespace Common {
 
 // Window implementation
@@ -64,8 +66,8 @@ void Window::framebufferSizeCallback(GLFWwindow* window, int width, int height)
 
 // Shader implementation
 Shader::Shader(const char* vertexPath, const char* fragmentPath) {
-    std::string vertexCode = readFile(vertexPath);
-    std::string fragmentCode = readFile(fragmentPath);
+    std::string vertexCode = expandShaderIncludes(readFile(vertexPath));
+    std::string fragmentCode = expandShaderIncludes(readFile(fragmentPath));
     
     const char* vShaderCode = vertexCode.c_str();
     const char* fShaderCode = fragmentCode.c_str();
@@ -88,6 +90,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
     glAttachShader(ID, fragment);
     glLinkProgram(ID);
     checkCompileErrors(ID, "PROGRAM");
+    uniforms.reflect(ID);
+    bindSharedUniformBlocks(ID);
     
     // Delete shaders
     glDeleteShader(vertex);
@@ -102,24 +106,32 @@ void Shader::use() {
     glUseProgram(ID);
 }
 
-void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+void Shader::setBool(UniformName name, bool value) const {
+    glUniform1i(uniforms.location(name), (int)value);
+}
+
+void Shader::setInt(UniformName name, int value) const {
+    glUniform1i(uniforms.location(name), value);
 }
 
-void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setFloat(UniformName name, float value) const {
+    glUniform1f(uniforms.location(name), value);
 }
 
-void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+void Shader::setVec3(UniformName name, const glm::vec3 &value) const {
+    glUniform3fv(uniforms.location(name), 1, &value[0]);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-    glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+void Shader::setMat4(UniformName name, const glm::mat4 &mat) const {
+    glUniformMatrix4fv(uniforms.location(name), 1, GL_FALSE, &mat[0][0]);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+void Shader::setMat4Array(UniformName name, const glm::mat4 *mats, int count) const {
+    // One call for the whole array; clamp so a longer CPU array cannot write past the uniform
+    count = std::min(count, uniforms.arraySize(name));
+    if (count > 0) {
+        glUniformMatrix4fv(uniforms.location(name), count, GL_FALSE, &mats[0][0][0]);
+    }
 }
 
 void Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
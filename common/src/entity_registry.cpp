@@ -0,0 +1,342 @@
+#include "entity_registry.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+namespace Common {
+
+namespace {
+
+template <typename T>
+void gather(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> sorted;
+    sorted.reserve(order.size());
+    for (uint32_t from : order)
+        sorted.push_back(values[from]);
+    values.swap(sorted);
+}
+
+} // namespace
+
+glm::mat4 localMatrix(const TransformComponent& transform) {
+    // translate * rotateY * rotateX * rotateZ * scale multiplied out, instead of building and
+    // multiplying five matrices
+    const float x = glm::radians(transform.rotation.x);
+    const float y = glm::radians(transform.rotation.y);
+    const float z = glm::radians(transform.rotation.z);
+    const float sx = std::sin(x), cx = std::cos(x);
+    const float sy = std::sin(y), cy = std::cos(y);
+    const float sz = std::sin(z), cz = std::cos(z);
+    const glm::vec3& scale = transform.scale;
+
+    glm::mat4 result(1.0f);
+    result[0] = glm::vec4(cy * cz + sy * sx * sz, cx * sz, -sy * cz + cy * sx * sz, 0.0f) * scale.x;
+    result[1] = glm::vec4(-cy * sz + sy * sx * cz, cx * cz, sy * sz + cy * sx * cz, 0.0f) * scale.y;
+    result[2] = glm::vec4(sy * cx, -sx, cy * cx, 0.0f) * scale.z;
+    result[3] = glm::vec4(transform.position, 1.0f);
+    return result;
+}
+
+void EntityRegistry::reserve(size_t count) {
+    slotIndex.reserve(count);
+    slotGeneration.reserve(count);
+    handles.reserve(count);
+    parentIndex.reserve(count);
+    componentBits.reserve(count);
+    dirty.reserve(count);
+    changed.reserve(count);
+    depths.reserve(count);
+    localMatrices.reserve(count);
+    locals.reserve(count);
+    worlds.reserve(count);
+    localBoxes.reserve(count);
+    for (std::vector<float>* column : { &worldBoxes.centerX, &worldBoxes.centerY, &worldBoxes.centerZ,
+                                        &worldBoxes.extentX, &worldBoxes.extentY, &worldBoxes.extentZ })
+        column->reserve(count);
+    renders.reserve(count);
+    animations.reserve(count);
+}
+
+EntityHandle EntityRegistry::create(EntityHandle parent) {
+    uint32_t parentAt = NoParent;
+    if (parent != Null) {
+        if (!alive(parent)) {
+            std::cout << "ERROR::ENTITY_REGISTRY: Parent entity is not alive" << std::endl;
+            return Null;
+        }
+        parentAt = index(parent);
+    }
+
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slotIndex.size());
+        if (slot > SlotMask) {
+            std::cout << "ERROR::ENTITY_REGISTRY: Out of entity slots" << std::endl;
+            return Null;
+        }
+        slotIndex.push_back(FreeSlot);
+        slotGeneration.push_back(0);
+    }
+    EntityHandle entity = (static_cast<uint32_t>(slotGeneration[slot]) << 24) | slot;
+
+    // Appending keeps parents first (the parent already has a smaller index) but only keeps the
+    // depth order if the new entity is at least as deep as the last one
+    uint32_t at = static_cast<uint32_t>(handles.size());
+    slotIndex[slot] = at;
+    handles.push_back(entity);
+    parentIndex.push_back(parentAt);
+    componentBits.push_back(Alive);
+    dirty.push_back(1);
+    changed.push_back(0);
+    depths.push_back(parentAt == NoParent ? 0 : depths[parentAt] + 1);
+    localMatrices.emplace_back(1.0f);
+    locals.emplace_back();
+    worlds.emplace_back(1.0f);
+    localBoxes.emplace_back();
+    worldBoxes.push_back(Bounds());
+    renders.emplace_back();
+    animations.emplace_back();
+    if (depths.size() > 1 && depths.back() < depths[depths.size() - 2])
+        needsSort = true;
+    liveCount++;
+    levelsDirty = true;
+    anyDirty = true;
+    return entity;
+}
+
+bool EntityRegistry::alive(EntityHandle entity) const {
+    if (entity == Null)
+        return false;
+    uint32_t slot = entity & SlotMask;
+    return slot < slotIndex.size() && slotIndex[slot] != FreeSlot && slotGeneration[slot] == (entity >> 24);
+}
+
+void EntityRegistry::releaseSlot(uint32_t at) {
+    uint32_t slot = handles[at] & SlotMask;
+    slotIndex[slot] = FreeSlot;
+    slotGeneration[slot]++;
+    freeSlots.push_back(slot);
+    componentBits[at] = 0;
+    worldBoxes.set(at, Bounds());
+    liveCount--;
+}
+
+void EntityRegistry::destroy(EntityHandle entity) {
+    if (!alive(entity))
+        return;
+    // Descendants are found with one forward pass, which needs parents first
+    if (needsSort)
+        flush();
+    uint32_t root = index(entity);
+    releaseSlot(root);
+    for (uint32_t i = root + 1; i < handles.size(); i++) {
+        uint32_t parentAt = parentIndex[i];
+        if ((componentBits[i] & Alive) && parentAt != NoParent && !(componentBits[parentAt] & Alive))
+            releaseSlot(i);
+    }
+    needsCompaction = true;
+}
+
+bool EntityRegistry::setParent(EntityHandle entity, EntityHandle parent) {
+    if (!alive(entity) || (parent != Null && !alive(parent))) {
+        std::cout << "ERROR::ENTITY_REGISTRY: setParent on an entity that is not alive" << std::endl;
+        return false;
+    }
+    uint32_t at = index(entity);
+    uint32_t parentAt = parent == Null ? NoParent : index(parent);
+    for (uint32_t ancestor = parentAt; ancestor != NoParent; ancestor = parentIndex[ancestor]) {
+        if (ancestor == at) {
+            std::cout << "ERROR::ENTITY_REGISTRY: setParent would make an entity its own ancestor" << std::endl;
+            return false;
+        }
+    }
+    parentIndex[at] = parentAt;
+    dirty[at] = 1;
+    anyDirty = true;
+    // The entity's subtree changes depth
+    needsSort = true;
+    return true;
+}
+
+EntityHandle EntityRegistry::parent(EntityHandle entity) const {
+    uint32_t parentAt = parentIndex[index(entity)];
+    return parentAt == NoParent ? Null : handles[parentAt];
+}
+
+TransformComponent& EntityRegistry::editTransform(EntityHandle entity) {
+    uint32_t at = index(entity);
+    dirty[at] = 1;
+    anyDirty = true;
+    return locals[at];
+}
+
+void EntityRegistry::setLocalBounds(EntityHandle entity, const Bounds& bounds) {
+    uint32_t at = index(entity);
+    localBoxes[at] = bounds;
+    dirty[at] = 1;
+    anyDirty = true;
+}
+
+void EntityRegistry::setRender(EntityHandle entity, const RenderComponent& render) {
+    uint32_t at = index(entity);
+    renders[at] = render;
+    componentBits[at] |= HasRender;
+}
+
+void EntityRegistry::removeRender(EntityHandle entity) {
+    componentBits[index(entity)] &= ~HasRender;
+}
+
+const RenderComponent* EntityRegistry::render(EntityHandle entity) const {
+    uint32_t at = index(entity);
+    return (componentBits[at] & HasRender) ? &renders[at] : nullptr;
+}
+
+void EntityRegistry::setAnimation(EntityHandle entity, const AnimationComponent& animation) {
+    uint32_t at = index(entity);
+    animations[at] = animation;
+    componentBits[at] |= HasAnimation;
+}
+
+void EntityRegistry::removeAnimation(EntityHandle entity) {
+    componentBits[index(entity)] &= ~HasAnimation;
+}
+
+AnimationComponent* EntityRegistry::animation(EntityHandle entity) {
+    uint32_t at = index(entity);
+    return (componentBits[at] & HasAnimation) ? &animations[at] : nullptr;
+}
+
+void EntityRegistry::flush() {
+    if (!needsCompaction && !needsSort)
+        return;
+
+    std::vector<uint32_t> order;
+    order.reserve(liveCount);
+    for (uint32_t i = 0; i < handles.size(); i++) {
+        if (componentBits[i] & Alive)
+            order.push_back(i);
+    }
+
+    if (needsSort) {
+        // A stable sort by depth makes each level contiguous, puts every parent ahead of its
+        // children and otherwise keeps the current order
+        std::vector<uint32_t> depth(handles.size(), NoParent);
+        std::vector<uint32_t> chain;
+        for (uint32_t i : order) {
+            // Walk up to a root or an entity whose depth is known, then fill in the chain on the way back
+            uint32_t at = i;
+            while (depth[at] == NoParent && parentIndex[at] != NoParent) {
+                chain.push_back(at);
+                at = parentIndex[at];
+            }
+            if (depth[at] == NoParent)
+                depth[at] = 0;
+            uint32_t d = depth[at];
+            while (!chain.empty()) {
+                depth[chain.back()] = ++d;
+                chain.pop_back();
+            }
+        }
+        for (uint32_t i : order)
+            depths[i] = depth[i];
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+    }
+
+    reorder(order);
+    needsCompaction = false;
+    needsSort = false;
+    levelsDirty = true;
+}
+
+void EntityRegistry::reorder(const std::vector<uint32_t>& order) {
+    std::vector<uint32_t> newIndex(handles.size(), NoParent);
+    for (uint32_t i = 0; i < order.size(); i++)
+        newIndex[order[i]] = i;
+
+    gather(handles, order);
+    gather(parentIndex, order);
+    for (uint32_t& parentAt : parentIndex) {
+        if (parentAt != NoParent)
+            parentAt = newIndex[parentAt];
+    }
+    gather(componentBits, order);
+    gather(dirty, order);
+    gather(changed, order);
+    gather(depths, order);
+    gather(localMatrices, order);
+    gather(locals, order);
+    gather(worlds, order);
+    gather(localBoxes, order);
+    for (std::vector<float>* column : { &worldBoxes.centerX, &worldBoxes.centerY, &worldBoxes.centerZ,
+                                        &worldBoxes.extentX, &worldBoxes.extentY, &worldBoxes.extentZ })
+        gather(*column, order);
+    gather(renders, order);
+    gather(animations, order);
+
+    for (uint32_t i = 0; i < handles.size(); i++)
+        slotIndex[handles[i] & SlotMask] = i;
+}
+
+size_t EntityRegistry::updateTransforms(TaskPool* pool) {
+    flush();
+    if (!anyDirty)
+        return 0;
+
+    if (levelsDirty) {
+        levelStart.clear();
+        for (uint32_t i = 0; i < depths.size(); i++) {
+            if (i == 0 || depths[i] != depths[i - 1])
+                levelStart.push_back(i);
+        }
+        levelStart.push_back(static_cast<uint32_t>(depths.size()));
+        levelsDirty = false;
+    }
+
+    // Within a level no entity reads another's results, only its parent's from the level above
+    std::atomic<size_t> updated{ 0 };
+    auto updateRange = [&](size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+            uint32_t parentAt = parentIndex[i];
+            changed[i] = dirty[i] | (parentAt != NoParent ? changed[parentAt] : 0);
+            if (!changed[i] || !(componentBits[i] & Alive))
+                continue;
+            // The Euler angle rotation is only rebuilt when the entity itself moved
+            if (dirty[i])
+                localMatrices[i] = localMatrix(locals[i]);
+            worlds[i] = parentAt == NoParent ? localMatrices[i] : worlds[parentAt] * localMatrices[i];
+            worldBoxes.set(i, localBoxes[i].empty() ? Bounds() : transformBounds(localBoxes[i], worlds[i]));
+            count++;
+        }
+        updated.fetch_add(count, std::memory_order_relaxed);
+    };
+    for (size_t level = 0; level + 1 < levelStart.size(); level++) {
+        size_t begin = levelStart[level];
+        size_t end = levelStart[level + 1];
+        if (pool) {
+            pool->parallelFor(end - begin, TransformGrain, [&](size_t first, size_t last) { updateRange(begin + first, begin + last); });
+        } else {
+            updateRange(begin, end);
+        }
+    }
+
+    std::fill(dirty.begin(), dirty.end(), static_cast<uint8_t>(0));
+    std::fill(changed.begin(), changed.end(), static_cast<uint8_t>(0));
+    anyDirty = false;
+    return updated.load();
+}
+
+void EntityRegistry::advanceAnimations(float deltaTime) {
+    eachAnimated([deltaTime](uint32_t, AnimationComponent& animation) {
+        if (animation.playing)
+            animation.time += deltaTime * animation.speed;
+    });
+}
+
+}
@@ -0,0 +1,82 @@
+#include "frame_data.hpp"
+#include "static_batch.hpp"
+
+namespace Common {
+
+const char* const FrameDataGlsl = R"(layout(std140) uniform FrameData
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    float time;
+    vec3 lightPos;
+    float frameDataPadding0;
+    vec3 lightColor;
+    float frameDataPadding1;
+};
+)";
+
+std::string expandShaderIncludes(const std::string& source) {
+    static const struct {
+        std::string directive;
+        const char* text;
+    } includes[] = {
+        { "#include \"frame_data.glsl\"", FrameDataGlsl },
+        { "#include \"static_draw.glsl\"", StaticDrawGlsl },
+    };
+
+    std::string result;
+    result.reserve(source.size() + 256);
+    size_t lineStart = 0;
+    while (lineStart < source.size()) {
+        size_t lineEnd = source.find('\n', lineStart);
+        if (lineEnd == std::string::npos)
+            lineEnd = source.size();
+
+        size_t first = source.find_first_not_of(" \t", lineStart);
+        const char* replacement = nullptr;
+        for (const auto& include : includes) {
+            if (first < lineEnd && source.compare(first, include.directive.size(), include.directive) == 0)
+                replacement = include.text;
+        }
+        if (replacement)
+            result += replacement;
+        else
+            result.append(source, lineStart, lineEnd - lineStart).append("\n");
+        lineStart = lineEnd + 1;
+    }
+    return result;
+}
+
+void bindSharedUniformBlocks(GLuint program) {
+    GLuint blockIndex = glGetUniformBlockIndex(program, "FrameData");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, FrameDataBinding);
+    blockIndex = glGetUniformBlockIndex(program, "StaticDrawData");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, StaticDrawDataBinding);
+    blockIndex = glGetUniformBlockIndex(program, "BonePalette");
+    if (blockIndex != GL_INVALID_INDEX)
+        glUniformBlockBinding(program, blockIndex, BonePaletteBinding);
+}
+
+FrameUniformBuffer::FrameUniformBuffer() {
+    glGenBuffers(1, &ubo);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    // The binding point never changes, so attach the buffer once here
+    glBindBufferBase(GL_UNIFORM_BUFFER, FrameDataBinding, ubo);
+}
+
+FrameUniformBuffer::~FrameUniformBuffer() {
+    glDeleteBuffers(1, &ubo);
+}
+
+void FrameUniformBuffer::update(const FrameData& data) {
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+}
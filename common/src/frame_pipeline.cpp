@@ -0,0 +1,122 @@
+#include "frame_pipeline.hpp"
+
+#include <iostream>
+
+namespace Common {
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+RenderThread::RenderThread(bool threaded, Callbacks callbacks)
+    : callbacks(std::move(callbacks)), threadedMode(threaded) {
+    if (threadedMode)
+        renderThread = std::thread(&RenderThread::run, this);
+    else
+        std::cout << "RenderThread: single-threaded, rendering inline" << std::endl;
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+int RenderThread::acquire() {
+    int slot = nextSlot;
+    nextSlot ^= 1;
+    if (threadedMode) {
+        auto start = std::chrono::steady_clock::now();
+        std::unique_lock<std::mutex> lock(mutex);
+        // The previous packet must be picked up and this slot no longer drawn: at most one frame in flight
+        changed.wait(lock, [this, slot] { return pending == -1 && rendering != slot; });
+        lock.unlock();
+
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        timings.waitMilliseconds += millisecondsSince(start);
+    }
+    acquiredAt = std::chrono::steady_clock::now();
+    return slot;
+}
+
+void RenderThread::publish(int slot) {
+    {
+        std::lock_guard<std::mutex> statsLock(statsMutex);
+        timings.simulateMilliseconds += millisecondsSince(acquiredAt);
+    }
+    if (!threadedMode) {
+        renderSlot(slot);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = slot;
+    }
+    changed.notify_all();
+}
+
+void RenderThread::stop() {
+    if (!renderThread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    renderThread.join();
+}
+
+void RenderThread::run() {
+    if (callbacks.begin)
+        callbacks.begin();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return pending != -1 || stopping; });
+        if (pending == -1)
+            break;
+        rendering = pending;
+        pending = -1;
+        lock.unlock();
+        changed.notify_all();
+
+        renderSlot(rendering);
+
+        lock.lock();
+        rendering = -1;
+        changed.notify_all();
+    }
+    lock.unlock();
+
+    if (callbacks.end)
+        callbacks.end();
+}
+
+void RenderThread::renderSlot(int slot) {
+    auto start = std::chrono::steady_clock::now();
+    callbacks.render(slot);
+    double milliseconds = millisecondsSince(start);
+
+    std::lock_guard<std::mutex> lock(statsMutex);
+    timings.renderMilliseconds += milliseconds;
+    timings.frames++;
+}
+
+void RenderThread::logStats(const std::string& label) {
+    FrameTimings snapshot;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        snapshot = timings;
+        timings = FrameTimings();
+    }
+    if (snapshot.frames == 0)
+        return;
+    double frames = snapshot.frames;
+    std::cout << label << ": " << (threadedMode ? "threaded" : "single-threaded") << ", simulate "
+              << snapshot.simulateMilliseconds / frames << " ms, render " << snapshot.renderMilliseconds / frames
+              << " ms, waiting " << snapshot.waitMilliseconds / frames << " ms per frame over " << snapshot.frames << " frames" << std::endl;
+}
+
+}
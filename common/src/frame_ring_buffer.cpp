@@ -0,0 +1,122 @@
+#include "frame_ring_buffer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+namespace Common {
+
+FrameRingBuffer::FrameRingBuffer(GLenum target, size_t bytesPerFrame, unsigned int frames)
+    : target(target), sectionCount(std::max(frames, 1u)), fences(std::max(frames, 1u), nullptr) {
+    if (target == GL_UNIFORM_BUFFER) {
+        GLint uniformAlignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+        alignment = std::max<size_t>(alignment, static_cast<size_t>(uniformAlignment));
+    }
+    // Sections start on an aligned offset so every allocation's offset is aligned too
+    sectionBytes = (bytesPerFrame + alignment - 1) / alignment * alignment;
+
+    glGenBuffers(1, &ringBuffer);
+    glBindBuffer(target, ringBuffer);
+    if (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target, sectionBytes * sectionCount, nullptr, flags);
+        mappedMemory = static_cast<unsigned char*>(glMapBufferRange(target, 0, sectionBytes * sectionCount, flags));
+        if (!mappedMemory) {
+            // Immutable storage cannot be respecified, so the fallback needs a new buffer
+            std::cout << "ERROR::FRAME_RING_BUFFER: persistent mapping failed" << std::endl;
+            glDeleteBuffers(1, &ringBuffer);
+            glGenBuffers(1, &ringBuffer);
+            glBindBuffer(target, ringBuffer);
+        }
+    }
+    if (!mappedMemory) {
+        std::cout << "FrameRingBuffer: no persistent mapping, orphaning with glBufferData each frame" << std::endl;
+        glBufferData(target, sectionBytes, nullptr, GL_STREAM_DRAW);
+        staging.resize(sectionBytes);
+        sectionCount = 1;
+    }
+    glBindBuffer(target, 0);
+}
+
+FrameRingBuffer::~FrameRingBuffer() {
+    for (GLsync fence : fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+    if (mappedMemory) {
+        glBindBuffer(target, ringBuffer);
+        glUnmapBuffer(target);
+        glBindBuffer(target, 0);
+    }
+    glDeleteBuffers(1, &ringBuffer);
+}
+
+void FrameRingBuffer::beginFrame() {
+    section = (section + 1) % sectionCount;
+    head = 0;
+    counters.frames++;
+
+    GLsync& fence = fences[section];
+    if (!fence)
+        return;
+
+    // Poll first: a signalled fence means the GPU is done with the section and nothing blocks
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        auto start = std::chrono::steady_clock::now();
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);   // 1 s
+        } while (result == GL_TIMEOUT_EXPIRED);
+        double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        counters.stalls++;
+        counters.stallMilliseconds += milliseconds;
+        std::cout << "FrameRingBuffer: stalled " << milliseconds << " ms waiting for the GPU on section " << section << std::endl;
+    }
+    if (result == GL_WAIT_FAILED)
+        std::cout << "ERROR::FRAME_RING_BUFFER: fence wait failed" << std::endl;
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+RingAllocation FrameRingBuffer::allocate(size_t bytes) {
+    RingAllocation allocation;
+    size_t size = (bytes + alignment - 1) / alignment * alignment;
+    if (head + size > sectionBytes) {
+        if (counters.overflows++ == 0)
+            std::cout << "ERROR::FRAME_RING_BUFFER: frame section of " << sectionBytes << " bytes is full" << std::endl;
+        return allocation;
+    }
+
+    size_t offset = persistent() ? section * sectionBytes + head : head;
+    allocation.data = persistent() ? mappedMemory + offset : staging.data() + head;
+    allocation.offset = static_cast<GLintptr>(offset);
+    allocation.size = static_cast<GLsizeiptr>(bytes);
+    head += size;
+    counters.peakFrameBytes = std::max(counters.peakFrameBytes, head);
+    return allocation;
+}
+
+void FrameRingBuffer::flush() {
+    if (persistent() || head == 0)
+        return;
+    // Orphan: the driver hands out fresh storage while draws still in flight keep the old one
+    glBindBuffer(target, ringBuffer);
+    glBufferData(target, sectionBytes, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(target, 0, head, staging.data());
+    glBindBuffer(target, 0);
+}
+
+void FrameRingBuffer::endFrame() {
+    if (persistent())
+        fences[section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void FrameRingBuffer::logStats(const std::string& label) const {
+    std::cout << label << ": " << (persistent() ? "persistent" : "orphaning") << ", " << counters.frames << " frames, "
+              << counters.stalls << " stalls (" << counters.stallMilliseconds << " ms), peak " << counters.peakFrameBytes
+              << "/" << sectionBytes << " bytes per frame, " << counters.overflows << " overflows" << std::endl;
+}
+
+}
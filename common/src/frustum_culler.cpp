@@ -0,0 +1,231 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMMON_FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+#if defined(COMMON_FRUSTUM_AVX2) && defined(_MSC_VER)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace Common {
+
+#ifdef COMMON_FRUSTUM_AVX2
+namespace Detail {
+void cullFrustumAvx2(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask);
+}
+#endif
+
+namespace {
+
+// Boxes per parallelFor() chunk; smaller chunks cost more to hand out than they save. A multiple
+// of 32 so chunks are whole mask words
+const size_t BoxesPerTask = 65536;
+
+// Half extent stored for empty bounds: negative, so distance + radius is below zero for any
+// normalized plane, and finite, so a zero normal component gives 0 rather than NaN
+const float EmptyExtent = -1e30f;
+
+enum class Kernel { Scalar, Sse, Avx2 };
+
+bool cpuHasAvx2() {
+#if !defined(COMMON_FRUSTUM_AVX2)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    // The OS must also save the YMM registers on context switches
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+const bool useAvx2 = cpuHasAvx2();
+
+bool boxVisible(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t i) {
+    for (const glm::vec4& plane : frustum.planes) {
+        float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+        float radius = std::abs(plane.x) * bounds.extentX[i] + std::abs(plane.y) * bounds.extentY[i] + std::abs(plane.z) * bounds.extentZ[i];
+        if (distance + radius < 0.0f)
+            return false;
+    }
+    return true;
+}
+
+void cullScalar(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    for (size_t word = begin; word < end; word += 32) {
+        uint32_t bits = 0;
+        size_t last = std::min(word + 32, end);
+        for (size_t i = word; i < last; i++) {
+            if (boxVisible(frustum, bounds, i))
+                bits |= 1u << (i - word);
+        }
+        mask[word >> 5] = bits;
+    }
+}
+
+#ifdef COMMON_FRUSTUM_SSE
+// Whole mask words only, 4 boxes per iteration
+void cullSse(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t word = begin; word < end; word += 32) {
+        uint32_t bits = 0;
+        for (size_t i = word; i < word + 32; i += 4) {
+            __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+            __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+            __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+            __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+            __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const glm::vec4& plane : frustum.planes) {
+                __m128 nx = _mm_set1_ps(plane.x);
+                __m128 ny = _mm_set1_ps(plane.y);
+                __m128 nz = _mm_set1_ps(plane.z);
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)),
+                                             _mm_add_ps(_mm_mul_ps(nz, cz), _mm_set1_ps(plane.w)));
+                __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, signMask), ex), _mm_mul_ps(_mm_and_ps(ny, signMask), ey)),
+                                           _mm_mul_ps(_mm_and_ps(nz, signMask), ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), zero));
+            }
+            bits |= static_cast<uint32_t>(_mm_movemask_ps(inside)) << (i - word);
+        }
+        mask[word >> 5] = bits;
+    }
+}
+#endif
+
+void runKernel(Kernel kernel, const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    end = std::min(end, bounds.size());
+    if (begin >= end)
+        return;
+    // The vector kernels take whole words; a partial last word goes to the scalar loop
+    size_t wholeEnd = begin + (end - begin) / 32 * 32;
+    switch (kernel) {
+#ifdef COMMON_FRUSTUM_AVX2
+    case Kernel::Avx2:
+        Detail::cullFrustumAvx2(frustum, bounds, begin, wholeEnd, mask);
+        break;
+#endif
+#ifdef COMMON_FRUSTUM_SSE
+    case Kernel::Sse:
+        cullSse(frustum, bounds, begin, wholeEnd, mask);
+        break;
+#endif
+    default:
+        cullScalar(frustum, bounds, begin, wholeEnd, mask);
+        break;
+    }
+    cullScalar(frustum, bounds, wholeEnd, end, mask);
+}
+
+Kernel bestKernel() {
+    if (useAvx2)
+        return Kernel::Avx2;
+#ifdef COMMON_FRUSTUM_SSE
+    return Kernel::Sse;
+#else
+    return Kernel::Scalar;
+#endif
+}
+
+} // namespace
+
+void BoundsSoA::resize(size_t count) {
+    for (std::vector<float>* column : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+        column->resize(count);
+}
+
+void BoundsSoA::set(size_t index, const Bounds& bounds) {
+    bool empty = bounds.empty();
+    glm::vec3 center = empty ? glm::vec3(0.0f) : bounds.center();
+    glm::vec3 extents = empty ? glm::vec3(EmptyExtent) : bounds.extents();
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    extentX[index] = extents.x;
+    extentY[index] = extents.y;
+    extentZ[index] = extents.z;
+}
+
+size_t BoundsSoA::push_back(const Bounds& bounds) {
+    size_t index = size();
+    resize(index + 1);
+    set(index, bounds);
+    return index;
+}
+
+std::vector<uint32_t>& resizeVisibilityMask(std::vector<uint32_t>& mask, size_t count) {
+    mask.resize((count + 31) / 32);
+    return mask;
+}
+
+void cullFrustum(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    runKernel(bestKernel(), frustum, bounds, begin, end, mask);
+}
+
+size_t cullFrustum(const FrustumPlanes& frustum, const BoundsSoA& bounds, std::vector<uint32_t>& mask, TaskPool* pool) {
+    size_t count = bounds.size();
+    resizeVisibilityMask(mask, count);
+
+    if (pool != nullptr) {
+        // Chunk starts are multiples of the grain, so no two threads write the same mask word
+        pool->parallelFor(count, BoxesPerTask, [&](size_t begin, size_t end) {
+            cullFrustum(frustum, bounds, begin, end, mask.data());
+        });
+    } else {
+        cullFrustum(frustum, bounds, 0, count, mask.data());
+    }
+
+    size_t visible = 0;
+    for (uint32_t word : mask)
+        visible += std::bitset<32>(word).count();
+    return visible;
+}
+
+const char* frustumCullKernel() {
+    switch (bestKernel()) {
+    case Kernel::Avx2:
+        return "avx2";
+    case Kernel::Sse:
+        return "sse";
+    default:
+        return "scalar";
+    }
+}
+
+bool cullFrustumWithKernel(const char* kernel, const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    if (std::strcmp(kernel, "scalar") == 0) {
+        runKernel(Kernel::Scalar, frustum, bounds, begin, end, mask);
+        return true;
+    }
+#ifdef COMMON_FRUSTUM_SSE
+    if (std::strcmp(kernel, "sse") == 0) {
+        runKernel(Kernel::Sse, frustum, bounds, begin, end, mask);
+        return true;
+    }
+#endif
+    if (std::strcmp(kernel, "avx2") == 0 && useAvx2) {
+        runKernel(Kernel::Avx2, frustum, bounds, begin, end, mask);
+        return true;
+    }
+    return false;
+}
+
+}
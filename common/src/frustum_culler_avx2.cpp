@@ -0,0 +1,60 @@
+// Built with AVX2 code generation (see CMakeLists.txt) and only called after a CPU check, so
+// nothing in here may be reached on machines without it
+#include "frustum_culler.hpp"
+
+#if defined(COMMON_FRUSTUM_AVX2) && defined(__AVX2__)
+#include <immintrin.h>
+
+namespace Common {
+
+namespace Detail {
+
+// Whole mask words only: begin and end are multiples of 32
+void cullFrustumAvx2(const FrustumPlanes& frustum, const BoundsSoA& bounds, size_t begin, size_t end, uint32_t* mask) {
+    __m256 normalX[FrustumPlanes::Count], normalY[FrustumPlanes::Count], normalZ[FrustumPlanes::Count];
+    __m256 absX[FrustumPlanes::Count], absY[FrustumPlanes::Count], absZ[FrustumPlanes::Count];
+    __m256 offset[FrustumPlanes::Count];
+    for (int p = 0; p < FrustumPlanes::Count; p++) {
+        const glm::vec4& plane = frustum.planes[p];
+        normalX[p] = _mm256_set1_ps(plane.x);
+        normalY[p] = _mm256_set1_ps(plane.y);
+        normalZ[p] = _mm256_set1_ps(plane.z);
+        absX[p] = _mm256_set1_ps(std::abs(plane.x));
+        absY[p] = _mm256_set1_ps(std::abs(plane.y));
+        absZ[p] = _mm256_set1_ps(std::abs(plane.z));
+        offset[p] = _mm256_set1_ps(plane.w);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+
+    for (size_t word = begin; word < end; word += 32) {
+        uint32_t bits = 0;
+        for (size_t i = word; i < word + 32; i += 8) {
+            __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+            __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+            __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+            __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+            __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+            // Box is outside a plane when center distance + projected radius < 0
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < FrustumPlanes::Count; p++) {
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(normalX[p], cx), _mm256_mul_ps(normalY[p], cy)),
+                    _mm256_add_ps(_mm256_mul_ps(normalZ[p], cz), offset[p]));
+                __m256 radius = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)),
+                    _mm256_mul_ps(absZ[p], ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), zero, _CMP_GE_OQ));
+            }
+            bits |= static_cast<uint32_t>(_mm256_movemask_ps(inside)) << (i - word);
+        }
+        mask[word >> 5] = bits;
+    }
+}
+
+} // namespace Detail
+
+}
+
+#endif
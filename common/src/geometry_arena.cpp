@@ -0,0 +1,187 @@
+#include "geometry_arena.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Common {
+
+namespace {
+
+// Replaces a buffer with a larger one, copying the old contents on the GPU
+GLuint growBuffer(GLuint oldBuffer, size_t oldBytes, size_t newBytes) {
+    GLuint newBuffer = 0;
+    glGenBuffers(1, &newBuffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+
+    if (oldBuffer != 0) {
+        glBindBuffer(GL_COPY_READ_BUFFER, oldBuffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glDeleteBuffers(1, &oldBuffer);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return newBuffer;
+}
+
+} // namespace
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+    grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t size) {
+    if (size == 0)
+        return InvalidOffset;
+
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+        if (it->second < size)
+            continue;
+
+        size_t offset = it->first;
+        size_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0)
+            freeRanges.emplace(offset + size, remaining);
+        usedUnits += size;
+        return offset;
+    }
+    return InvalidOffset;
+}
+
+void RangeAllocator::free(size_t offset, size_t size) {
+    if (size == 0)
+        return;
+    usedUnits -= size;
+
+    auto next = freeRanges.lower_bound(offset);
+    // Merge with the following range
+    if (next != freeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    // Merge with the preceding range
+    if (next != freeRanges.begin()) {
+        auto previous = std::prev(next);
+        if (previous->first + previous->second == offset) {
+            previous->second += size;
+            return;
+        }
+    }
+    freeRanges.emplace(offset, size);
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= totalCapacity)
+        return;
+
+    size_t oldCapacity = totalCapacity;
+    totalCapacity = newCapacity;
+    // Hand the new tail to free() so it merges with a free range ending at the old capacity
+    usedUnits += newCapacity - oldCapacity;
+    free(oldCapacity, newCapacity - oldCapacity);
+}
+
+size_t RangeAllocator::largestFreeRange() const {
+    size_t largest = 0;
+    for (const auto& range : freeRanges)
+        largest = std::max(largest, range.second);
+    return largest;
+}
+
+GeometryArena::GeometryArena(const VertexFormat& format, size_t vertexCapacity, size_t indexCapacity)
+    : vertexFormat(format) {
+    glGenVertexArrays(1, &vertexArray);
+    growVertexBuffer(vertexCapacity);
+    growIndexBuffer(indexCapacity);
+}
+
+GeometryAllocation GeometryArena::allocate(const void* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    GeometryAllocation allocation;
+    if (vertexCount == 0 || indexCount == 0)
+        return allocation;
+
+    size_t vertexOffset = vertexRanges.allocate(vertexCount);
+    if (vertexOffset == RangeAllocator::InvalidOffset) {
+        growVertexBuffer(std::max(vertexRanges.capacity() * 2, vertexRanges.capacity() + vertexCount));
+        vertexOffset = vertexRanges.allocate(vertexCount);
+    }
+    size_t indexOffset = indexRanges.allocate(indexCount);
+    if (indexOffset == RangeAllocator::InvalidOffset) {
+        growIndexBuffer(std::max(indexRanges.capacity() * 2, indexRanges.capacity() + indexCount));
+        indexOffset = indexRanges.allocate(indexCount);
+    }
+
+    // Upload through the copy-write target so no VAO's element binding is disturbed
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * vertexFormat.stride, vertexCount * vertexFormat.stride, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, indexOffset * sizeof(unsigned int), indexCount * sizeof(unsigned int), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    allocation.baseVertex = static_cast<unsigned int>(vertexOffset);
+    allocation.firstIndex = static_cast<unsigned int>(indexOffset);
+    allocation.vertexCount = static_cast<unsigned int>(vertexCount);
+    allocation.indexCount = static_cast<unsigned int>(indexCount);
+    allocationCount++;
+    return allocation;
+}
+
+void GeometryArena::free(const GeometryAllocation& allocation) {
+    if (!allocation.valid())
+        return;
+    vertexRanges.free(allocation.baseVertex, allocation.vertexCount);
+    indexRanges.free(allocation.firstIndex, allocation.indexCount);
+    allocationCount--;
+}
+
+size_t GeometryArena::gpuBytes() const {
+    return vertexRanges.capacity() * vertexFormat.stride + indexRanges.capacity() * sizeof(unsigned int);
+}
+
+void GeometryArena::logUsage(const std::string& label) const {
+    std::cout << label << ": " << allocationCount << " meshes, vertices " << vertexRanges.used() << "/" << vertexRanges.capacity()
+              << " (" << vertexRanges.freeRangeCount() << " free ranges), indices " << indexRanges.used() << "/" << indexRanges.capacity()
+              << " (" << indexRanges.freeRangeCount() << " free ranges), " << gpuBytes() / 1024.0f << " KiB" << std::endl;
+}
+
+void GeometryArena::createVertexArray() {
+    glBindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+    for (const auto& attribute : vertexFormat.attributes) {
+        glEnableVertexAttribArray(attribute.index);
+        if (attribute.integer)
+            glVertexAttribIPointer(attribute.index, attribute.components, attribute.type,
+                                   static_cast<GLsizei>(vertexFormat.stride), (void*)attribute.offset);
+        else
+            glVertexAttribPointer(attribute.index, attribute.components, attribute.type, attribute.normalized,
+                                  static_cast<GLsizei>(vertexFormat.stride), (void*)attribute.offset);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GeometryArena::growVertexBuffer(size_t minCapacity) {
+    size_t oldCapacity = vertexRanges.capacity();
+    vertexBuffer = growBuffer(vertexBuffer, oldCapacity * vertexFormat.stride, minCapacity * vertexFormat.stride);
+    vertexRanges.grow(minCapacity);
+    if (oldCapacity != 0)
+        std::cout << "GeometryArena: vertex buffer grown to " << minCapacity << " vertices" << std::endl;
+    // Attribute pointers captured the old buffer, so they have to be specified again
+    if (indexBuffer != 0)
+        createVertexArray();
+}
+
+void GeometryArena::growIndexBuffer(size_t minCapacity) {
+    size_t oldCapacity = indexRanges.capacity();
+    indexBuffer = growBuffer(indexBuffer, oldCapacity * sizeof(unsigned int), minCapacity * sizeof(unsigned int));
+    indexRanges.grow(minCapacity);
+    if (oldCapacity != 0)
+        std::cout << "GeometryArena: index buffer grown to " << minCapacity << " indices" << std::endl;
+    createVertexArray();
+}
+
+}
@@ -0,0 +1,227 @@
+#include "headless.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#ifdef COMMON_HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace Common {
+
+namespace {
+
+double millisecondsBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+#ifdef COMMON_HEADLESS_EGL
+void* eglProcAddress(const char* name) {
+    return reinterpret_cast<void*>(eglGetProcAddress(name));
+}
+#endif
+
+} // namespace
+
+HeadlessOptions parseHeadlessOptions(int argc, char** argv) {
+    HeadlessOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(argv[i], "--headless") == 0) {
+            options.enabled = true;
+        } else if (std::strcmp(argv[i], "--headless-size") == 0 && value) {
+            if (std::sscanf(value, "%dx%d", &options.width, &options.height) != 2 || options.width <= 0 || options.height <= 0) {
+                std::cout << "ERROR::HEADLESS: --headless-size expects WIDTHxHEIGHT, got " << value << std::endl;
+                options.width = 1280;
+                options.height = 720;
+            }
+            i++;
+        } else if (std::strcmp(argv[i], "--headless-frames") == 0 && value) {
+            options.frames = std::max(std::atoi(value), 1);
+            i++;
+        } else if (std::strcmp(argv[i], "--headless-dt") == 0 && value) {
+            float timestep = static_cast<float>(std::atof(value));
+            if (timestep > 0.0f)
+                options.timestep = timestep;
+            i++;
+        } else if (std::strcmp(argv[i], "--headless-out") == 0 && value) {
+            options.outputDirectory = value;
+            i++;
+        } else if (std::strcmp(argv[i], "--headless-dump-every") == 0 && value) {
+            options.dumpEvery = std::max(std::atoi(value), 0);
+            i++;
+        }
+    }
+    return options;
+}
+
+HeadlessContext::~HeadlessContext() {
+#ifdef COMMON_HEADLESS_EGL
+    if (!context)
+        return;
+    glDeleteFramebuffers(1, &fbo);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    glDeleteRenderbuffers(1, &depthBuffer);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+#endif
+}
+
+bool HeadlessContext::create(int width, int height) {
+#ifdef COMMON_HEADLESS_EGL
+    // Surfaceless Mesa needs no display server; fall back to the default display elsewhere
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        std::cout << "ERROR::HEADLESS: no EGL display" << std::endl;
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_API);
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cout << "ERROR::HEADLESS: no EGL config with desktop GL" << std::endl;
+        eglTerminate(eglDisplay);
+        return false;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    // No surface at all: everything is drawn into the FBO below (EGL_KHR_surfaceless_context)
+    if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        std::cout << "ERROR::HEADLESS: could not create a surfaceless GL 3.3 core context" << std::endl;
+        if (eglContext != EGL_NO_CONTEXT)
+            eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+        return false;
+    }
+    display = eglDisplay;
+    context = eglContext;
+    std::cout << "Headless EGL " << major << "." << minor << " context" << std::endl;
+
+    if (!gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglProcAddress))) {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return false;
+    }
+    std::cout << "OpenGL Renderer: " << glGetString(GL_RENDERER) << std::endl;
+
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cout << "ERROR::HEADLESS: framebuffer is not complete" << std::endl;
+        return false;
+    }
+    glViewport(0, 0, width, height);
+    return true;
+#else
+    (void)width;
+    (void)height;
+    std::cout << "ERROR::HEADLESS: built without EGL, --headless is unavailable" << std::endl;
+    return false;
+#endif
+}
+
+HeadlessRun::HeadlessRun(const HeadlessOptions& options) : options(options) {
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDirectory, error);
+    std::string csvPath = options.outputDirectory + "/timings.csv";
+    csv.open(csvPath);
+    if (!csv)
+        std::cout << "ERROR::HEADLESS: cannot write " << csvPath << std::endl;
+    csv << "frame,time,simulate_ms,render_ms,frame_ms\n";
+    frameMilliseconds.reserve(options.frames);
+    std::cout << "Headless run: " << options.frames << " frames at " << options.width << "x" << options.height
+              << ", dt " << options.timestep << " s, output in " << options.outputDirectory << std::endl;
+}
+
+HeadlessRun::~HeadlessRun() {
+    if (frameMilliseconds.empty())
+        return;
+    std::vector<double> sorted = frameMilliseconds;
+    std::sort(sorted.begin(), sorted.end());
+    double total = 0.0;
+    for (double milliseconds : sorted)
+        total += milliseconds;
+    std::cout << "Headless run: " << sorted.size() << " frames, mean " << total / sorted.size() << " ms, median "
+              << sorted[sorted.size() / 2] << " ms, p95 " << sorted[sorted.size() * 95 / 100] << " ms, max "
+              << sorted.back() << " ms" << std::endl;
+}
+
+void HeadlessRun::beginFrame() {
+    frameStart = Clock::now();
+}
+
+void HeadlessRun::simulationDone() {
+    submitStart = Clock::now();
+    simulateMilliseconds = millisecondsBetween(frameStart, submitStart);
+}
+
+void HeadlessRun::present() {
+    glFinish();
+    if (options.dumpEvery > 0 && frame % options.dumpEvery == 0) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%05d.ppm", frame);
+        dumpImage(options.outputDirectory + name);
+    }
+}
+
+void HeadlessRun::endFrame() {
+    Clock::time_point end = Clock::now();
+    double renderMilliseconds = millisecondsBetween(submitStart, end);
+    double totalMilliseconds = millisecondsBetween(frameStart, end);
+    csv << frame << "," << time() << "," << simulateMilliseconds << "," << renderMilliseconds << "," << totalMilliseconds << "\n";
+    frameMilliseconds.push_back(totalMilliseconds);
+    frame++;
+}
+
+void HeadlessRun::dumpImage(const std::string& path) {
+    pixels.resize(static_cast<size_t>(options.width) * options.height * 3);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, options.width, options.height, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+
+    std::ofstream image(path, std::ios::binary);
+    if (!image) {
+        std::cout << "ERROR::HEADLESS: cannot write " << path << std::endl;
+        return;
+    }
+    image << "P6\n" << options.width << " " << options.height << "\n255\n";
+    // GL rows start at the bottom, PPM rows at the top
+    size_t rowBytes = static_cast<size_t>(options.width) * 3;
+    for (int row = options.height - 1; row >= 0; row--)
+        image.write(reinterpret_cast<const char*>(pixels.data() + row * rowBytes), rowBytes);
+}
+
+}
@@ -0,0 +1,122 @@
+#include "instance_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Common {
+
+InstanceBuffer::InstanceBuffer(const VertexFormat& format, GLuint vertexArray, size_t capacity)
+    : format(format), vertexArray(vertexArray), capacity(std::max<size_t>(capacity, 1)) {
+    glGenBuffers(1, &instanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, this->capacity * format.stride, nullptr, GL_DYNAMIC_DRAW);
+
+    // The attributes capture the buffer bound now; it is only ever re-specified, never replaced
+    glBindVertexArray(vertexArray);
+    for (const auto& attribute : format.attributes) {
+        glEnableVertexAttribArray(attribute.index);
+        if (attribute.integer)
+            glVertexAttribIPointer(attribute.index, attribute.components, attribute.type,
+                                   static_cast<GLsizei>(format.stride), (void*)attribute.offset);
+        else
+            glVertexAttribPointer(attribute.index, attribute.components, attribute.type, attribute.normalized,
+                                  static_cast<GLsizei>(format.stride), (void*)attribute.offset);
+        glVertexAttribDivisor(attribute.index, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+InstanceBuffer::~InstanceBuffer() {
+    glDeleteBuffers(1, &instanceBuffer);
+}
+
+size_t InstanceBuffer::add(const void* instance) {
+    size_t handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = slotOfHandle.size();
+        slotOfHandle.push_back(InvalidHandle);
+    }
+
+    size_t slot = handleOfSlot.size();
+    handleOfSlot.push_back(handle);
+    slotOfHandle[handle] = slot;
+    instances.resize(handleOfSlot.size() * format.stride);
+    std::memcpy(instances.data() + slot * format.stride, instance, format.stride);
+
+    if (handleOfSlot.size() > capacity) {
+        capacity = std::max(capacity * 2, handleOfSlot.size());
+        reallocate = true;
+    }
+    markDirty(slot);
+    return handle;
+}
+
+void InstanceBuffer::update(size_t handle, const void* instance) {
+    if (!contains(handle))
+        return;
+    size_t slot = slotOfHandle[handle];
+    std::memcpy(instances.data() + slot * format.stride, instance, format.stride);
+    markDirty(slot);
+}
+
+void InstanceBuffer::remove(size_t handle) {
+    if (!contains(handle))
+        return;
+
+    size_t slot = slotOfHandle[handle];
+    size_t last = handleOfSlot.size() - 1;
+    if (slot != last) {
+        // Fill the hole with the last instance so the live range stays contiguous
+        std::memcpy(instances.data() + slot * format.stride, instances.data() + last * format.stride, format.stride);
+        size_t movedHandle = handleOfSlot[last];
+        handleOfSlot[slot] = movedHandle;
+        slotOfHandle[movedHandle] = slot;
+        markDirty(slot);
+    }
+    handleOfSlot.pop_back();
+    instances.resize(handleOfSlot.size() * format.stride);
+    slotOfHandle[handle] = InvalidHandle;
+    freeHandles.push_back(handle);
+
+    // The dropped tail slot is no longer drawn, so it never needs uploading
+    dirtyEnd = std::min(dirtyEnd, handleOfSlot.size());
+    if (dirtyBegin >= dirtyEnd)
+        dirtyBegin = dirtyEnd = 0;
+}
+
+bool InstanceBuffer::contains(size_t handle) const {
+    return handle < slotOfHandle.size() && slotOfHandle[handle] != InvalidHandle;
+}
+
+void InstanceBuffer::sync() {
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    if (reallocate) {
+        // Same buffer name, new storage: the VAO's attribute pointers stay valid
+        glBufferData(GL_ARRAY_BUFFER, capacity * format.stride, nullptr, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size(), instances.data());
+        std::cout << "InstanceBuffer: grown to " << capacity << " instances" << std::endl;
+        reallocate = false;
+    } else if (dirtyEnd > dirtyBegin) {
+        glBufferSubData(GL_ARRAY_BUFFER, dirtyBegin * format.stride, (dirtyEnd - dirtyBegin) * format.stride,
+                        instances.data() + dirtyBegin * format.stride);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    dirtyBegin = dirtyEnd = 0;
+}
+
+void InstanceBuffer::markDirty(size_t slot) {
+    if (dirtyBegin >= dirtyEnd) {
+        dirtyBegin = slot;
+        dirtyEnd = slot + 1;
+        return;
+    }
+    dirtyBegin = std::min(dirtyBegin, slot);
+    dirtyEnd = std::max(dirtyEnd, slot + 1);
+}
+
+}
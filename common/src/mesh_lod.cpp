@@ -0,0 +1,396 @@
+#include "mesh_lod.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace Common {
+
+namespace {
+
+struct Vec3 {
+    float x, y, z;
+};
+
+Vec3 sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+Vec3 cross(const Vec3& a, const Vec3& b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+// Symmetric 4x4 plane quadric (upper triangle) plus the total weight of the planes it holds
+struct Quadric {
+    float a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    float a11 = 0, a12 = 0, a13 = 0;
+    float a22 = 0, a23 = 0;
+    float a33 = 0;
+    float weight = 0;
+};
+
+void addPlane(Quadric& q, const Vec3& n, float d, float weight) {
+    q.a00 += n.x * n.x * weight; q.a01 += n.x * n.y * weight; q.a02 += n.x * n.z * weight; q.a03 += n.x * d * weight;
+    q.a11 += n.y * n.y * weight; q.a12 += n.y * n.z * weight; q.a13 += n.y * d * weight;
+    q.a22 += n.z * n.z * weight; q.a23 += n.z * d * weight;
+    q.a33 += d * d * weight;
+    q.weight += weight;
+}
+
+void addQuadric(Quadric& q, const Quadric& r) {
+    q.a00 += r.a00; q.a01 += r.a01; q.a02 += r.a02; q.a03 += r.a03;
+    q.a11 += r.a11; q.a12 += r.a12; q.a13 += r.a13;
+    q.a22 += r.a22; q.a23 += r.a23;
+    q.a33 += r.a33;
+    q.weight += r.weight;
+}
+
+// Weighted mean squared distance from v to the quadric's planes
+float quadricError(const Quadric& q, const Vec3& v) {
+    float r = q.a00 * v.x * v.x + 2.0f * q.a01 * v.x * v.y + 2.0f * q.a02 * v.x * v.z + 2.0f * q.a03 * v.x
+            + q.a11 * v.y * v.y + 2.0f * q.a12 * v.y * v.z + 2.0f * q.a13 * v.y
+            + q.a22 * v.z * v.z + 2.0f * q.a23 * v.z
+            + q.a33;
+    return q.weight > 0.0f ? std::fabs(r) / q.weight : 0.0f;
+}
+
+uint64_t edgeKey(unsigned int a, unsigned int b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+struct PositionKey {
+    uint32_t x, y, z;
+    bool operator==(const PositionKey& other) const { return x == other.x && y == other.y && z == other.z; }
+};
+
+struct PositionKeyHash {
+    size_t operator()(const PositionKey& key) const {
+        return (key.x * 73856093u) ^ (key.y * 19349663u) ^ (key.z * 83492791u);
+    }
+};
+
+const float* positionAt(const float* positions, size_t stride, size_t index) {
+    return reinterpret_cast<const float*>(reinterpret_cast<const unsigned char*>(positions) + index * stride);
+}
+
+} // namespace
+
+float simplifyScale(const float* positions, size_t vertexCount, size_t stride) {
+    if (vertexCount == 0)
+        return 0.0f;
+
+    float minPos[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+    float maxPos[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* p = positionAt(positions, stride, i);
+        for (int k = 0; k < 3; k++) {
+            minPos[k] = std::min(minPos[k], p[k]);
+            maxPos[k] = std::max(maxPos[k], p[k]);
+        }
+    }
+    return std::max(maxPos[0] - minPos[0], std::max(maxPos[1] - minPos[1], maxPos[2] - minPos[2]));
+}
+
+size_t simplifyMesh(std::vector<unsigned int>& destination, const std::vector<unsigned int>& indices,
+                    const float* positions, size_t vertexCount, size_t stride,
+                    size_t targetIndexCount, float targetError,
+                    const std::vector<unsigned int>* collapseGroups, float* resultError) {
+    destination.assign(indices.begin(), indices.end());
+    if (resultError)
+        *resultError = 0.0f;
+    if (indices.size() <= targetIndexCount || vertexCount == 0)
+        return destination.size();
+
+    // Work on positions normalized to the unit cube so errors are independent of model size
+    const float scale = simplifyScale(positions, vertexCount, stride);
+    const float invScale = scale > 0.0f ? 1.0f / scale : 0.0f;
+    const float* origin = positionAt(positions, stride, 0);
+    float minPos[3] = { origin[0], origin[1], origin[2] };
+    for (size_t i = 1; i < vertexCount; i++) {
+        const float* p = positionAt(positions, stride, i);
+        for (int k = 0; k < 3; k++)
+            minPos[k] = std::min(minPos[k], p[k]);
+    }
+
+    std::vector<Vec3> pos(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) {
+        const float* p = positionAt(positions, stride, i);
+        pos[i] = { (p[0] - minPos[0]) * invScale, (p[1] - minPos[1]) * invScale, (p[2] - minPos[2]) * invScale };
+    }
+
+    // Vertices that share a position (UV or normal seams) form a ring of wedges around a root vertex
+    std::vector<unsigned int> root(vertexCount);
+    std::vector<unsigned int> wedgeNext(vertexCount);
+    {
+        std::unordered_map<PositionKey, unsigned int, PositionKeyHash> positionLookup;
+        positionLookup.reserve(vertexCount);
+        for (size_t i = 0; i < vertexCount; i++) {
+            const float* p = positionAt(positions, stride, i);
+            PositionKey key;
+            std::memcpy(&key.x, &p[0], sizeof(float));
+            std::memcpy(&key.y, &p[1], sizeof(float));
+            std::memcpy(&key.z, &p[2], sizeof(float));
+
+            auto inserted = positionLookup.try_emplace(key, static_cast<unsigned int>(i));
+            unsigned int r = inserted.first->second;
+            root[i] = r;
+            if (inserted.second) {
+                wedgeNext[i] = static_cast<unsigned int>(i);
+            } else {
+                wedgeNext[i] = wedgeNext[r];
+                wedgeNext[r] = static_cast<unsigned int>(i);
+            }
+        }
+    }
+
+    // Area weighted plane quadrics, accumulated per position
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int r0 = root[indices[i + 0]], r1 = root[indices[i + 1]], r2 = root[indices[i + 2]];
+        Vec3 normal = cross(sub(pos[r1], pos[r0]), sub(pos[r2], pos[r0]));
+        float length = std::sqrt(dot(normal, normal));
+        if (length <= 0.0f)
+            continue;
+
+        normal = { normal.x / length, normal.y / length, normal.z / length };
+        float d = -dot(normal, pos[r0]);
+        float area = length * 0.5f;
+        addPlane(quadrics[r0], normal, d, area);
+        addPlane(quadrics[r1], normal, d, area);
+        addPlane(quadrics[r2], normal, d, area);
+    }
+
+    // Positions on an open border are locked so silhouettes and holes keep their outline
+    std::vector<bool> locked(vertexCount, false);
+    {
+        std::unordered_set<uint64_t> halfEdges;
+        halfEdges.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (int e = 0; e < 3; e++)
+                halfEdges.insert(edgeKey(root[indices[i + e]], root[indices[i + (e + 1) % 3]]));
+        }
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                unsigned int a = root[indices[i + e]], b = root[indices[i + (e + 1) % 3]];
+                if (halfEdges.find(edgeKey(b, a)) == halfEdges.end())
+                    locked[a] = locked[b] = true;
+            }
+        }
+    }
+
+    struct Collapse {
+        unsigned int source;
+        unsigned int target;
+        float error;
+    };
+
+    const float errorLimit = targetError * targetError;
+    float maxError = 0.0f;
+
+    std::vector<unsigned int> remap(vertexCount);
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<bool> passLocked(vertexCount);
+    std::vector<bool> referenced(vertexCount);
+    std::vector<Collapse> candidates;
+    std::vector<std::pair<unsigned int, unsigned int>> wedgePairs;
+    std::unordered_set<uint64_t> attributeEdges;
+
+    while (destination.size() > targetIndexCount) {
+        const size_t faceCount = destination.size() / 3;
+
+        // Position -> triangle adjacency and the attribute level edges of the current mesh
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        std::fill(referenced.begin(), referenced.end(), false);
+        attributeEdges.clear();
+        for (size_t i = 0; i < destination.size(); i++) {
+            adjacencyOffsets[root[destination[i]] + 1]++;
+            referenced[destination[i]] = true;
+
+            size_t next = i - i % 3 + (i + 1) % 3;
+            attributeEdges.insert(edgeKey(destination[i], destination[next]));
+            attributeEdges.insert(edgeKey(destination[next], destination[i]));
+        }
+        for (size_t i = 0; i < vertexCount; i++)
+            adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+        adjacency.resize(destination.size());
+        {
+            std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < destination.size(); i++)
+                adjacency[fill[root[destination[i]]]++] = static_cast<unsigned int>(i / 3);
+        }
+
+        candidates.clear();
+        for (size_t face = 0; face < faceCount; face++) {
+            for (int e = 0; e < 3; e++) {
+                unsigned int a = destination[face * 3 + e];
+                unsigned int b = destination[face * 3 + (e + 1) % 3];
+                const unsigned int ends[2][2] = { { a, b }, { b, a } };
+                for (const auto& end : ends) {
+                    unsigned int rs = root[end[0]], rt = root[end[1]];
+                    if (rs == rt || locked[rs])
+                        continue;
+                    float error = quadricError(quadrics[rs], pos[rt]);
+                    if (error <= errorLimit)
+                        candidates.push_back({ end[0], end[1], error });
+                }
+            }
+        }
+        if (candidates.empty())
+            break;
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Collapse& lhs, const Collapse& rhs) {
+            return lhs.error < rhs.error;
+        });
+
+        // Each collapse removes roughly two triangles; don't overshoot the target by much in one pass
+        const size_t goal = (destination.size() - targetIndexCount) / 6 + 1;
+        size_t collapses = 0;
+        std::fill(passLocked.begin(), passLocked.end(), false);
+        for (size_t i = 0; i < vertexCount; i++)
+            remap[i] = static_cast<unsigned int>(i);
+
+        for (const Collapse& collapse : candidates) {
+            if (collapses >= goal)
+                break;
+
+            unsigned int rs = root[collapse.source], rt = root[collapse.target];
+            if (passLocked[rs] || passLocked[rt])
+                continue;
+
+            // Every live wedge at the source position must slide along an edge to a wedge at the target,
+            // otherwise the collapse would tear a UV/normal seam open
+            bool matched = true;
+            wedgePairs.clear();
+            unsigned int w = rs;
+            do {
+                if (referenced[w]) {
+                    unsigned int partner = ~0u;
+                    if (w == collapse.source) {
+                        partner = collapse.target;
+                    } else {
+                        unsigned int t = rt;
+                        do {
+                            if (referenced[t] && attributeEdges.count(edgeKey(w, t))) {
+                                partner = t;
+                                break;
+                            }
+                            t = wedgeNext[t];
+                        } while (t != rt);
+                    }
+
+                    if (partner == ~0u || (collapseGroups && (*collapseGroups)[w] != (*collapseGroups)[partner])) {
+                        matched = false;
+                        break;
+                    }
+                    wedgePairs.emplace_back(w, partner);
+                }
+                w = wedgeNext[w];
+            } while (w != rs);
+            if (!matched)
+                continue;
+
+            // Reject collapses that would fold a surviving triangle over
+            bool flips = false;
+            for (unsigned int a = adjacencyOffsets[rs]; a < adjacencyOffsets[rs + 1] && !flips; a++) {
+                const unsigned int face = adjacency[a];
+                unsigned int r[3] = { root[destination[face * 3 + 0]], root[destination[face * 3 + 1]], root[destination[face * 3 + 2]] };
+                if (r[0] == rt || r[1] == rt || r[2] == rt)
+                    continue;
+
+                Vec3 before = cross(sub(pos[r[1]], pos[r[0]]), sub(pos[r[2]], pos[r[0]]));
+                for (auto& corner : r) {
+                    if (corner == rs)
+                        corner = rt;
+                }
+                Vec3 after = cross(sub(pos[r[1]], pos[r[0]]), sub(pos[r[2]], pos[r[0]]));
+                flips = dot(before, after) <= 0.0f;
+            }
+            if (flips)
+                continue;
+
+            for (const auto& pair : wedgePairs)
+                remap[pair.first] = pair.second;
+            addQuadric(quadrics[rt], quadrics[rs]);
+            maxError = std::max(maxError, collapse.error);
+            collapses++;
+
+            // Freeze the whole one-ring so every triangle moves at most one corner per pass
+            for (unsigned int a = adjacencyOffsets[rs]; a < adjacencyOffsets[rs + 1]; a++) {
+                const unsigned int face = adjacency[a];
+                for (int k = 0; k < 3; k++)
+                    passLocked[root[destination[face * 3 + k]]] = true;
+            }
+        }
+
+        if (collapses == 0)
+            break;
+
+        size_t write = 0;
+        for (size_t face = 0; face < faceCount; face++) {
+            unsigned int a = remap[destination[face * 3 + 0]];
+            unsigned int b = remap[destination[face * 3 + 1]];
+            unsigned int c = remap[destination[face * 3 + 2]];
+            if (root[a] == root[b] || root[b] == root[c] || root[c] == root[a])
+                continue;
+            destination[write++] = a;
+            destination[write++] = b;
+            destination[write++] = c;
+        }
+        destination.resize(write);
+    }
+
+    if (resultError)
+        *resultError = std::sqrt(maxError);
+    return destination.size();
+}
+
+void logMeshLods(const std::string& label, const std::vector<MeshLod>& lods) {
+    std::cout << label << ": " << lods.size() << " LODs";
+    for (size_t i = 0; i < lods.size(); i++)
+        std::cout << (i == 0 ? " [" : ", ") << lods[i].indexCount / 3 << " tris @ " << lods[i].error;
+    std::cout << (lods.empty() ? "" : "]") << std::endl;
+}
+
+float lodPixelsPerUnit(float distance, float fovYRadians, float viewportHeight) {
+    // Inside the bounds every LOD error is effectively infinite on screen, so always pick LOD 0
+    if (distance <= 1e-4f)
+        return FLT_MAX;
+    return viewportHeight / (2.0f * distance * std::tan(fovYRadians * 0.5f));
+}
+
+int selectLod(const std::vector<MeshLod>& lods, int currentLod, float pixelsPerUnit, const LodSettings& settings) {
+    if (lods.empty())
+        return 0;
+
+    const int lastLod = static_cast<int>(lods.size()) - 1;
+    currentLod = std::min(std::max(currentLod, 0), lastLod);
+
+    // Errors grow monotonically along the chain, so the last level under the threshold is the coarsest usable one
+    int desired = 0;
+    for (int i = 1; i <= lastLod; i++) {
+        if (lods[i].error * pixelsPerUnit <= settings.thresholdPixels)
+            desired = i;
+    }
+
+    if (desired > currentLod) {
+        const float coarsenThreshold = settings.thresholdPixels * (1.0f - settings.hysteresis);
+        int coarser = currentLod;
+        for (int i = currentLod + 1; i <= desired; i++) {
+            if (lods[i].error * pixelsPerUnit <= coarsenThreshold)
+                coarser = i;
+        }
+        return coarser;
+    }
+
+    if (desired < currentLod) {
+        const float refineThreshold = settings.thresholdPixels * (1.0f + settings.hysteresis);
+        if (lods[currentLod].error * pixelsPerUnit > refineThreshold)
+            return desired;
+    }
+
+    return currentLod;
+}
+
+} // namespace Common
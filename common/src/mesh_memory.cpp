@@ -0,0 +1,21 @@
+#include "mesh_memory.hpp"
+
+#include <iostream>
+
+namespace Common {
+
+const char* cpuRetentionName(CpuRetention retention) {
+    switch (retention) {
+        case CpuRetention::KeepAll: return "keep all";
+        case CpuRetention::PositionsOnly: return "positions only";
+        case CpuRetention::None: return "none";
+    }
+    return "unknown";
+}
+
+void logMeshMemory(const std::string& label, CpuRetention retention, const MeshMemoryStats& stats) {
+    std::cout << label << ": " << stats.meshCount << " meshes, CPU " << stats.cpuBytes / 1024.0f << " KiB ("
+              << cpuRetentionName(retention) << "), GPU " << stats.gpuBytes / 1024.0f << " KiB" << std::endl;
+}
+
+}
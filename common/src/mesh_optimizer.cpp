@@ -0,0 +1,340 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace Common {
+
+namespace {
+
+// Cache size assumed by the reordering heuristic; larger than real FIFOs so scores stay smooth
+const unsigned int kScoreCacheSize = 32;
+const unsigned int kStatsCacheSize = 16;
+
+// Vertex score from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+float vertexScore(int cachePosition, unsigned int liveTriangles) {
+    if (liveTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            // The most recent triangle's vertices get a fixed score so its neighbours aren't preferred too strongly
+            score = 0.75f;
+        } else {
+            const float scaler = 1.0f / (kScoreCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scaler, 1.5f);
+        }
+    }
+
+    // Boost vertices with few triangles left so they get finished off and leave the cache for good
+    score += 2.0f * std::pow(static_cast<float>(liveTriangles), -0.5f);
+    return score;
+}
+
+// Cache misses caused by each triangle with a FIFO of the given size, starting from an empty cache
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, unsigned int size) : timestamps(vertexCount, 0), cacheSize(size), time(size + 1) {}
+
+    void reset() {
+        // Move time forward so every vertex looks stale instead of clearing the whole table
+        time += cacheSize + 1;
+    }
+
+    unsigned int access(unsigned int vertex) {
+        if (time - timestamps[vertex] > cacheSize) {
+            timestamps[vertex] = time++;
+            return 1;
+        }
+        return 0;
+    }
+
+private:
+    std::vector<unsigned int> timestamps;
+    unsigned int cacheSize;
+    unsigned int time;
+};
+
+} // namespace
+
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+    VertexCacheStats stats;
+    stats.triangleCount = static_cast<unsigned int>(indices.size() / 3);
+    if (indices.empty() || vertexCount == 0)
+        return stats;
+
+    std::vector<unsigned int> cache;
+    cache.reserve(cacheSize);
+    std::vector<bool> referenced(vertexCount, false);
+
+    for (unsigned int index : indices) {
+        if (!referenced[index]) {
+            referenced[index] = true;
+            stats.vertexCount++;
+        }
+
+        if (std::find(cache.begin(), cache.end(), index) == cache.end()) {
+            stats.verticesTransformed++;
+            if (cache.size() == cacheSize)
+                cache.erase(cache.begin());
+            cache.push_back(index);
+        }
+    }
+
+    stats.acmr = static_cast<float>(stats.verticesTransformed) / static_cast<float>(stats.triangleCount);
+    stats.atvr = static_cast<float>(stats.verticesTransformed) / static_cast<float>(stats.vertexCount);
+    return stats;
+}
+
+void optimizeVertexCache(std::vector<unsigned int>& indices, size_t vertexCount) {
+    const size_t faceCount = indices.size() / 3;
+    if (faceCount == 0 || vertexCount == 0)
+        return;
+
+    // Vertex -> triangle adjacency, stored as one flat array with per-vertex offsets
+    std::vector<unsigned int> liveTriangles(vertexCount, 0);
+    for (unsigned int index : indices)
+        liveTriangles[index]++;
+
+    std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+    for (size_t i = 0; i < vertexCount; i++)
+        adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+
+    std::vector<unsigned int> adjacency(indices.size());
+    std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+        adjacency[fill[indices[i]]++] = static_cast<unsigned int>(i / 3);
+
+    std::vector<float> scores(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++)
+        scores[i] = vertexScore(-1, liveTriangles[i]);
+
+    std::vector<float> triangleScores(faceCount);
+    for (size_t i = 0; i < faceCount; i++)
+        triangleScores[i] = scores[indices[i * 3 + 0]] + scores[indices[i * 3 + 1]] + scores[indices[i * 3 + 2]];
+
+    std::vector<bool> emitted(faceCount, false);
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+
+    unsigned int cache[kScoreCacheSize + 3];
+    unsigned int cacheNew[kScoreCacheSize + 3];
+    unsigned int cacheCount = 0;
+
+    size_t inputCursor = 0;
+    size_t current = 0;
+
+    while (true) {
+        emitted[current] = true;
+        triangleScores[current] = 0.0f;
+
+        const unsigned int a = indices[current * 3 + 0];
+        const unsigned int b = indices[current * 3 + 1];
+        const unsigned int c = indices[current * 3 + 2];
+        result.push_back(a);
+        result.push_back(b);
+        result.push_back(c);
+
+        // Push the triangle's vertices to the front of the cache, keeping the rest in order
+        unsigned int cacheWrite = 0;
+        cacheNew[cacheWrite++] = a;
+        cacheNew[cacheWrite++] = b;
+        cacheNew[cacheWrite++] = c;
+        for (unsigned int i = 0; i < cacheCount; i++) {
+            unsigned int index = cache[i];
+            if (index != a && index != b && index != c)
+                cacheNew[cacheWrite++] = index;
+        }
+        std::memcpy(cache, cacheNew, cacheWrite * sizeof(unsigned int));
+        cacheCount = std::min(cacheWrite, kScoreCacheSize);
+
+        // Remove the emitted triangle from its vertices' adjacency lists
+        const unsigned int corners[3] = { a, b, c };
+        for (unsigned int vertex : corners) {
+            unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+            unsigned int* end = begin + liveTriangles[vertex];
+            unsigned int* found = std::find(begin, end, static_cast<unsigned int>(current));
+            if (found != end) {
+                *found = *(end - 1);
+                liveTriangles[vertex]--;
+            }
+        }
+
+        // Rescore everything that was in the cache, including the vertices that just fell out
+        size_t best = faceCount;
+        float bestScore = 0.0f;
+        for (unsigned int i = 0; i < cacheWrite; i++) {
+            unsigned int vertex = cache[i];
+            int position = i < kScoreCacheSize ? static_cast<int>(i) : -1;
+
+            float score = vertexScore(position, liveTriangles[vertex]);
+            float delta = score - scores[vertex];
+            scores[vertex] = score;
+
+            const unsigned int* triangles = &adjacency[adjacencyOffsets[vertex]];
+            for (unsigned int t = 0; t < liveTriangles[vertex]; t++) {
+                unsigned int triangle = triangles[t];
+                triangleScores[triangle] += delta;
+                if (triangleScores[triangle] > bestScore) {
+                    bestScore = triangleScores[triangle];
+                    best = triangle;
+                }
+            }
+        }
+
+        if (best == faceCount) {
+            // Nothing adjacent to the cache is left; restart from the next unemitted triangle in input order
+            while (inputCursor < faceCount && emitted[inputCursor])
+                inputCursor++;
+            if (inputCursor == faceCount)
+                break;
+            best = inputCursor;
+        }
+
+        current = best;
+    }
+
+    indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<unsigned int>& indices, const float* positions, size_t vertexCount, size_t stride, float threshold) {
+    const size_t faceCount = indices.size() / 3;
+    if (faceCount == 0 || vertexCount == 0 || positions == nullptr)
+        return;
+
+    const unsigned char* positionBytes = reinterpret_cast<const unsigned char*>(positions);
+    auto position = [&](unsigned int index) {
+        return reinterpret_cast<const float*>(positionBytes + index * stride);
+    };
+
+    FifoCache cache(vertexCount, kStatsCacheSize);
+    auto triangleMisses = [&](size_t face) {
+        return cache.access(indices[face * 3 + 0]) + cache.access(indices[face * 3 + 1]) + cache.access(indices[face * 3 + 2]);
+    };
+
+    // Hard boundaries: triangles where the cache optimizer restarted (all three vertices miss)
+    std::vector<size_t> hardClusters;
+    for (size_t face = 0; face < faceCount; face++) {
+        if (triangleMisses(face) == 3)
+            hardClusters.push_back(face);
+    }
+    if (hardClusters.empty() || hardClusters[0] != 0)
+        hardClusters.insert(hardClusters.begin(), 0);
+
+    // Soft boundaries: split a hard cluster wherever the running ACMR is already within threshold
+    std::vector<size_t> clusters;
+    for (size_t h = 0; h < hardClusters.size(); h++) {
+        const size_t start = hardClusters[h];
+        const size_t end = h + 1 < hardClusters.size() ? hardClusters[h + 1] : faceCount;
+
+        cache.reset();
+        unsigned int clusterMisses = 0;
+        for (size_t face = start; face < end; face++)
+            clusterMisses += triangleMisses(face);
+        const float clusterThreshold = threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+        clusters.push_back(start);
+        cache.reset();
+        unsigned int runningMisses = 0;
+        unsigned int runningFaces = 0;
+        for (size_t face = start; face < end; face++) {
+            runningMisses += triangleMisses(face);
+            runningFaces++;
+            if (face + 1 < end && static_cast<float>(runningMisses) / runningFaces <= clusterThreshold) {
+                clusters.push_back(face + 1);
+                cache.reset();
+                runningMisses = 0;
+                runningFaces = 0;
+            }
+        }
+    }
+
+    // Area weighted mesh centroid, used as the reference point for "outward facing"
+    float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    std::vector<float> clusterKeys(clusters.size());
+    std::vector<float> clusterData(clusters.size() * 7, 0.0f); // centroid xyz, normal xyz, area
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : faceCount;
+        float* data = &clusterData[c * 7];
+
+        for (size_t face = start; face < end; face++) {
+            const float* p0 = position(indices[face * 3 + 0]);
+            const float* p1 = position(indices[face * 3 + 1]);
+            const float* p2 = position(indices[face * 3 + 2]);
+
+            const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+            const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; k++) {
+                float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+                data[k] += center * area;
+                data[3 + k] += n[k];
+                meshCentroid[k] += center * area;
+            }
+            data[6] += area;
+            meshArea += area;
+        }
+    }
+
+    if (meshArea > 0.0f) {
+        for (int k = 0; k < 3; k++)
+            meshCentroid[k] /= meshArea;
+    }
+
+    for (size_t c = 0; c < clusters.size(); c++) {
+        const float* data = &clusterData[c * 7];
+        const float invArea = data[6] > 0.0f ? 1.0f / data[6] : 0.0f;
+        const float normalLength = std::sqrt(data[3] * data[3] + data[4] * data[4] + data[5] * data[5]);
+        const float invNormal = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+
+        float key = 0.0f;
+        for (int k = 0; k < 3; k++)
+            key += (data[k] * invArea - meshCentroid[k]) * data[3 + k] * invNormal;
+        clusterKeys[c] = key;
+    }
+
+    // Draw the clusters that face away from the centre first; they occlude the ones behind them
+    std::vector<size_t> order(clusters.size());
+    for (size_t c = 0; c < order.size(); c++)
+        order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return clusterKeys[lhs] > clusterKeys[rhs];
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        const size_t start = clusters[c];
+        const size_t end = c + 1 < clusters.size() ? clusters[c + 1] : faceCount;
+        result.insert(result.end(), indices.begin() + start * 3, indices.begin() + end * 3);
+    }
+
+    indices.swap(result);
+}
+
+void logMeshOptimization(const std::string& label, const MeshOptimizationStats& stats) {
+    std::cout << label << ": ACMR " << stats.before.acmr << " -> " << stats.after.acmr
+              << ", ATVR " << stats.before.atvr << " -> " << stats.after.atvr
+              << " (" << stats.after.triangleCount << " triangles, " << stats.after.vertexCount << " vertices)" << std::endl;
+}
+
+size_t buildVertexFetchRemap(std::vector<unsigned int>& remap, const std::vector<unsigned int>& indices, size_t vertexCount) {
+    remap.assign(vertexCount, ~0u);
+
+    unsigned int next = 0;
+    for (unsigned int index : indices) {
+        if (remap[index] == ~0u)
+            remap[index] = next++;
+    }
+    return next;
+}
+
+} // namespace Common
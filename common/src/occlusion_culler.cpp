@@ -0,0 +1,411 @@
+#include "occlusion_culler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define COMMON_OCCLUSION_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace Common {
+
+namespace {
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Point on segment a-b where it crosses the near plane z = -w
+glm::vec4 nearIntersection(const glm::vec4& a, const glm::vec4& b) {
+    float da = a.z + a.w;
+    float db = b.z + b.w;
+    return a + (b - a) * (da / (da - db));
+}
+
+} // namespace
+
+OcclusionCuller::OcclusionCuller(int width, int height, bool threaded)
+    : bufferWidth((std::max(width, 4) + 3) / 4 * 4), bufferHeight(std::max(height, 1)), threadedMode(threaded) {
+    // Rows are a multiple of 4 wide so the rasterizer can always write whole 4-pixel blocks
+    int levelW = bufferWidth;
+    int levelH = bufferHeight;
+    while (true) {
+        levelWidth.push_back(levelW);
+        levelHeight.push_back(levelH);
+        minDepth.emplace_back(levelWidth.size() == 1 ? 0 : static_cast<size_t>(levelW) * levelH, 1.0f);
+        maxDepth.emplace_back(static_cast<size_t>(levelW) * levelH, 1.0f);
+        if (levelW == 1 && levelH == 1)
+            break;
+        levelW = (levelW + 1) / 2;
+        levelH = (levelH + 1) / 2;
+    }
+
+    if (threadedMode)
+        worker = std::thread(&OcclusionCuller::run, this);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+    if (!worker.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+    worker.join();
+}
+
+size_t OcclusionCuller::addOccluder(const std::vector<glm::vec3>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model) {
+    waitUntilReady();
+    Occluder occluder;
+    occluder.vertices = vertices;
+    occluder.indices.assign(indices.begin(), indices.begin() + indices.size() / 3 * 3);
+    occluder.model = model;
+
+    if (!freeOccluders.empty()) {
+        size_t handle = freeOccluders.back();
+        freeOccluders.pop_back();
+        occluders[handle] = std::move(occluder);
+        return handle;
+    }
+    occluders.push_back(std::move(occluder));
+    return occluders.size() - 1;
+}
+
+size_t OcclusionCuller::addBoxOccluder(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& model) {
+    std::vector<glm::vec3> corners(8);
+    for (int i = 0; i < 8; i++) {
+        corners[i] = glm::vec3((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z);
+    }
+    // Winding does not matter, both faces are rasterized
+    static const std::vector<unsigned int> boxIndices = {
+        0, 1, 3, 0, 3, 2,   4, 5, 7, 4, 7, 6,   // -z, +z
+        0, 1, 5, 0, 5, 4,   2, 3, 7, 2, 7, 6,   // -y, +y
+        0, 2, 6, 0, 6, 4,   1, 3, 7, 1, 7, 5    // -x, +x
+    };
+    return addOccluder(corners, boxIndices, model);
+}
+
+void OcclusionCuller::setOccluderTransform(size_t handle, const glm::mat4& model) {
+    waitUntilReady();
+    if (handle < occluders.size())
+        occluders[handle].model = model;
+}
+
+void OcclusionCuller::removeOccluder(size_t handle) {
+    waitUntilReady();
+    if (handle >= occluders.size() || !occluders[handle].active)
+        return;
+    occluders[handle] = Occluder();
+    occluders[handle].active = false;
+    freeOccluders.push_back(handle);
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& viewProjection) {
+    waitUntilReady();
+    frameViewProjection = viewProjection;
+    haveFrame = true;
+    frameSynced = false;
+
+    if (!threadedMode) {
+        rasterizeFrame();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready = false;
+        busy = true;
+    }
+    changed.notify_all();
+}
+
+void OcclusionCuller::finish() {
+    waitUntilReady();
+}
+
+void OcclusionCuller::waitUntilReady() {
+    frameSynced = true;
+    if (!threadedMode)
+        return;
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    if (ready)
+        return;
+    changed.wait(lock, [this] { return ready; });
+    counters.waitMilliseconds += millisecondsSince(start);
+}
+
+void OcclusionCuller::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        changed.wait(lock, [this] { return busy || stopping; });
+        if (!busy)
+            break;
+        lock.unlock();
+
+        rasterizeFrame();
+
+        lock.lock();
+        busy = false;
+        ready = true;
+        changed.notify_all();
+    }
+}
+
+void OcclusionCuller::rasterizeFrame() {
+    auto start = std::chrono::steady_clock::now();
+    std::fill(maxDepth[0].begin(), maxDepth[0].end(), 1.0f);
+
+    unsigned long long triangles = 0;
+    for (const Occluder& occluder : occluders) {
+        if (!occluder.active)
+            continue;
+        glm::mat4 modelViewProjection = frameViewProjection * occluder.model;
+        clipVertices.resize(occluder.vertices.size());
+        for (size_t i = 0; i < occluder.vertices.size(); i++)
+            clipVertices[i] = modelViewProjection * glm::vec4(occluder.vertices[i], 1.0f);
+
+        for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3) {
+            rasterizeTriangle(clipVertices[occluder.indices[i]], clipVertices[occluder.indices[i + 1]], clipVertices[occluder.indices[i + 2]]);
+            triangles++;
+        }
+    }
+    buildHierarchy();
+
+    // The worker holds no lock while rasterizing; counters are shared with stats()
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (threadedMode)
+        lock.lock();
+    counters.frames++;
+    counters.occluderTriangles += triangles;
+    counters.rasterMilliseconds += millisecondsSince(start);
+}
+
+void OcclusionCuller::rasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+    // Entirely outside one side of the frustum
+    if ((a.x > a.w && b.x > b.w && c.x > c.w) || (a.x < -a.w && b.x < -b.w && c.x < -c.w) ||
+        (a.y > a.w && b.y > b.w && c.y > c.w) || (a.y < -a.w && b.y < -b.w && c.y < -c.w) ||
+        (a.z > a.w && b.z > b.w && c.z > c.w))
+        return;
+
+    // Clip against the near plane only; x and y are clamped to the buffer when drawing
+    glm::vec4 input[3] = { a, b, c };
+    glm::vec4 polygon[4];
+    int count = 0;
+    for (int i = 0; i < 3; i++) {
+        const glm::vec4& current = input[i];
+        const glm::vec4& next = input[(i + 1) % 3];
+        bool currentInside = current.z >= -current.w;
+        bool nextInside = next.z >= -next.w;
+        if (currentInside)
+            polygon[count++] = current;
+        if (currentInside != nextInside)
+            polygon[count++] = nearIntersection(current, next);
+    }
+    if (count < 3)
+        return;
+
+    glm::vec3 screen[4];
+    for (int i = 0; i < count; i++) {
+        glm::vec3 ndc = glm::vec3(polygon[i]) / polygon[i].w;
+        screen[i] = glm::vec3((ndc.x * 0.5f + 0.5f) * bufferWidth, (ndc.y * 0.5f + 0.5f) * bufferHeight, ndc.z * 0.5f + 0.5f);
+    }
+    drawTriangle(screen[0], screen[1], screen[2]);
+    if (count == 4)
+        drawTriangle(screen[0], screen[2], screen[3]);
+}
+
+void OcclusionCuller::drawTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+    float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::abs(area) < 1e-8f)
+        return;
+    if (area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    // Clamp before converting: near-clipped vertices can land far outside the buffer
+    int minX = static_cast<int>(std::floor(std::max(std::min({ a.x, b.x, c.x }), 0.0f)));
+    int maxX = static_cast<int>(std::ceil(std::min(std::max({ a.x, b.x, c.x }), bufferWidth - 1.0f)));
+    int minY = static_cast<int>(std::floor(std::max(std::min({ a.y, b.y, c.y }), 0.0f)));
+    int maxY = static_cast<int>(std::ceil(std::min(std::max({ a.y, b.y, c.y }), bufferHeight - 1.0f)));
+    if (minX > maxX || minY > maxY)
+        return;
+
+    // Edge functions E = A*x + B*y + C, all >= 0 inside; depth is linear in screen space
+    const glm::vec3* from[3] = { &b, &c, &a };
+    const glm::vec3* to[3] = { &c, &a, &b };
+    float edgeA[3], edgeB[3], edgeC[3];
+    for (int i = 0; i < 3; i++) {
+        edgeA[i] = -(to[i]->y - from[i]->y);
+        edgeB[i] = to[i]->x - from[i]->x;
+        edgeC[i] = -(edgeA[i] * from[i]->x + edgeB[i] * from[i]->y);
+    }
+    float depthA = (edgeA[0] * a.z + edgeA[1] * b.z + edgeA[2] * c.z) / area;
+    float depthB = (edgeB[0] * a.z + edgeB[1] * b.z + edgeB[2] * c.z) / area;
+    float depthC = (edgeC[0] * a.z + edgeC[1] * b.z + edgeC[2] * c.z) / area;
+
+    // Blocks start 4-aligned; pixels left of minX fail the edge tests, rows are a multiple of 4 wide
+    int startX = minX & ~3;
+    float* depth = maxDepth[0].data();
+
+#ifdef COMMON_OCCLUSION_SSE
+    const __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        __m128 rowE0 = _mm_set1_ps(edgeB[0] * centerY + edgeC[0]);
+        __m128 rowE1 = _mm_set1_ps(edgeB[1] * centerY + edgeC[1]);
+        __m128 rowE2 = _mm_set1_ps(edgeB[2] * centerY + edgeC[2]);
+        __m128 rowZ = _mm_set1_ps(depthB * centerY + depthC);
+        float* row = depth + static_cast<size_t>(y) * bufferWidth;
+        for (int x = startX; x <= maxX; x += 4) {
+            __m128 centerX = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+            __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[0]), centerX), rowE0);
+            __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[1]), centerX), rowE1);
+            __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edgeA[2]), centerX), rowE2);
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if (_mm_movemask_ps(inside) == 0)
+                continue;
+            __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(depthA), centerX), rowZ);
+            __m128 current = _mm_loadu_ps(row + x);
+            __m128 nearer = _mm_min_ps(current, z);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+        }
+    }
+#else
+    for (int y = minY; y <= maxY; y++) {
+        float centerY = y + 0.5f;
+        float* row = depth + static_cast<size_t>(y) * bufferWidth;
+        for (int x = startX; x <= maxX; x++) {
+            float centerX = x + 0.5f;
+            if (edgeA[0] * centerX + edgeB[0] * centerY + edgeC[0] < 0.0f ||
+                edgeA[1] * centerX + edgeB[1] * centerY + edgeC[1] < 0.0f ||
+                edgeA[2] * centerX + edgeB[2] * centerY + edgeC[2] < 0.0f)
+                continue;
+            row[x] = std::min(row[x], depthA * centerX + depthB * centerY + depthC);
+        }
+    }
+#endif
+}
+
+void OcclusionCuller::buildHierarchy() {
+    for (size_t level = 1; level < levelWidth.size(); level++) {
+        int width = levelWidth[level];
+        int previousWidth = levelWidth[level - 1];
+        int previousHeight = levelHeight[level - 1];
+        const std::vector<float>& previousMin = level == 1 ? maxDepth[0] : minDepth[level - 1];
+        const std::vector<float>& previousMax = maxDepth[level - 1];
+        for (int y = 0; y < levelHeight[level]; y++) {
+            int y0 = y * 2;
+            int y1 = std::min(y0 + 1, previousHeight - 1);
+            for (int x = 0; x < width; x++) {
+                int x0 = x * 2;
+                int x1 = std::min(x0 + 1, previousWidth - 1);
+                size_t i00 = static_cast<size_t>(y0) * previousWidth + x0, i01 = static_cast<size_t>(y0) * previousWidth + x1;
+                size_t i10 = static_cast<size_t>(y1) * previousWidth + x0, i11 = static_cast<size_t>(y1) * previousWidth + x1;
+                size_t i = static_cast<size_t>(y) * width + x;
+                minDepth[level][i] = std::min(std::min(previousMin[i00], previousMin[i01]), std::min(previousMin[i10], previousMin[i11]));
+                maxDepth[level][i] = std::max(std::max(previousMax[i00], previousMax[i01]), std::max(previousMax[i10], previousMax[i11]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    counters.tested++;
+    if (!haveFrame)
+        return true;
+    if (!frameSynced)
+        waitUntilReady();
+
+    float rectMinX = 1e30f, rectMinY = 1e30f, rectMaxX = -1e30f, rectMaxY = -1e30f;
+    float nearestDepth = 1.0f;
+    for (int i = 0; i < 8; i++) {
+        glm::vec4 corner((i & 1) ? boundsMax.x : boundsMin.x, (i & 2) ? boundsMax.y : boundsMin.y, (i & 4) ? boundsMax.z : boundsMin.z, 1.0f);
+        glm::vec4 clip = frameViewProjection * corner;
+        // Crossing the near plane: nothing in front of it can hide the box
+        if (clip.w <= 1e-5f || clip.z < -clip.w)
+            return true;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        rectMinX = std::min(rectMinX, (ndc.x * 0.5f + 0.5f) * bufferWidth);
+        rectMaxX = std::max(rectMaxX, (ndc.x * 0.5f + 0.5f) * bufferWidth);
+        rectMinY = std::min(rectMinY, (ndc.y * 0.5f + 0.5f) * bufferHeight);
+        rectMaxY = std::max(rectMaxY, (ndc.y * 0.5f + 0.5f) * bufferHeight);
+        nearestDepth = std::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+    }
+    // Off screen is the frustum test's call, not ours
+    if (rectMaxX < 0.0f || rectMaxY < 0.0f || rectMinX >= bufferWidth || rectMinY >= bufferHeight)
+        return true;
+
+    int minX = static_cast<int>(std::max(rectMinX, 0.0f));
+    int maxX = static_cast<int>(std::min(rectMaxX, bufferWidth - 1.0f));
+    int minY = static_cast<int>(std::max(rectMinY, 0.0f));
+    int maxY = static_cast<int>(std::min(rectMaxY, bufferHeight - 1.0f));
+
+    // Start at the level where the rectangle covers at most 3x3 texels
+    int span = std::max(maxX - minX, maxY - minY) + 1;
+    int level = 0;
+    while ((span >> level) > 2 && level + 1 < static_cast<int>(levelWidth.size()))
+        level++;
+
+    for (int y = minY >> level; y <= maxY >> level; y++) {
+        for (int x = minX >> level; x <= maxX >> level; x++) {
+            if (visibleIn(level, x, y, minX, minY, maxX, maxY, nearestDepth))
+                return true;
+        }
+    }
+    counters.occluded++;
+    return false;
+}
+
+bool OcclusionCuller::visibleIn(int level, int x, int y, int rectMinX, int rectMinY, int rectMaxX, int rectMaxY, float nearestDepth) const {
+    size_t i = static_cast<size_t>(y) * levelWidth[level] + x;
+    if (level == 0)
+        return nearestDepth <= maxDepth[0][i];
+    // Behind the farthest occluder sample of the tile: hidden here
+    if (nearestDepth > maxDepth[level][i])
+        return false;
+    // In front of the nearest one: visible somewhere in the tile, which overlaps the rectangle
+    if (nearestDepth <= minDepth[level][i])
+        return true;
+
+    int child = level - 1;
+    for (int childY = y * 2; childY <= y * 2 + 1 && childY < levelHeight[child]; childY++) {
+        if ((childY << child) > rectMaxY || (((childY + 1) << child) - 1) < rectMinY)
+            continue;
+        for (int childX = x * 2; childX <= x * 2 + 1 && childX < levelWidth[child]; childX++) {
+            if ((childX << child) > rectMaxX || (((childX + 1) << child) - 1) < rectMinX)
+                continue;
+            if (visibleIn(child, childX, childY, rectMinX, rectMinY, rectMaxX, rectMaxY, nearestDepth))
+                return true;
+        }
+    }
+    return false;
+}
+
+OcclusionStats OcclusionCuller::stats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void OcclusionCuller::logStats(const std::string& label) {
+    OcclusionStats snapshot;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot = counters;
+        counters = OcclusionStats();
+    }
+    if (snapshot.frames == 0)
+        return;
+    double frames = snapshot.frames;
+    std::cout << label << ": " << snapshot.occluded << "/" << snapshot.tested << " boxes occluded, "
+              << snapshot.occluderTriangles / snapshot.frames << " occluder triangles, raster "
+              << snapshot.rasterMilliseconds / frames << " ms, waiting " << snapshot.waitMilliseconds / frames
+              << " ms per frame over " << snapshot.frames << " frames" << std::endl;
+}
+
+}
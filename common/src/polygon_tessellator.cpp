@@ -0,0 +1,170 @@
+#include "polygon_tessellator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace Common {
+
+namespace {
+
+const float Epsilon = 1e-6f;
+
+float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+float signedArea(const std::vector<glm::vec2>& points, const std::vector<unsigned int>& polygon) {
+    float area = 0.0f;
+    for (size_t i = 0; i < polygon.size(); i++)
+        area += cross(points[polygon[i]], points[polygon[(i + 1) % polygon.size()]]);
+    return area * 0.5f;
+}
+
+// Strictly inside the counter-clockwise triangle a, b, c
+bool insideTriangle(const glm::vec2& p, const glm::vec2& a, const glm::vec2& b, const glm::vec2& c) {
+    return cross(b - a, p - a) > Epsilon && cross(c - b, p - b) > Epsilon && cross(a - c, p - c) > Epsilon;
+}
+
+// Positive at convex corners of a counter-clockwise outline
+float turnAt(const std::vector<glm::vec2>& points, const std::vector<unsigned int>& polygon, size_t i) {
+    size_t count = polygon.size();
+    const glm::vec2& a = points[polygon[(i + count - 1) % count]];
+    const glm::vec2& b = points[polygon[i]];
+    const glm::vec2& c = points[polygon[(i + 1) % count]];
+    return cross(b - a, c - b);
+}
+
+bool isEar(const std::vector<glm::vec2>& points, const std::vector<unsigned int>& polygon, size_t i) {
+    size_t count = polygon.size();
+    const glm::vec2& a = points[polygon[(i + count - 1) % count]];
+    const glm::vec2& b = points[polygon[i]];
+    const glm::vec2& c = points[polygon[(i + 1) % count]];
+    if (turnAt(points, polygon, i) <= Epsilon)
+        return false;   // Reflex or flat corner
+    for (unsigned int other : polygon) {
+        const glm::vec2& p = points[other];
+        // Points sharing a corner's position (outlines that touch themselves) do not block the ear
+        if (p == a || p == b || p == c)
+            continue;
+        if (insideTriangle(p, a, b, c))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+std::vector<unsigned int> tessellatePolygon(const std::vector<glm::vec2>& points) {
+    std::vector<unsigned int> polygon;
+    polygon.reserve(points.size());
+    for (unsigned int i = 0; i < points.size(); i++) {
+        if (polygon.empty() || points[polygon.back()] != points[i])
+            polygon.push_back(i);
+    }
+    while (polygon.size() > 1 && points[polygon.front()] == points[polygon.back()])
+        polygon.pop_back();
+
+    std::vector<unsigned int> triangles;
+    if (polygon.size() < 3)
+        return triangles;
+    // Work counter-clockwise so every ear has a positive cross product
+    if (signedArea(points, polygon) < 0.0f)
+        std::reverse(polygon.begin(), polygon.end());
+
+    triangles.reserve((polygon.size() - 2) * 3);
+    auto emit = [&](size_t i) {
+        size_t count = polygon.size();
+        unsigned int a = polygon[(i + count - 1) % count];
+        unsigned int b = polygon[i];
+        unsigned int c = polygon[(i + 1) % count];
+        if (std::abs(turnAt(points, polygon, i)) > Epsilon) {
+            triangles.push_back(a);
+            triangles.push_back(b);
+            triangles.push_back(c);
+        }
+        polygon.erase(polygon.begin() + i);
+    };
+
+    while (polygon.size() > 3) {
+        size_t ear = polygon.size();
+        for (size_t i = 0; i < polygon.size(); i++) {
+            if (isEar(points, polygon, i)) {
+                ear = i;
+                break;
+            }
+        }
+        if (ear == polygon.size()) {
+            // No clean ear: the outline crosses or touches itself. Drop a flat corner if there is
+            // one, else cut the most convex corner anyway so the loop always finishes
+            size_t flat = polygon.size();
+            float best = Epsilon;
+            for (size_t i = 0; i < polygon.size(); i++) {
+                float turn = turnAt(points, polygon, i);
+                if (std::abs(turn) <= Epsilon) {
+                    flat = i;
+                    break;
+                }
+                if (turn > best) {
+                    best = turn;
+                    ear = i;
+                }
+            }
+            if (flat != polygon.size() || ear == polygon.size()) {
+                polygon.erase(polygon.begin() + (flat != polygon.size() ? flat : 0));
+                continue;
+            }
+        }
+        emit(ear);
+    }
+    emit(1);
+    return triangles;
+}
+
+void clipSegmentOutsideTriangles(const glm::vec2& a, const glm::vec2& b, const std::vector<glm::vec2>& triangles, std::vector<glm::vec2>& pieces) {
+    // Parameter ranges along a-b covered by each triangle
+    std::vector<std::pair<float, float>> covered;
+    glm::vec2 direction = b - a;
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        glm::vec2 p0 = triangles[t];
+        glm::vec2 p1 = triangles[t + 1];
+        glm::vec2 p2 = triangles[t + 2];
+        if (cross(p1 - p0, p2 - p0) < 0.0f)
+            std::swap(p1, p2);
+
+        float enter = 0.0f;
+        float exit = 1.0f;
+        const glm::vec2 corners[3] = { p0, p1, p2 };
+        for (int e = 0; e < 3 && enter < exit; e++) {
+            const glm::vec2& from = corners[e];
+            glm::vec2 edge = corners[(e + 1) % 3] - from;
+            // Inside this edge when f(t) = f0 + t * slope > 0
+            float f0 = cross(edge, a - from);
+            float slope = cross(edge, direction);
+            if (std::abs(slope) <= Epsilon) {
+                if (f0 <= Epsilon)
+                    exit = enter;
+                continue;
+            }
+            float crossing = -f0 / slope;
+            if (slope > 0.0f)
+                enter = std::max(enter, crossing);
+            else
+                exit = std::min(exit, crossing);
+        }
+        if (exit - enter > Epsilon)
+            covered.push_back({ enter, exit });
+    }
+
+    std::sort(covered.begin(), covered.end());
+    float start = 0.0f;
+    for (const std::pair<float, float>& range : covered) {
+        if (range.first > start)
+            pieces.insert(pieces.end(), { a + direction * start, a + direction * range.first });
+        start = std::max(start, range.second);
+    }
+    if (start < 1.0f)
+        pieces.insert(pieces.end(), { a + direction * start, b });
+}
+
+}
@@ -0,0 +1,380 @@
+#include "profiler.hpp"
+
+#ifdef COMMON_PROFILING
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Common {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Trace tracks that are not threads
+const uint32_t GpuTrack = 1000;
+const uint32_t FrameTrack = 1001;
+// Query sets in flight; a set still unavailable when its slot comes round again is dropped, not waited for
+const unsigned int GpuLatencyFrames = 4;
+const uint64_t GpuCalibrationInterval = 120;
+const size_t NoQuery = static_cast<size_t>(-1);
+
+struct ProfileEvent {
+    const char* name;
+    uint32_t track;
+    uint32_t depth;
+    int64_t start;      // Nanoseconds since the profiler started
+    int64_t duration;
+};
+
+struct OpenZone {
+    const char* name;
+    int64_t start;
+};
+
+struct ThreadBuffer {
+    uint32_t id = 0;
+    std::string name;
+    std::vector<OpenZone> open;             // Owning thread only
+    std::mutex mutex;
+    std::vector<ProfileEvent> finished;     // Handed to endFrame() under the mutex
+};
+
+struct GpuZone {
+    const char* name;
+    uint32_t depth;
+    size_t beginQuery;
+    size_t endQuery;
+};
+
+struct GpuFrame {
+    uint64_t frame = 0;
+    bool pending = false;
+    std::vector<GLuint> queries;            // Reused every time the slot comes round
+    size_t used = 0;
+    std::vector<GpuZone> zones;
+};
+
+struct FrameRecord {
+    uint64_t index;
+    int64_t start;
+    int64_t end;
+    std::vector<ProfileEvent> events;
+};
+
+struct ProfilerState {
+    Clock::time_point epoch = Clock::now();
+
+    std::mutex mutex;                       // Threads, history and the CSV
+    std::vector<std::unique_ptr<ThreadBuffer>> threads;
+    std::deque<FrameRecord> history;
+    size_t historyFrames = 600;
+    uint64_t frame = 0;
+    int64_t frameStart = 0;
+
+    std::ofstream csv;
+    std::string csvPath;
+    unsigned int csvRollFrames = 0;
+    unsigned int csvFrames = 0;
+
+    // GL thread only
+    GpuFrame gpuFrames[GpuLatencyFrames];
+    std::vector<size_t> gpuOpen;
+    bool gpuUsed = false;
+    int64_t gpuOffset = 0;                  // CPU minus GPU timestamp
+    uint64_t gpuDropped = 0;
+};
+
+ProfilerState& state() {
+    static ProfilerState profiler;
+    return profiler;
+}
+
+thread_local ThreadBuffer* currentThread = nullptr;
+
+int64_t nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - state().epoch).count();
+}
+
+ThreadBuffer& threadBuffer() {
+    if (!currentThread) {
+        ProfilerState& profiler = state();
+        std::lock_guard<std::mutex> lock(profiler.mutex);
+        profiler.threads.push_back(std::make_unique<ThreadBuffer>());
+        currentThread = profiler.threads.back().get();
+        currentThread->id = static_cast<uint32_t>(profiler.threads.size());
+        currentThread->name = "Thread " + std::to_string(currentThread->id);
+    }
+    return *currentThread;
+}
+
+// Caller holds the state mutex
+const std::string& trackName(const ProfilerState& profiler, uint32_t track) {
+    static const std::string gpu = "GPU";
+    static const std::string frames = "Frames";
+    if (track == GpuTrack)
+        return gpu;
+    if (track == FrameTrack)
+        return frames;
+    return profiler.threads[track - 1]->name;
+}
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            out << '\\';
+        out << c;
+    }
+    out << '"';
+}
+
+void writeCsvHeader(std::ostream& out) {
+    out << "frame,track,zone,depth,start_ms,duration_ms\n";
+}
+
+// Caller holds the state mutex
+void writeCsvRows(ProfilerState& profiler, uint64_t frame, const std::vector<ProfileEvent>& events) {
+    for (const ProfileEvent& event : events) {
+        profiler.csv << frame << "," << trackName(profiler, event.track) << "," << event.name << "," << event.depth << ","
+                     << event.start / 1.0e6 << "," << event.duration / 1.0e6 << "\n";
+    }
+}
+
+size_t nextQuery(GpuFrame& slot) {
+    if (slot.used == slot.queries.size()) {
+        GLuint query = 0;
+        glGenQueries(1, &query);
+        slot.queries.push_back(query);
+    }
+    return slot.used++;
+}
+
+// Reads the slot's timestamps if the GPU has written all of them; false if it has not yet
+bool resolveGpuFrame(ProfilerState& profiler, GpuFrame& slot, std::vector<ProfileEvent>& events) {
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    for (const GpuZone& zone : slot.zones) {
+        if (zone.endQuery == NoQuery)
+            continue;
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(slot.queries[zone.beginQuery], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[zone.endQuery], GL_QUERY_RESULT, &end);
+        events.push_back({ zone.name, GpuTrack, zone.depth, static_cast<int64_t>(begin) + profiler.gpuOffset,
+                           static_cast<int64_t>(end - begin) });
+    }
+    return true;
+}
+
+void resetGpuFrame(GpuFrame& slot) {
+    slot.pending = false;
+    slot.used = 0;
+    slot.zones.clear();
+}
+
+} // namespace
+
+namespace Profiler {
+
+void beginZone(const char* name) {
+    threadBuffer().open.push_back({ name, nowNanoseconds() });
+}
+
+void endZone() {
+    ThreadBuffer& buffer = threadBuffer();
+    if (buffer.open.empty())
+        return;
+    OpenZone zone = buffer.open.back();
+    buffer.open.pop_back();
+    int64_t end = nowNanoseconds();
+
+    std::lock_guard<std::mutex> lock(buffer.mutex);
+    buffer.finished.push_back({ zone.name, buffer.id, static_cast<uint32_t>(buffer.open.size()), zone.start, end - zone.start });
+}
+
+void beginGpuZone(const char* name) {
+    ProfilerState& profiler = state();
+    GpuFrame& slot = profiler.gpuFrames[profiler.frame % GpuLatencyFrames];
+    size_t query = nextQuery(slot);
+    glQueryCounter(slot.queries[query], GL_TIMESTAMP);
+    profiler.gpuOpen.push_back(slot.zones.size());
+    slot.zones.push_back({ name, static_cast<uint32_t>(profiler.gpuOpen.size() - 1), query, NoQuery });
+    profiler.gpuUsed = true;
+}
+
+void endGpuZone() {
+    ProfilerState& profiler = state();
+    if (profiler.gpuOpen.empty())
+        return;
+    GpuFrame& slot = profiler.gpuFrames[profiler.frame % GpuLatencyFrames];
+    size_t query = nextQuery(slot);
+    glQueryCounter(slot.queries[query], GL_TIMESTAMP);
+    slot.zones[profiler.gpuOpen.back()].endQuery = query;
+    profiler.gpuOpen.pop_back();
+}
+
+void setThreadName(const char* name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(state().mutex);
+    buffer.name = name;
+}
+
+void endFrame() {
+    ProfilerState& profiler = state();
+    int64_t now = nowNanoseconds();
+
+    // GPU zones of frame N are read back during frame N+1..N+3 if their queries are available by then
+    std::vector<std::pair<uint64_t, std::vector<ProfileEvent>>> gpuFrames;
+    if (profiler.gpuUsed) {
+        GpuFrame& current = profiler.gpuFrames[profiler.frame % GpuLatencyFrames];
+        current.frame = profiler.frame;
+        current.pending = current.used > 0;
+        profiler.gpuOpen.clear();
+
+        if (profiler.frame % GpuCalibrationInterval == 0) {
+            GLint64 gpuNow = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+            profiler.gpuOffset = nowNanoseconds() - gpuNow;
+        }
+
+        uint64_t oldest = profiler.frame >= GpuLatencyFrames - 1 ? profiler.frame - (GpuLatencyFrames - 1) : 0;
+        for (uint64_t frame = oldest; frame <= profiler.frame; frame++) {
+            GpuFrame& slot = profiler.gpuFrames[frame % GpuLatencyFrames];
+            if (!slot.pending || slot.frame != frame)
+                continue;
+            std::vector<ProfileEvent> events;
+            if (resolveGpuFrame(profiler, slot, events)) {
+                gpuFrames.emplace_back(frame, std::move(events));
+                resetGpuFrame(slot);
+            } else if (frame == oldest && profiler.frame >= GpuLatencyFrames - 1) {
+                // Its slot is reused next frame
+                if (profiler.gpuDropped++ == 0)
+                    std::cout << "Profiler: GPU timings more than " << GpuLatencyFrames - 1 << " frames late, dropping them" << std::endl;
+                resetGpuFrame(slot);
+            } else {
+                break;      // Timestamps complete in order, later frames are not ready either
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    FrameRecord record{ profiler.frame, profiler.frameStart, now, {} };
+    for (const auto& thread : profiler.threads) {
+        std::lock_guard<std::mutex> threadLock(thread->mutex);
+        record.events.insert(record.events.end(), thread->finished.begin(), thread->finished.end());
+        thread->finished.clear();
+    }
+    record.events.push_back({ "Frame", FrameTrack, 0, record.start, record.end - record.start });
+
+    if (profiler.csv.is_open()) {
+        writeCsvRows(profiler, record.index, record.events);
+        for (const auto& gpuFrame : gpuFrames)
+            writeCsvRows(profiler, gpuFrame.first, gpuFrame.second);
+        if (++profiler.csvFrames >= profiler.csvRollFrames) {
+            profiler.csv.close();
+            std::string oldPath = profiler.csvPath + ".old";
+            std::remove(oldPath.c_str());
+            std::rename(profiler.csvPath.c_str(), oldPath.c_str());
+            profiler.csv.open(profiler.csvPath);
+            writeCsvHeader(profiler.csv);
+            profiler.csvFrames = 0;
+        }
+    }
+
+    profiler.history.push_back(std::move(record));
+    while (profiler.history.size() > profiler.historyFrames)
+        profiler.history.pop_front();
+    // Late GPU zones join the frame they were recorded in, if it is still retained
+    for (auto& gpuFrame : gpuFrames) {
+        for (FrameRecord& frame : profiler.history) {
+            if (frame.index == gpuFrame.first) {
+                frame.events.insert(frame.events.end(), gpuFrame.second.begin(), gpuFrame.second.end());
+                break;
+            }
+        }
+    }
+
+    profiler.frameStart = now;
+    profiler.frame++;
+}
+
+void setHistoryFrames(unsigned int frames) {
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    profiler.historyFrames = frames > 0 ? frames : 1;
+}
+
+bool openCsv(const std::string& path, unsigned int rollFrames) {
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    profiler.csv.close();
+    profiler.csv.open(path);
+    if (!profiler.csv) {
+        std::cout << "ERROR::PROFILER: cannot write " << path << std::endl;
+        return false;
+    }
+    writeCsvHeader(profiler.csv);
+    profiler.csvPath = path;
+    profiler.csvRollFrames = rollFrames > 0 ? rollFrames : 1;
+    profiler.csvFrames = 0;
+    return true;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    ProfilerState& profiler = state();
+    std::lock_guard<std::mutex> lock(profiler.mutex);
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "ERROR::PROFILER: cannot write " << path << std::endl;
+        return false;
+    }
+
+    // Trace-event format: complete ("X") events in microseconds, plus thread name metadata
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    bool first = true;
+    auto writeTrackName = [&](uint32_t track) {
+        out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << track << ",\"args\":{\"name\":";
+        writeJsonString(out, trackName(profiler, track));
+        out << "}}";
+        first = false;
+    };
+    for (const auto& thread : profiler.threads)
+        writeTrackName(thread->id);
+    writeTrackName(GpuTrack);
+    writeTrackName(FrameTrack);
+
+    size_t eventCount = 0;
+    out.setf(std::ios::fixed);
+    out.precision(3);
+    for (const FrameRecord& frame : profiler.history) {
+        for (const ProfileEvent& event : frame.events) {
+            out << ",\n{\"name\":";
+            writeJsonString(out, event.name);
+            out << ",\"cat\":\"" << (event.track == GpuTrack ? "gpu" : "cpu") << "\",\"ph\":\"X\",\"ts\":" << event.start / 1000.0
+                << ",\"dur\":" << event.duration / 1000.0 << ",\"pid\":1,\"tid\":" << event.track << ",\"args\":{\"frame\":" << frame.index << "}}";
+            eventCount++;
+        }
+    }
+    out << "\n]}\n";
+
+    std::cout << "Profiler: wrote " << eventCount << " events from " << profiler.history.size() << " frames to " << path << std::endl;
+    return true;
+}
+
+} // namespace Profiler
+
+}
+
+#endif
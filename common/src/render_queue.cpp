@@ -0,0 +1,129 @@
+#include "render_queue.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Common {
+
+void logRenderStats(const std::string& label, const RenderStats& stats) {
+    std::cout << label << ": " << stats.drawCalls << " draws, " << stats.stateChanges << " state changes, "
+              << stats.redundantBindsSkipped << " redundant binds skipped" << std::endl;
+}
+
+void GLStateCache::useProgram(GLuint program) {
+    if (this->program == program) {
+        stats.redundantBindsSkipped++;
+        return;
+    }
+    glUseProgram(program);
+    this->program = program;
+    stats.stateChanges++;
+}
+
+void GLStateCache::bindVertexArray(GLuint vertexArray) {
+    if (this->vertexArray == vertexArray) {
+        stats.redundantBindsSkipped++;
+        return;
+    }
+    glBindVertexArray(vertexArray);
+    this->vertexArray = vertexArray;
+    stats.stateChanges++;
+}
+
+void GLStateCache::bindTexture(unsigned int unit, GLuint texture) {
+    if (unit >= MaxTextureUnits)
+        return;
+    if (textures[unit] == texture) {
+        stats.redundantBindsSkipped++;
+        return;
+    }
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    textures[unit] = texture;
+    stats.stateChanges++;
+}
+
+void GLStateCache::invalidate() {
+    program = ~0u;
+    vertexArray = ~0u;
+    activeUnit = ~0u;
+    std::fill(std::begin(textures), std::end(textures), ~0u);
+}
+
+uint64_t makeSortKey(RenderPass pass, GLuint program, uint32_t material, GLuint vertexArray, float depth) {
+    depth = std::min(std::max(depth, 0.0f), 1.0f);
+    uint64_t depthBits = static_cast<uint64_t>(depth * 0xFFFFF);
+    if (pass == RenderPass::Transparent)
+        depthBits = 0xFFFFF - depthBits;    // Back to front for blending
+
+    return (static_cast<uint64_t>(pass) & 0xF) << 60 |
+           (static_cast<uint64_t>(program) & 0xFFF) << 48 |
+           (static_cast<uint64_t>(material) & 0xFFFF) << 32 |
+           (static_cast<uint64_t>(vertexArray) & 0xFFF) << 20 |
+           depthBits;
+}
+
+void RenderQueue::submit(const DrawCommand& command) {
+    entries.push_back({ command.sortKey, static_cast<uint32_t>(commands.size()) });
+    commands.push_back(command);
+}
+
+void RenderQueue::radixSort() {
+    // LSD radix sort on 8-bit digits; stable, so equal keys keep submission order
+    scratch.resize(entries.size());
+    for (unsigned int shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const SortEntry& entry : entries)
+            counts[(entry.key >> shift) & 0xFF]++;
+
+        // Every key has the same digit here: this pass would not move anything
+        if (counts[(entries[0].key >> shift) & 0xFF] == entries.size())
+            continue;
+
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            size_t c = count;
+            count = offset;
+            offset += c;
+        }
+        for (const SortEntry& entry : entries)
+            scratch[counts[(entry.key >> shift) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+RenderStats RenderQueue::flush(GLStateCache& state) {
+    if (!entries.empty())
+        radixSort();
+
+    for (const SortEntry& entry : entries) {
+        const DrawCommand& command = commands[entry.index];
+        state.useProgram(command.program);
+        state.bindVertexArray(command.vertexArray);
+        for (unsigned int unit = 0; unit < MaxDrawTextures; unit++) {
+            if (command.textures[unit] != 0)
+                state.bindTexture(unit, command.textures[unit]);
+        }
+        if (command.applyUniforms)
+            command.applyUniforms(uniformArena.data() + command.uniformOffset);
+
+        if (command.indexType == 0) {
+            glDrawArraysInstanced(command.primitive, command.first, command.count, command.instanceCount);
+        } else {
+            size_t indexSize = command.indexType == GL_UNSIGNED_INT ? 4 : command.indexType == GL_UNSIGNED_SHORT ? 2 : 1;
+            glDrawElementsInstancedBaseVertex(command.primitive, command.count, command.indexType,
+                                              (void*)(static_cast<size_t>(command.first) * indexSize), command.instanceCount, command.baseVertex);
+        }
+        state.stats.drawCalls++;
+    }
+
+    commands.clear();
+    entries.clear();
+    uniformArena.clear();
+    return state.stats;
+}
+
+}
@@ -0,0 +1,59 @@
+#include "sphere_mesh.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace Common {
+
+void buildUnitSphere(int slices, int stacks, std::vector<glm::vec3>& triangles) {
+    slices = std::max(slices, 3);
+    stacks = std::max(stacks, 2);
+    const float pi = 3.14159265358979f;
+
+    // Rings from the +Z pole to the -Z pole, each with its first point repeated at the end
+    std::vector<glm::vec3> grid;
+    grid.reserve(static_cast<size_t>(stacks + 1) * (slices + 1));
+    for (int stack = 0; stack <= stacks; stack++) {
+        float polar = pi * stack / stacks;
+        for (int slice = 0; slice <= slices; slice++) {
+            float azimuth = 2.0f * pi * slice / slices;
+            grid.push_back(glm::vec3(std::sin(polar) * std::cos(azimuth), std::sin(polar) * std::sin(azimuth), std::cos(polar)));
+        }
+    }
+
+    auto at = [&](int stack, int slice) { return grid[static_cast<size_t>(stack) * (slices + 1) + slice]; };
+    triangles.reserve(triangles.size() + static_cast<size_t>(slices) * (stacks - 1) * 6);
+    for (int stack = 0; stack < stacks; stack++) {
+        for (int slice = 0; slice < slices; slice++) {
+            glm::vec3 a = at(stack, slice), b = at(stack, slice + 1);
+            glm::vec3 c = at(stack + 1, slice), d = at(stack + 1, slice + 1);
+            // The pole rows would otherwise get a degenerate triangle per quad
+            if (stack != 0)
+                triangles.insert(triangles.end(), { a, c, b });
+            if (stack != stacks - 1)
+                triangles.insert(triangles.end(), { b, c, d });
+        }
+    }
+}
+
+float projectedRadiusPixels(const glm::mat4& modelViewProjection, const glm::vec2& viewportSize) {
+    float w = std::abs(modelViewProjection[3][3]);
+    if (w <= 1e-6f)
+        w = 1e-6f;
+    float radius = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        glm::vec2 extent(modelViewProjection[axis][0] * viewportSize.x, modelViewProjection[axis][1] * viewportSize.y);
+        radius = std::max(radius, std::sqrt(extent.x * extent.x + extent.y * extent.y) * 0.5f / w);
+    }
+    return radius;
+}
+
+int circleSegmentsForRadius(float radiusPixels, float tolerancePixels) {
+    // A chord spanning angle a sits r * (1 - cos(a / 2)) inside the circle
+    if (radiusPixels <= tolerancePixels)
+        return 3;
+    float halfAngle = std::acos(1.0f - tolerancePixels / radiusPixels);
+    return std::max(3, static_cast<int>(std::ceil(3.14159265358979f / halfAngle)));
+}
+
+}
@@ -0,0 +1,231 @@
+#include "static_batch.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace Common {
+
+const char* const StaticDrawGlsl = R"(layout (location = 8) in uint aDrawID;
+
+struct StaticDraw
+{
+    mat4 model;
+    vec4 color;
+};
+layout(std140) uniform StaticDrawData
+{
+    StaticDraw draws[128];
+};
+)";
+
+namespace {
+
+// Draws sharing all of these can go into one multi-draw call
+bool sameGroup(const DrawCommand& a, const DrawCommand& b) {
+    return a.vertexArray == b.vertexArray && a.primitive == b.primitive &&
+           std::memcmp(a.textures, b.textures, sizeof(a.textures)) == 0;
+}
+
+bool groupLess(const DrawCommand& a, const DrawCommand& b) {
+    if (a.vertexArray != b.vertexArray)
+        return a.vertexArray < b.vertexArray;
+    if (a.primitive != b.primitive)
+        return a.primitive < b.primitive;
+    return std::memcmp(a.textures, b.textures, sizeof(a.textures)) < 0;
+}
+
+} // namespace
+
+StaticBatch::StaticBatch() {
+    // baseInstance in indirect commands needs GL 4.2 or ARB_base_instance on top of multi-draw indirect
+    multiDraw = GLAD_GL_VERSION_4_3 || (GLAD_GL_ARB_multi_draw_indirect && GLAD_GL_ARB_base_instance);
+    if (!multiDraw)
+        std::cout << "StaticBatch: glMultiDrawElementsIndirect unavailable, drawing commands one by one" << std::endl;
+
+    glGenBuffers(1, &drawDataBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, drawDataBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, MaxStaticDraws * sizeof(StaticDrawData), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (multiDraw) {
+        glGenBuffers(1, &indirectBuffer);
+
+        // Instance i of a command with baseInstance b reads element b + i, which is b for single instances
+        std::vector<GLuint> drawIds(MaxStaticDraws);
+        for (size_t i = 0; i < MaxStaticDraws; i++)
+            drawIds[i] = static_cast<GLuint>(i);
+        glGenBuffers(1, &drawIdBuffer);
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+StaticBatch::~StaticBatch() {
+    glDeleteBuffers(1, &drawDataBuffer);
+    if (indirectBuffer != 0)
+        glDeleteBuffers(1, &indirectBuffer);
+    if (drawIdBuffer != 0)
+        glDeleteBuffers(1, &drawIdBuffer);
+}
+
+size_t StaticBatch::add(const DrawCommand& command, const StaticDrawData& data) {
+    if (command.indexType != GL_UNSIGNED_INT) {
+        std::cout << "ERROR::STATIC_BATCH: only GL_UNSIGNED_INT indexed draws can be batched" << std::endl;
+        return InvalidHandle;
+    }
+    if (liveCount == MaxStaticDraws) {
+        std::cout << "ERROR::STATIC_BATCH: batch is full (" << MaxStaticDraws << " draws)" << std::endl;
+        return InvalidHandle;
+    }
+
+    size_t handle;
+    if (!freeHandles.empty()) {
+        handle = freeHandles.back();
+        freeHandles.pop_back();
+    } else {
+        handle = entries.size();
+        entries.emplace_back();
+    }
+    entries[handle].command = command;
+    entries[handle].data = data;
+    entries[handle].live = true;
+    liveCount++;
+    rebuildOrder = true;
+    return handle;
+}
+
+void StaticBatch::setRange(size_t handle, const DrawCommand& command) {
+    if (handle >= entries.size() || !entries[handle].live)
+        return;
+    DrawCommand& current = entries[handle].command;
+    if (current.count == command.count && current.first == command.first && current.baseVertex == command.baseVertex)
+        return;
+    current.count = command.count;
+    current.first = command.first;
+    current.baseVertex = command.baseVertex;
+    commandsDirty = true;
+}
+
+void StaticBatch::setData(size_t handle, const StaticDrawData& data) {
+    if (handle >= entries.size() || !entries[handle].live)
+        return;
+    entries[handle].data = data;
+    dataDirty = true;
+}
+
+void StaticBatch::remove(size_t handle) {
+    if (handle >= entries.size() || !entries[handle].live)
+        return;
+    entries[handle].live = false;
+    freeHandles.push_back(handle);
+    liveCount--;
+    rebuildOrder = true;
+}
+
+void StaticBatch::rebuild(GLStateCache& state) {
+    if (rebuildOrder) {
+        order.clear();
+        for (size_t handle = 0; handle < entries.size(); handle++) {
+            if (entries[handle].live)
+                order.push_back(handle);
+        }
+        std::stable_sort(order.begin(), order.end(),
+                         [this](size_t a, size_t b) { return groupLess(entries[a].command, entries[b].command); });
+
+        groups.clear();
+        for (size_t i = 0; i < order.size(); i++) {
+            const DrawCommand& command = entries[order[i]].command;
+            if (groups.empty() || !sameGroup(entries[groups.back().handle].command, command))
+                groups.push_back({ order[i], i, 0 });
+            groups.back().count++;
+        }
+        if (multiDraw) {
+            for (const Group& group : groups)
+                attachDrawId(state, entries[group.handle].command.vertexArray);
+        }
+
+        rebuildOrder = false;
+        commandsDirty = true;
+        dataDirty = true;
+    }
+
+    if (commandsDirty) {
+        commands.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            const DrawCommand& command = entries[order[i]].command;
+            commands[i] = { static_cast<GLuint>(command.count), 1, static_cast<GLuint>(command.first),
+                            command.baseVertex, static_cast<GLuint>(i) };
+        }
+        if (multiDraw) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        }
+        commandsDirty = false;
+    }
+
+    if (dataDirty) {
+        drawData.resize(order.size());
+        for (size_t i = 0; i < order.size(); i++)
+            drawData[i] = entries[order[i]].data;
+        glBindBuffer(GL_UNIFORM_BUFFER, drawDataBuffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, drawData.size() * sizeof(StaticDrawData), drawData.data());
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        dataDirty = false;
+    }
+}
+
+void StaticBatch::attachDrawId(GLStateCache& state, GLuint vertexArray) {
+    if (std::find(attachedArrays.begin(), attachedArrays.end(), vertexArray) != attachedArrays.end())
+        return;
+    state.bindVertexArray(vertexArray);
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glEnableVertexAttribArray(DrawIdAttribute);
+    glVertexAttribIPointer(DrawIdAttribute, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+    glVertexAttribDivisor(DrawIdAttribute, 1);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    attachedArrays.push_back(vertexArray);
+}
+
+void StaticBatch::draw(GLStateCache& state, GLuint program) {
+    rebuild(state);
+    if (order.empty())
+        return;
+
+    state.useProgram(program);
+    glBindBufferBase(GL_UNIFORM_BUFFER, StaticDrawDataBinding, drawDataBuffer);
+    if (multiDraw)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+
+    for (const Group& group : groups) {
+        const DrawCommand& shared = entries[group.handle].command;
+        state.bindVertexArray(shared.vertexArray);
+        for (unsigned int unit = 0; unit < MaxDrawTextures; unit++) {
+            if (shared.textures[unit] != 0)
+                state.bindTexture(unit, shared.textures[unit]);
+        }
+
+        if (multiDraw) {
+            glMultiDrawElementsIndirect(shared.primitive, GL_UNSIGNED_INT,
+                                        (void*)(group.first * sizeof(DrawElementsIndirectCommand)),
+                                        static_cast<GLsizei>(group.count), 0);
+            state.stats.drawCalls++;
+            continue;
+        }
+        // The attribute array stays disabled here, so every vertex reads this constant value
+        for (size_t i = group.first; i < group.first + group.count; i++) {
+            const DrawElementsIndirectCommand& command = commands[i];
+            glVertexAttribI1ui(DrawIdAttribute, static_cast<GLuint>(i));
+            glDrawElementsBaseVertex(shared.primitive, command.count, GL_UNSIGNED_INT,
+                                     (void*)(static_cast<size_t>(command.firstIndex) * sizeof(GLuint)), command.baseVertex);
+            state.stats.drawCalls++;
+        }
+    }
+
+    if (multiDraw)
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+}
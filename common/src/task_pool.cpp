@@ -0,0 +1,74 @@
+#include "task_pool.hpp"
+
+#include <algorithm>
+
+namespace Common {
+
+TaskPool::TaskPool(unsigned int threads) {
+    if (threads == 0)
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for (unsigned int i = 1; i < threads; i++)
+        workers.emplace_back(&TaskPool::workerLoop, this);
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void TaskPool::run(size_t count, size_t grain, const std::function<void(size_t, size_t)>& fn) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &fn;
+        jobCount = count;
+        jobGrain = std::max<size_t>(grain, 1);
+        nextItem.store(0, std::memory_order_relaxed);
+        busyWorkers = static_cast<unsigned int>(workers.size());
+        generation++;
+    }
+    wake.notify_all();
+
+    // The caller takes chunks too instead of sitting idle
+    work();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+void TaskPool::work() {
+    const size_t count = jobCount;
+    const size_t grain = jobGrain;
+    while (true) {
+        size_t begin = nextItem.fetch_add(grain, std::memory_order_relaxed);
+        if (begin >= count)
+            break;
+        (*job)(begin, std::min(begin + grain, count));
+    }
+}
+
+void TaskPool::workerLoop() {
+    uint64_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+
+        work();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0)
+            done.notify_one();
+    }
+}
+
+}
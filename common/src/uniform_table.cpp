@@ -0,0 +1,81 @@
+#include "uniform_table.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace Common {
+
+void UniformTable::reflect(GLuint program) {
+    this->program = program;
+    entries.clear();
+#ifndef NDEBUG
+    reportedMissing.clear();
+#endif
+
+    GLint count = 0, maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+    std::vector<char> buffer(static_cast<size_t>(maxLength) + 1);
+    std::string name;
+    for (GLint i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program, static_cast<GLuint>(i), maxLength, &length, &size, &type, buffer.data());
+        name.assign(buffer.data(), length);
+
+        // Block members have no location and are set through their buffer instead
+        GLint location = glGetUniformLocation(program, name.c_str());
+        if (location < 0)
+            continue;
+
+        entries.push_back({ hashUniformName(name.c_str()), location, size });
+
+        // Arrays are reported as "name[0]"; register the bare name and every element too
+        size_t bracket = name.rfind("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            std::string base = name.substr(0, bracket);
+            entries.push_back({ hashUniformName(base.c_str()), location, size });
+            for (GLint element = 1; element < size; element++) {
+                std::string elementName = base + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(program, elementName.c_str());
+                if (elementLocation >= 0)
+                    entries.push_back({ hashUniformName(elementName.c_str()), elementLocation, 1 });
+            }
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.hash < b.hash; });
+    for (size_t i = 1; i < entries.size(); i++) {
+        if (entries[i].hash == entries[i - 1].hash && entries[i].location != entries[i - 1].location)
+            std::cout << "WARNING::UNIFORM_HASH_COLLISION in program " << program << ": rename one of the uniforms" << std::endl;
+    }
+}
+
+const UniformTable::Entry* UniformTable::find(uint32_t hash) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+                               [](const Entry& entry, uint32_t value) { return entry.hash < value; });
+    return (it != entries.end() && it->hash == hash) ? &*it : nullptr;
+}
+
+GLint UniformTable::location(UniformName name) const {
+    if (const Entry* entry = find(name.hash))
+        return entry->location;
+
+#ifndef NDEBUG
+    // Inactive uniforms are optimized out by the linker too, so this also catches unused ones
+    if (std::find(reportedMissing.begin(), reportedMissing.end(), name.hash) == reportedMissing.end()) {
+        reportedMissing.push_back(name.hash);
+        std::cout << "WARNING::UNIFORM_NOT_FOUND: '" << name.name << "' is not an active uniform of program " << program << std::endl;
+    }
+#endif
+    return -1;
+}
+
+GLint UniformTable::arraySize(UniformName name) const {
+    const Entry* entry = find(name.hash);
+    return entry ? entry->arraySize : 0;
+}
+
+}
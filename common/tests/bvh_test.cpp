@@ -0,0 +1,160 @@
+#include "bvh.hpp"
+
+#include "check.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Common;
+
+namespace {
+
+struct Scene {
+    Bvh bvh;
+    std::vector<int> proxies;
+    std::vector<Bounds> boxes;      // By item; empty once removed
+};
+
+Bounds randomBox(std::mt19937& random, float spread) {
+    std::uniform_real_distribution<float> position(-spread, spread);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+    glm::vec3 center(position(random), position(random), position(random));
+    glm::vec3 extents(size(random), size(random), size(random));
+    return Bounds(center - extents, center + extents);
+}
+
+std::vector<uint32_t> sorted(std::vector<uint32_t> items) {
+    std::sort(items.begin(), items.end());
+    return items;
+}
+
+// Same slab test as Bvh::queryRay: entry distance, or -1 for a miss
+float rayEntry(const Bounds& bounds, const glm::vec3& origin, const glm::vec3& direction, float maxDistance) {
+    glm::vec3 inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    float enter = 0.0f, exit = maxDistance;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (bounds.min[axis] - origin[axis]) * inverse[axis];
+        float t1 = (bounds.max[axis] - origin[axis]) * inverse[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        enter = std::max(enter, t0);
+        exit = std::min(exit, t1);
+    }
+    return enter <= exit ? enter : -1.0f;
+}
+
+// Every query agrees with testing every box, from a handful of random viewpoints
+void checkQueries(const Scene& scene, std::mt19937& random) {
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (int view = 0; view < 16; view++) {
+        glm::vec3 eye(unit(random) * 60.0f, unit(random) * 60.0f, unit(random) * 60.0f);
+        glm::vec3 target(unit(random) * 20.0f, unit(random) * 20.0f, unit(random) * 20.0f);
+        glm::mat4 viewProjection = glm::perspective(glm::radians(60.0f), 1.5f, 0.5f, 80.0f) *
+                                   glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+        FrustumPlanes frustum = extractFrustumPlanes(viewProjection);
+
+        std::vector<uint32_t> found, expected;
+        scene.bvh.queryFrustum(frustum, [&](uint32_t item) { found.push_back(item); });
+        for (uint32_t item = 0; item < scene.boxes.size(); item++) {
+            if (!scene.boxes[item].empty() && classify(frustum, scene.boxes[item]) != Containment::Outside)
+                expected.push_back(item);
+        }
+        CHECK(sorted(found) == expected);
+
+        float radius = 5.0f + 10.0f * (unit(random) + 1.0f);
+        found.clear();
+        expected.clear();
+        scene.bvh.querySphere(target, radius, [&](uint32_t item) { found.push_back(item); });
+        for (uint32_t item = 0; item < scene.boxes.size(); item++) {
+            const Bounds& box = scene.boxes[item];
+            if (box.empty())
+                continue;
+            glm::vec3 offset = glm::min(glm::max(target, box.min), box.max) - target;
+            if (glm::dot(offset, offset) <= radius * radius)
+                expected.push_back(item);
+        }
+        CHECK(sorted(found) == expected);
+
+        // Nearest box along the ray, the box itself counting as the hit
+        glm::vec3 direction = glm::normalize(target - eye);
+        float nearest = 1000.0f;
+        scene.bvh.queryRay(eye, direction, 1000.0f, [&](uint32_t item, float entry) {
+            (void)item;
+            nearest = std::min(nearest, entry);
+            return entry;
+        });
+        float expectedNearest = 1000.0f;
+        for (const Bounds& box : scene.boxes) {
+            float entry = box.empty() ? -1.0f : rayEntry(box, eye, direction, 1000.0f);
+            if (entry >= 0.0f)
+                expectedNearest = std::min(expectedNearest, entry);
+        }
+        CHECK(nearest == expectedNearest);
+    }
+}
+
+void queriesMatchBruteForce() {
+    std::mt19937 random(3);
+    Scene scene;
+    for (uint32_t item = 0; item < 2000; item++) {
+        scene.boxes.push_back(randomBox(random, 50.0f));
+        scene.proxies.push_back(scene.bvh.insert(scene.boxes.back(), item));
+    }
+    CHECK(scene.bvh.size() == 2000);
+    checkQueries(scene, random);
+
+    // Removed items stop being reported
+    for (uint32_t item = 0; item < scene.boxes.size(); item += 5) {
+        scene.bvh.remove(scene.proxies[item]);
+        scene.boxes[item] = Bounds();
+    }
+    CHECK(scene.bvh.size() == 1600);
+    checkQueries(scene, random);
+}
+
+void rebuildKeepsProxiesAndLowersCost() {
+    std::mt19937 random(9);
+    Scene scene;
+    // Inserted in a tight cluster, then scattered: refitting alone leaves a poor tree
+    for (uint32_t item = 0; item < 3000; item++) {
+        scene.boxes.push_back(randomBox(random, 5.0f));
+        scene.proxies.push_back(scene.bvh.insert(scene.boxes.back(), item));
+    }
+    scene.bvh.rebuild();
+    for (uint32_t item = 0; item < scene.boxes.size(); item++) {
+        scene.boxes[item] = randomBox(random, 60.0f);
+        scene.bvh.update(scene.proxies[item], scene.boxes[item]);
+    }
+    float degraded = scene.bvh.cost();
+    checkQueries(scene, random);
+
+    // optimize() notices the degradation and rebuilds with binned SAH
+    CHECK(scene.bvh.optimize());
+    float rebuilt = scene.bvh.cost();
+    CHECK(rebuilt < degraded);
+    CHECK(!scene.bvh.optimize());
+
+    // Proxies survive the rebuild and still name their items and boxes
+    for (uint32_t item = 0; item < scene.boxes.size(); item++) {
+        CHECK(scene.bvh.item(scene.proxies[item]) == item);
+        CHECK(scene.bvh.bounds(scene.proxies[item]) == scene.boxes[item]);
+    }
+    checkQueries(scene, random);
+
+    // A second rebuild from the same boxes is no worse
+    scene.bvh.rebuild();
+    CHECK(scene.bvh.cost() <= rebuilt * 1.0001f);
+    checkQueries(scene, random);
+}
+
+} // namespace
+
+int main() {
+    queriesMatchBruteForce();
+    rebuildKeepsProxiesAndLowersCost();
+    return Test::checkResult();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <iostream>
+
+// Minimal assertions for the unit tests: a failed CHECK is reported and the test keeps going,
+// main() returns checkResult() so ctest sees the failure
+namespace Common {
+    namespace Test {
+        inline int failures = 0;
+
+        inline int checkResult() {
+            if (failures != 0)
+                std::cout << failures << " check(s) failed" << std::endl;
+            return failures == 0 ? 0 : 1;
+        }
+    }
+}
+
+#define CHECK(expression)                                                                         \
+    do {                                                                                          \
+        if (!(expression)) {                                                                      \
+            std::cout << __FILE__ << ":" << __LINE__ << ": CHECK(" #expression ") failed" << std::endl; \
+            Common::Test::failures++;                                                             \
+        }                                                                                         \
+    } while (0)
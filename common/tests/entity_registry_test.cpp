@@ -0,0 +1,205 @@
+#include "entity_registry.hpp"
+
+#include "check.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Common;
+
+namespace {
+
+// The layout flush() promises: every parent ahead of its children, each depth level contiguous,
+// and handles and dense indices pointing at each other
+void checkDenseOrder(const EntityRegistry& registry) {
+    const std::vector<uint32_t>& parents = registry.parents();
+    CHECK(registry.denseSize() == registry.size());
+    std::vector<uint32_t> depth(registry.denseSize(), 0);
+    for (uint32_t i = 0; i < registry.denseSize(); i++) {
+        CHECK(registry.components()[i] & EntityRegistry::Alive);
+        CHECK(registry.index(registry.handle(i)) == i);
+        if (parents[i] != EntityRegistry::NoParent) {
+            CHECK(parents[i] < i);
+            depth[i] = depth[parents[i]] + 1;
+        }
+        if (i > 0)
+            CHECK(depth[i] >= depth[i - 1]);
+    }
+}
+
+void staleHandles() {
+    EntityRegistry registry;
+    EntityHandle first = registry.create();
+    EntityHandle child = registry.create(first);
+    CHECK(registry.alive(first) && registry.alive(child));
+
+    // Destroying a parent takes its children with it
+    registry.destroy(first);
+    CHECK(!registry.alive(first));
+    CHECK(!registry.alive(child));
+    CHECK(registry.size() == 0);
+
+    // The freed slots come back with a new generation, before and after a flush
+    EntityHandle reused = registry.create();
+    CHECK(registry.alive(reused));
+    CHECK(reused != first && reused != child);
+    CHECK(!registry.alive(first) && !registry.alive(child));
+    registry.flush();
+    EntityHandle again = registry.create();
+    CHECK(registry.alive(reused) && registry.alive(again));
+    CHECK(!registry.alive(first) && !registry.alive(child));
+    CHECK(!registry.alive(EntityRegistry::Null));
+
+    // A stale handle cannot be used as a parent either
+    CHECK(registry.create(first) == EntityRegistry::Null);
+    CHECK(!registry.setParent(again, first));
+    checkDenseOrder(registry);
+}
+
+void reparenting() {
+    EntityRegistry registry;
+    EntityHandle a = registry.create();
+    EntityHandle b = registry.create();
+    EntityHandle c = registry.create(b);
+    registry.editTransform(a).position = glm::vec3(1.0f, 0.0f, 0.0f);
+    registry.editTransform(b).position = glm::vec3(0.0f, 2.0f, 0.0f);
+    registry.editTransform(c).position = glm::vec3(0.0f, 0.0f, 3.0f);
+    registry.updateTransforms();
+    CHECK(glm::vec3(registry.world(c)[3]) == glm::vec3(0.0f, 2.0f, 3.0f));
+
+    // b moves under a and takes c along
+    CHECK(registry.setParent(b, a));
+    CHECK(registry.parent(b) == a);
+    CHECK(registry.parent(c) == b);
+    registry.updateTransforms();
+    CHECK(glm::vec3(registry.world(b)[3]) == glm::vec3(1.0f, 2.0f, 0.0f));
+    CHECK(glm::vec3(registry.world(c)[3]) == glm::vec3(1.0f, 2.0f, 3.0f));
+
+    // Cycles are refused and leave the hierarchy alone
+    CHECK(!registry.setParent(a, c));
+    CHECK(!registry.setParent(a, a));
+    CHECK(registry.parent(a) == EntityRegistry::Null);
+
+    // Back to a root
+    CHECK(registry.setParent(b, EntityRegistry::Null));
+    registry.updateTransforms();
+    CHECK(registry.parent(b) == EntityRegistry::Null);
+    CHECK(glm::vec3(registry.world(c)[3]) == glm::vec3(0.0f, 2.0f, 3.0f));
+    checkDenseOrder(registry);
+}
+
+void orderAfterFlush() {
+    EntityRegistry registry;
+    // Chain built backwards, so every setParent() puts a parent after its child
+    std::vector<EntityHandle> chain;
+    for (int i = 0; i < 8; i++)
+        chain.push_back(registry.create());
+    for (size_t i = 0; i + 1 < chain.size(); i++)
+        CHECK(registry.setParent(chain[i], chain[i + 1]));
+    // Some leaves under the middle of the chain, and one destroyed subtree
+    std::vector<EntityHandle> leaves;
+    for (int i = 0; i < 4; i++)
+        leaves.push_back(registry.create(chain[4]));
+    EntityHandle doomed = registry.create(chain[2]);
+    registry.create(doomed);
+    registry.destroy(doomed);
+
+    registry.flush();
+    checkDenseOrder(registry);
+    CHECK(registry.size() == chain.size() + leaves.size());
+    for (size_t i = 0; i + 1 < chain.size(); i++) {
+        CHECK(registry.parent(chain[i]) == chain[i + 1]);
+        CHECK(registry.index(chain[i + 1]) < registry.index(chain[i]));
+    }
+    for (EntityHandle leaf : leaves)
+        CHECK(registry.parent(leaf) == chain[4]);
+
+    // A second flush with nothing changed keeps every index
+    std::vector<uint32_t> before;
+    for (EntityHandle entity : chain)
+        before.push_back(registry.index(entity));
+    registry.flush();
+    for (size_t i = 0; i < chain.size(); i++)
+        CHECK(registry.index(chain[i]) == before[i]);
+}
+
+// Same hierarchy in both registries: `levels` deep, `width` entities per level, each under a random
+// entity of the level above, with random local transforms and bounds
+void buildHierarchy(EntityRegistry& registry, int levels, int width) {
+    std::mt19937 random(11);
+    std::uniform_real_distribution<float> offset(-5.0f, 5.0f);
+    std::uniform_real_distribution<float> angle(-180.0f, 180.0f);
+    std::uniform_real_distribution<float> scale(0.5f, 1.5f);
+    std::vector<EntityHandle> above;
+    std::vector<EntityHandle> level;
+    for (int depth = 0; depth < levels; depth++) {
+        level.clear();
+        for (int i = 0; i < width; i++) {
+            EntityHandle parent = above.empty() ? EntityRegistry::Null : above[random() % above.size()];
+            EntityHandle entity = registry.create(parent);
+            TransformComponent& transform = registry.editTransform(entity);
+            transform.position = glm::vec3(offset(random), offset(random), offset(random));
+            transform.rotation = glm::vec3(angle(random), angle(random), angle(random));
+            transform.scale = glm::vec3(scale(random));
+            registry.setLocalBounds(entity, Bounds(glm::vec3(-1.0f), glm::vec3(1.0f)));
+            level.push_back(entity);
+        }
+        above = level;
+    }
+}
+
+bool sameWorlds(const EntityRegistry& a, const EntityRegistry& b) {
+    if (a.denseSize() != b.denseSize())
+        return false;
+    const BoundsSoA& boxesA = a.worldBounds();
+    const BoundsSoA& boxesB = b.worldBounds();
+    for (uint32_t i = 0; i < a.denseSize(); i++) {
+        if (a.handle(i) != b.handle(i) || a.worldMatrices()[i] != b.worldMatrices()[i])
+            return false;
+        if (boxesA.centerX[i] != boxesB.centerX[i] || boxesA.extentY[i] != boxesB.extentY[i])
+            return false;
+    }
+    return true;
+}
+
+void parallelMatchesSerial() {
+    // Levels several times wider than one parallel chunk, so every level is split across threads
+    const int levels = 10;
+    const int width = 6000;
+    EntityRegistry serial;
+    EntityRegistry parallel;
+    buildHierarchy(serial, levels, width);
+    buildHierarchy(parallel, levels, width);
+    TaskPool pool(4);
+
+    CHECK(serial.updateTransforms() == static_cast<size_t>(levels * width));
+    CHECK(parallel.updateTransforms(&pool) == static_cast<size_t>(levels * width));
+    CHECK(sameWorlds(serial, parallel));
+
+    // Moving a few entities near the top dirties their whole subtrees
+    std::mt19937 random(5);
+    for (int i = 0; i < 20; i++) {
+        uint32_t at = static_cast<uint32_t>(random() % (2 * width));
+        glm::vec3 position(static_cast<float>(i), 1.0f, -1.0f);
+        serial.editTransform(serial.handle(at)).position = position;
+        parallel.editTransform(parallel.handle(at)).position = position;
+    }
+    size_t moved = serial.updateTransforms();
+    CHECK(moved > 20);
+    CHECK(parallel.updateTransforms(&pool) == moved);
+    CHECK(sameWorlds(serial, parallel));
+
+    // Nothing edited: nothing recomputed
+    CHECK(parallel.updateTransforms(&pool) == 0);
+}
+
+} // namespace
+
+int main() {
+    staleHandles();
+    reparenting();
+    orderAfterFlush();
+    parallelMatchesSerial();
+    return Test::checkResult();
+}
@@ -0,0 +1,113 @@
+#include "frustum_culler.hpp"
+
+#include "check.hpp"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace Common;
+
+namespace {
+
+// Axis aligned box frustum, [-10, 10] on every axis: every plane normal has two zero components,
+// which is what turned empty bounds' infinite extents into NaN
+FrustumPlanes boxFrustum() {
+    FrustumPlanes frustum;
+    frustum.planes[FrustumPlanes::Left] = glm::vec4(1.0f, 0.0f, 0.0f, 10.0f);
+    frustum.planes[FrustumPlanes::Right] = glm::vec4(-1.0f, 0.0f, 0.0f, 10.0f);
+    frustum.planes[FrustumPlanes::Bottom] = glm::vec4(0.0f, 1.0f, 0.0f, 10.0f);
+    frustum.planes[FrustumPlanes::Top] = glm::vec4(0.0f, -1.0f, 0.0f, 10.0f);
+    frustum.planes[FrustumPlanes::Near] = glm::vec4(0.0f, 0.0f, 1.0f, 10.0f);
+    frustum.planes[FrustumPlanes::Far] = glm::vec4(0.0f, 0.0f, -1.0f, 10.0f);
+    return frustum;
+}
+
+// Random boxes in and around the frustum, every seventh one empty. The count is not a multiple
+// of 32 so the scalar tail runs too
+BoundsSoA randomBoxes(size_t count) {
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> position(-20.0f, 20.0f);
+    std::uniform_real_distribution<float> size(0.0f, 3.0f);
+    BoundsSoA bounds;
+    for (size_t i = 0; i < count; i++) {
+        if (i % 7 == 3) {
+            bounds.push_back(Bounds());
+            continue;
+        }
+        glm::vec3 center(position(random), position(random), position(random));
+        glm::vec3 extents(size(random), size(random), size(random));
+        bounds.push_back(Bounds(center - extents, center + extents));
+    }
+    return bounds;
+}
+
+void kernelsAgree() {
+    const FrustumPlanes frustum = boxFrustum();
+    const BoundsSoA bounds = randomBoxes(1000);
+
+    std::vector<uint32_t> expected;
+    resizeVisibilityMask(expected, bounds.size());
+    CHECK(cullFrustumWithKernel("scalar", frustum, bounds, 0, bounds.size(), expected.data()));
+    for (size_t i = 0; i < bounds.size(); i++) {
+        if (i % 7 == 3)
+            CHECK(!isVisible(expected, i));
+    }
+
+    for (const char* kernel : { "sse", "avx2" }) {
+        std::vector<uint32_t> mask;
+        resizeVisibilityMask(mask, bounds.size());
+        if (!cullFrustumWithKernel(kernel, frustum, bounds, 0, bounds.size(), mask.data())) {
+            std::cout << kernel << " kernel not available, skipped" << std::endl;
+            continue;
+        }
+        CHECK(mask == expected);
+    }
+
+    // The whole-array entry point agrees with and without a pool
+    std::vector<uint32_t> mask;
+    size_t visible = cullFrustum(frustum, bounds, mask);
+    CHECK(mask == expected);
+    TaskPool pool(4);
+    std::vector<uint32_t> pooled;
+    CHECK(cullFrustum(frustum, bounds, pooled, &pool) == visible);
+    CHECK(pooled == expected);
+}
+
+void emptyBoundsNeverVisible() {
+    // Empty boxes at every position in a word and in the tail, against frustums whose planes
+    // have zero normal components
+    FrustumPlanes frustum = boxFrustum();
+    BoundsSoA bounds;
+    for (int i = 0; i < 70; i++)
+        bounds.push_back(Bounds());
+    for (const char* kernel : { "scalar", "sse", "avx2" }) {
+        std::vector<uint32_t> mask;
+        resizeVisibilityMask(mask, bounds.size());
+        if (cullFrustumWithKernel(kernel, frustum, bounds, 0, bounds.size(), mask.data())) {
+            for (uint32_t word : mask)
+                CHECK(word == 0);
+        }
+    }
+}
+
+void poolChunksCoverLargeArrays() {
+    // More boxes than one parallelFor() chunk, so the pool splits the work
+    const FrustumPlanes frustum = boxFrustum();
+    const BoundsSoA bounds = randomBoxes(200003);
+    std::vector<uint32_t> serial;
+    size_t visible = cullFrustum(frustum, bounds, serial);
+    TaskPool pool(4);
+    std::vector<uint32_t> pooled;
+    CHECK(cullFrustum(frustum, bounds, pooled, &pool) == visible);
+    CHECK(pooled == serial);
+}
+
+} // namespace
+
+int main() {
+    kernelsAgree();
+    emptyBoundsNeverVisible();
+    poolChunksCoverLargeArrays();
+    return Test::checkResult();
+}
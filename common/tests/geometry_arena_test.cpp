@@ -0,0 +1,51 @@
+#include "geometry_arena.hpp"
+
+#include "check.hpp"
+
+using namespace Common;
+
+namespace {
+
+// What a destroyed mesh hands back to the arena has to be reusable by the next load
+void freedRangesAreReused() {
+    RangeAllocator ranges(100);
+    size_t a = ranges.allocate(30);
+    size_t b = ranges.allocate(30);
+    size_t c = ranges.allocate(30);
+    CHECK(a == 0 && b == 30 && c == 60);
+    CHECK(ranges.used() == 90);
+    CHECK(ranges.allocate(20) == RangeAllocator::InvalidOffset);
+
+    ranges.free(b, 30);
+    CHECK(ranges.used() == 60);
+    CHECK(ranges.allocate(25) == 30);
+    ranges.free(30, 25);
+
+    // Neighbours merge back into one range, so a larger mesh fits where smaller ones were
+    ranges.free(a, 30);
+    CHECK(ranges.largestFreeRange() == 60);
+    CHECK(ranges.allocate(60) == 0);
+    ranges.free(0, 60);
+    ranges.free(c, 30);
+    CHECK(ranges.used() == 0);
+    CHECK(ranges.freeRangeCount() == 1);
+    CHECK(ranges.largestFreeRange() == 100);
+}
+
+void growAppendsFreeSpace() {
+    RangeAllocator ranges(10);
+    CHECK(ranges.allocate(8) == 0);
+    ranges.grow(20);
+    // The old free tail and the new space are one range
+    CHECK(ranges.freeRangeCount() == 1);
+    CHECK(ranges.allocate(12) == 8);
+    CHECK(ranges.used() == 20);
+}
+
+} // namespace
+
+int main() {
+    freedRangesAreReused();
+    growAppendsFreeSpace();
+    return Test::checkResult();
+}
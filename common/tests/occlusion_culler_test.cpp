@@ -0,0 +1,77 @@
+#include "occlusion_culler.hpp"
+
+#include "check.hpp"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+using namespace Common;
+
+namespace {
+
+// Camera at the origin looking down -z, with a 10 x 10 wall 10 units away filling the middle of the view
+glm::mat4 viewProjection() {
+    return glm::perspective(glm::radians(90.0f), 2.0f, 0.5f, 100.0f) *
+           glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+size_t addWall(OcclusionCuller& culler) {
+    return culler.addBoxOccluder(glm::vec3(-5.0f, -5.0f, -10.5f), glm::vec3(5.0f, 5.0f, -10.0f), glm::mat4(1.0f));
+}
+
+void checkWall(bool threaded) {
+    OcclusionCuller culler(256, 128, threaded);
+    size_t wall = addWall(culler);
+    culler.beginFrame(viewProjection());
+
+    // Fully behind the wall
+    CHECK(!culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -19.0f)));
+    CHECK(!culler.isVisible(glm::vec3(-8.0f, -8.0f, -30.0f), glm::vec3(8.0f, 8.0f, -25.0f)));
+    // In front of the wall
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -6.0f), glm::vec3(1.0f, 1.0f, -4.0f)));
+
+    // Behind the wall but reaching past its edge, where nothing hides it
+    CHECK(culler.isVisible(glm::vec3(2.0f, -1.0f, -21.0f), glm::vec3(20.0f, 1.0f, -19.0f)));
+    // Poking through the wall
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -9.0f)));
+
+    // Crossing the near plane, or entirely behind the camera: never reported as hidden
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, 1.0f)));
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -0.4f), glm::vec3(1.0f, 1.0f, -0.1f)));
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, 5.0f), glm::vec3(1.0f, 1.0f, 10.0f)));
+
+    // The wall is in the depth buffer in the middle of the view and absent at the edges
+    const std::vector<float>& depth = culler.depth();
+    CHECK(depth[(culler.height() / 2) * culler.width() + culler.width() / 2] < 1.0f);
+    CHECK(depth[0] == 1.0f);
+
+    // Moving the wall aside uncovers the box
+    culler.setOccluderTransform(wall, glm::translate(glm::mat4(1.0f), glm::vec3(40.0f, 0.0f, 0.0f)));
+    culler.beginFrame(viewProjection());
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -19.0f)));
+
+    // And with no occluders at all nothing is hidden
+    culler.removeOccluder(wall);
+    culler.beginFrame(viewProjection());
+    CHECK(culler.isVisible(glm::vec3(-8.0f, -8.0f, -30.0f), glm::vec3(8.0f, 8.0f, -25.0f)));
+    culler.finish();
+
+    OcclusionStats stats = culler.stats();
+    CHECK(stats.frames == 3);
+    CHECK(stats.occluded == 2);
+}
+
+void noFrameMeansVisible() {
+    OcclusionCuller culler(64, 32, false);
+    addWall(culler);
+    // Before the first beginFrame() there is no depth to test against
+    CHECK(culler.isVisible(glm::vec3(-1.0f, -1.0f, -21.0f), glm::vec3(1.0f, 1.0f, -19.0f)));
+}
+
+} // namespace
+
+int main() {
+    checkWall(false);
+    checkWall(true);
+    noFrameMeansVisible();
+    return Test::checkResult();
+}
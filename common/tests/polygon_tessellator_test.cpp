@@ -0,0 +1,95 @@
+#include "polygon_tessellator.hpp"
+
+#include "check.hpp"
+
+#include <cmath>
+#include <vector>
+
+using namespace Common;
+
+namespace {
+
+float cross(const glm::vec2& a, const glm::vec2& b) {
+    return a.x * b.y - a.y * b.x;
+}
+
+float outlineArea(const std::vector<glm::vec2>& points) {
+    float area = 0.0f;
+    for (size_t i = 0; i < points.size(); i++)
+        area += cross(points[i], points[(i + 1) % points.size()]);
+    return std::abs(area) * 0.5f;
+}
+
+// Even-odd point in polygon
+bool insideOutline(const glm::vec2& p, const std::vector<glm::vec2>& points) {
+    bool inside = false;
+    for (size_t i = 0, j = points.size() - 1; i < points.size(); j = i++) {
+        const glm::vec2& a = points[i];
+        const glm::vec2& b = points[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+    return inside;
+}
+
+// Every triangle valid, counter-clockwise, non-degenerate and inside the outline, and together
+// they cover exactly the outline's area
+void checkTriangulation(const std::vector<glm::vec2>& points, const std::vector<unsigned int>& indices, size_t expectedTriangles) {
+    CHECK(indices.size() == expectedTriangles * 3);
+    float area = 0.0f;
+    for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+        CHECK(indices[t] < points.size() && indices[t + 1] < points.size() && indices[t + 2] < points.size());
+        const glm::vec2& a = points[indices[t]];
+        const glm::vec2& b = points[indices[t + 1]];
+        const glm::vec2& c = points[indices[t + 2]];
+        float twice = cross(b - a, c - a);
+        CHECK(twice > 1e-6f);
+        CHECK(insideOutline((a + b + c) / 3.0f, points));
+        area += twice * 0.5f;
+    }
+    CHECK(std::abs(area - outlineArea(points)) < 1e-4f);
+}
+
+void concaveOutlines() {
+    // U shape, clockwise: the notch must stay uncovered
+    std::vector<glm::vec2> u = { { 0, 0 }, { 0, 3 }, { 1, 3 }, { 1, 1 }, { 2, 1 }, { 2, 3 }, { 3, 3 }, { 3, 0 } };
+    checkTriangulation(u, tessellatePolygon(u), u.size() - 2);
+
+    // Five pointed star, counter-clockwise, alternating reflex corners
+    std::vector<glm::vec2> star;
+    for (int i = 0; i < 10; i++) {
+        float angle = 3.14159265f * 0.5f + i * 3.14159265f / 5.0f;
+        float radius = i % 2 == 0 ? 1.0f : 0.4f;
+        star.push_back(glm::vec2(std::cos(angle), std::sin(angle)) * radius);
+    }
+    checkTriangulation(star, tessellatePolygon(star), star.size() - 2);
+}
+
+void collinearOutlines() {
+    // Square with extra points along its edges: flat corners add no sliver triangles
+    std::vector<glm::vec2> square = { { 0, 0 }, { 1, 0 }, { 2, 0 }, { 2, 1 }, { 2, 2 }, { 1, 2 }, { 0, 2 }, { 0, 1 } };
+    std::vector<unsigned int> indices = tessellatePolygon(square);
+    CHECK(indices.size() >= 2 * 3 && indices.size() <= (square.size() - 2) * 3);
+    checkTriangulation(square, indices, indices.size() / 3);
+
+    // Repeated and closing points are ignored
+    std::vector<glm::vec2> repeated = { { 0, 0 }, { 0, 0 }, { 1, 0 }, { 1, 1 }, { 1, 1 }, { 0, 1 }, { 0, 0 } };
+    std::vector<unsigned int> quad = tessellatePolygon(repeated);
+    CHECK(quad.size() == 2 * 3);
+    float area = 0.0f;
+    for (size_t t = 0; t + 2 < quad.size(); t += 3)
+        area += cross(repeated[quad[t + 1]] - repeated[quad[t]], repeated[quad[t + 2]] - repeated[quad[t]]) * 0.5f;
+    CHECK(std::abs(area - 1.0f) < 1e-5f);
+
+    // All points on one line: nothing to fill
+    std::vector<glm::vec2> line = { { 0, 0 }, { 1, 1 }, { 2, 2 }, { 3, 3 } };
+    CHECK(tessellatePolygon(line).empty());
+}
+
+} // namespace
+
+int main() {
+    concaveOutlines();
+    collinearOutlines();
+    return Test::checkResult();
+}